@@ -0,0 +1,105 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Static background model for fixed-mount sensors.
+
+    A cell is one (azimuth bin, laser). While learning, the decode workers
+    accumulate the range statistics of every cell with relaxed atomics.
+    After the learning frames each cell gets a background range, and a
+    return is foreground when it is closer than that range by more than the
+    margin, or when it hits a cell that was empty while learning.
+*/
+
+#ifndef _PANDAR_BACKGROUND_MODEL_H_
+#define _PANDAR_BACKGROUND_MODEL_H_ 1
+
+#include <stdint.h>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+
+typedef struct BackgroundConfig_s {
+	bool enable;
+	uint32_t learnFrames;   // frames accumulated before classifying
+	float minMargin;        // meters closer than the background to be foreground
+	float sigmaScale;       // margin in standard deviations of the learned range
+	float minOccupancy;     // cells with returns in fewer learning frames are empty (sky)
+	inline BackgroundConfig_s() {
+		enable = false;
+		learnFrames = 100;
+		minMargin = 0.3f;
+		sigmaScale = 3.0f;
+		minOccupancy = 0.5f;
+	}
+} BackgroundConfig;
+
+typedef struct BackgroundSummary_s {
+	bool learning;
+	uint32_t u32LearnedFrames;
+	uint32_t u32ForegroundPoints;
+	uint32_t u32BackgroundPoints;
+	uint32_t u32CellNum;                // azimuth bins x lasers
+	std::vector<uint8_t> backgroundMask;  // bit per cell, set if it returned background in this frame
+} BackgroundSummary;
+
+class BackgroundModel {
+ public:
+	BackgroundModel();
+	/** @brief size the model for cellnum cells and restart learning */
+	void setup(const BackgroundConfig &config, uint32_t cellnum);
+	/** @brief forget the model and learn again */
+	void reset();
+	inline bool isLearning() {
+		return m_bLearning;
+	}
+	inline uint32_t getCellNum() {
+		return m_u32CellNum;
+	}
+	/** @brief accumulate one return, called from the decode workers */
+	inline void learn(uint32_t cell, float distance) {
+		if(cell >= m_u32CellNum || distance <= 0) {
+			return;
+		}
+		uint64_t mm = static_cast<uint64_t>(distance * 1000);
+		m_arrCount[cell].fetch_add(1, boost::memory_order_relaxed);
+		m_arrSum[cell].fetch_add(mm, boost::memory_order_relaxed);
+		m_arrSumSq[cell].fetch_add(mm * mm, boost::memory_order_relaxed);
+	}
+	/** @brief classify one return, called from the decode workers */
+	inline bool isBackground(uint32_t cell, float distance) {
+		if(cell >= m_u32CellNum) {
+			return false;
+		}
+		if(distance <= 0 || distance >= m_vecThreshold[cell]) {
+			m_arrMask[cell >> 5].fetch_or(1u << (cell & 31), boost::memory_order_relaxed);
+			m_u32BackgroundPoints.fetch_add(1, boost::memory_order_relaxed);
+			return true;
+		}
+		m_u32ForegroundPoints.fetch_add(1, boost::memory_order_relaxed);
+		return false;
+	}
+	/** @brief close a frame: finish learning or fill the summary; no worker may run */
+	void endFrame(BackgroundSummary &summary);
+
+ private:
+	BackgroundConfig m_objConfig;
+	uint32_t m_u32CellNum;
+	bool m_bLearning;
+	uint32_t m_u32LearnedFrames;
+	boost::scoped_array<boost::atomic<uint32_t> > m_arrCount;
+	boost::scoped_array<boost::atomic<uint64_t> > m_arrSum;    // millimeters
+	boost::scoped_array<boost::atomic<uint64_t> > m_arrSumSq;
+	boost::scoped_array<boost::atomic<uint32_t> > m_arrMask;
+	std::vector<float> m_vecThreshold;  // returns closer than this are foreground
+	boost::atomic<uint32_t> m_u32ForegroundPoints;
+	boost::atomic<uint32_t> m_u32BackgroundPoints;
+};
+
+#endif  // _PANDAR_BACKGROUND_MODEL_H_
@@ -0,0 +1,52 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    On-disk cache of the angle correction fetched from the sensor.
+
+    Every correction is kept as <dir>/<serial>_<crc32>.csv, so a sensor
+    that gets recalibrated keeps its older entries. <dir>/<ip>.last names
+    the serial and checksum last seen at a device address, that is the
+    entry loaded at startup before the sensor has answered. An entry whose
+    content does not match its checksum is ignored. Files are written to
+    a temporary name and renamed, a crash never leaves half an entry.
+*/
+
+#ifndef _PANDAR_CALIBRATION_CACHE_H_
+#define _PANDAR_CALIBRATION_CACHE_H_ 1
+
+#include <stdint.h>
+#include <string>
+
+class CalibrationCache {
+ public:
+	CalibrationCache();
+	void setDirectory(std::string dir);
+	inline bool isEnabled() {
+		return !m_sDir.empty();
+	}
+	/**
+	 * @brief the entry last stored for deviceip
+	 * @return 0 on success, -1 if there is none or it is corrupt
+	 */
+	int load(std::string deviceip, std::string &serial, uint32_t &checksum, std::string &content);
+	/** @return 0 on success, -1 if a file cannot be written */
+	int store(std::string deviceip, std::string serial, const std::string &content);
+	static uint32_t getChecksum(const std::string &content);
+
+ private:
+	std::string getEntryPath(std::string serial, uint32_t checksum);
+	std::string getDevicePath(std::string deviceip);
+	static int writeFile(std::string path, const std::string &content);
+	static int readFile(std::string path, std::string &content);
+
+	std::string m_sDir;
+};
+
+#endif  // _PANDAR_CALIBRATION_CACHE_H_
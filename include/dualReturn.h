@@ -0,0 +1,89 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Per-return output of a frame.
+
+    In a dual return mode the two blocks of a packet measure the same
+    azimuth and the organized cloud interleaves them per azimuth bin. The
+    splitter copies every return into its own plane of columns (x, y, z,
+    intensity, timestamp, ring, return type), plane n holding block n of
+    every pair. With dedupe the decoder drops the second return of a unit
+    when it measured the same distance as the first, the point kept in
+    plane 0 then carries both return types.
+*/
+
+#ifndef _PANDAR_DUAL_RETURN_H_
+#define _PANDAR_DUAL_RETURN_H_ 1
+
+#include <stdint.h>
+#include <vector>
+#include <pcl/point_cloud.h>
+#include "point_types.h"
+
+#define RETURN_TYPE_FIRST (0x01)
+#define RETURN_TYPE_STRONGEST (0x02)
+#define RETURN_TYPE_LAST (0x04)
+#define RETURN_PLANE_NUM (2)
+
+typedef struct DualReturnConfig_s {
+	bool enable;
+	bool dedupe;  // drop the second return of a unit at decode time when its distance equals the first
+	inline DualReturnConfig_s() {
+		enable = false;
+		dedupe = true;
+	}
+} DualReturnConfig;
+
+typedef struct ReturnPlane_s {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<uint8_t> intensity;
+	std::vector<double> timestamp;
+	std::vector<uint16_t> ring;
+	std::vector<uint8_t> returnType;  // RETURN_TYPE_* bits
+	inline size_t size() const { return x.size(); }
+} ReturnPlane;
+
+typedef struct DualReturnFrame_s {
+	uint8_t u8ReturnMode;    // return mode byte of the packet tail
+	uint32_t u32Duplicates;  // points of plane 0 standing for both returns
+	ReturnPlane planes[RETURN_PLANE_NUM];  // in block order, plane 1 is empty in a single return mode
+	inline DualReturnFrame_s() {
+		u8ReturnMode = 0;
+		u32Duplicates = 0;
+	}
+} DualReturnFrame;
+
+class DualReturnSplitter {
+ public:
+	DualReturnSplitter();
+	void setConfig(const DualReturnConfig &config);
+	inline bool isDedupe() const { return m_objConfig.dedupe; }
+	/** @brief clear the duplicate marks for a frame of cellNum azimuth bin x laser cells */
+	void reset(int cellNum);
+	/** @brief the second return of cell was dropped, safe to call concurrently */
+	inline void markDuplicate(int cell) { m_vecDuplicates[cell] = 1; }
+	/**
+	 * @brief copy return block returnBlock of cloud, laid out as azimuth bin x return block x laser,
+	 *        into plane; safe to call concurrently for the blocks of one frame
+	 * @return number of points of plane marked as duplicates
+	 */
+	uint32_t split(const pcl::PointCloud<PointXYZIT> &cloud, int laserNum, int returnBlockSize, int returnBlock,
+				uint8_t returnMode, ReturnPlane &plane);
+	/** @brief RETURN_TYPE_* of the blocks of a packet in returnMode, in block order */
+	static void getReturnTypes(uint8_t returnMode, uint8_t *types);
+
+ private:
+	DualReturnConfig m_objConfig;
+	std::vector<uint8_t> m_vecDuplicates;  // per azimuth bin x laser, written by the decode workers
+};
+
+#endif  // _PANDAR_DUAL_RETURN_H_
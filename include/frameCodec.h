@@ -0,0 +1,104 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Lossless compressed frames for storage and transport.
+
+    The SDK's frame is organized: point index = column * laserNum + laser,
+    a column holds returnNum returns of one azimuth bin. Every point of a
+    frame in the lidar frame was built from a range in PANDAR128_DISTANCE_UNIT
+    and a pitch / azimuth in 0.01 degree through the SDK's cos / sin table. The encoder
+    finds the three integers back, checks that they give the same xyz bits
+    and keeps only them, the decoder builds xyz again from the same table.
+    Points that do not come back bit for bit (extrinsic, deskewing, voxel
+    clouds) keep their xyz, or the whole point, raw.
+
+    Every laser is one lane. A lane stores per point a kind byte, the range
+    delta to its previous point, the pitch and azimuth offsets to the lane's
+    base angles, the intensity and the timestamp bits as a second order
+    delta, zigzag varints. Each of these streams is rANS coded per lane
+    with one frequency table per stream for the frame; the raw values of
+    the points that fall back are a last stream stored as they are. The
+    decoder runs groups of lanes in parallel on the SDK's executor.
+
+    Layout: FrameCodecHeader, the lane bases (laserNum x uint16 pitch,
+    uint16 azimuth offset), the FRAME_CODEC_STREAM_NUM - 1 frequency
+    tables, then for every lane the symbol and byte count of each coded
+    stream (varints) followed by its rANS bytes, and the byte count and
+    bytes of its raw stream.
+*/
+
+#ifndef _PANDAR_FRAME_CODEC_H_
+#define _PANDAR_FRAME_CODEC_H_ 1
+
+#include <stdint.h>
+#include <vector>
+#include <pcl/point_cloud.h>
+#include "point_types.h"
+
+#define FRAME_CODEC_MAGIC (0x5A435050)  // "PPCZ"
+#define FRAME_CODEC_VERSION (1)
+#define FRAME_CODEC_STREAM_NUM (7)
+#define FRAME_CODEC_MAX_POINTS (1 << 24)  // 0.01 degree bins of a 128 laser dual return frame fit
+
+typedef struct __attribute__((__packed__)) FrameCodecHeader_s {
+	uint32_t u32Magic;
+	uint16_t u16Version;
+	uint16_t u16LaserNum;   // lanes of the organized frame, 0: every point is stored raw in one lane
+	uint16_t u16ReturnNum;
+	uint16_t u16AngleSize;  // azimuth bin of a column, 0.01 degree
+	uint32_t u32Width;
+	uint32_t u32Height;
+	double dTimestamp;      // frame timestamp, the first timestamp prediction of every lane
+	uint32_t u32Size;       // bytes of the encoded frame, header included
+} FrameCodecHeader;
+
+typedef struct FrameCodecStats_s {
+	uint32_t u32NativePoints;  // rebuilt from range and angles
+	uint32_t u32RawXyzPoints;  // xyz stored raw
+	uint32_t u32RawPoints;     // the whole point stored raw
+	uint32_t u32EmptyPoints;   // empty slots of the organized frame
+	uint32_t u32Bytes;
+} FrameCodecStats;
+
+class FrameEncoder {
+ public:
+	FrameEncoder();
+	/**
+	 * @brief encode one frame
+	 * @param laserNum, returnNum  organized layout of the cloud, as published by the SDK;
+	 *                             laserNum 0 (or a cloud not of that layout) stores every point raw
+	 *        out                  replaced by the encoded frame
+	 * @return 0 on success, -1 if the cloud is not width x height points or has more than FRAME_CODEC_MAX_POINTS
+	 */
+	int encode(const pcl::PointCloud<PointXYZIT> &cloud, double timestamp, int laserNum, int returnNum, std::vector<uint8_t> &out);
+	/** @brief point kinds and size of the last encoded frame */
+	inline const FrameCodecStats &getStats() const { return m_objStats; }
+
+ private:
+	FrameCodecStats m_objStats;
+	std::vector<std::vector<uint8_t> > m_vecStreams;  // lane * FRAME_CODEC_STREAM_NUM + stream
+	std::vector<uint8_t> m_vecScratch;
+};
+
+class FrameDecoder {
+ public:
+	/**
+	 * @brief decode one frame into cloud, resized to the width x height of the frame
+	 * @return 0 on success, -1 if data is not a complete frame of this version
+	 */
+	int decode(const uint8_t *data, size_t size, pcl::PointCloud<PointXYZIT> &cloud, double &timestamp);
+	/** @return bytes of the frame at data, 0 if data does not start with a frame header */
+	static size_t getFrameSize(const uint8_t *data, size_t size);
+
+ private:
+	std::vector<std::vector<uint8_t> > m_vecStreams;
+};
+
+#endif  // _PANDAR_FRAME_CODEC_H_
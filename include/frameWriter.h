@@ -0,0 +1,131 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Frame writer: published frames to disk on a background I/O thread.
+
+    push() only queues the shared cloud, the SDK decodes the next frame
+    into a new cloud while one is queued. When the queue is full the frame
+    is dropped and counted, the publish thread never waits for the disk.
+    Every frame becomes one file <filePrefix>_<frame number>.<format>,
+    serialized into a reused buffer and written with a single write().
+
+    FRAME_WRITER_FORMAT_PCD is binary PCD with the fields x y z intensity
+    timestamp ring, 26 bytes per point. FRAME_WRITER_FORMAT_COLUMNS is a
+    FrameColumnsHeader followed by the columns x, y, z (float), intensity
+    (uint8), time after the header timestamp (float, seconds) and ring
+    (uint8), 18 bytes per point. FRAME_WRITER_FORMAT_COMPRESSED is the
+    lossless FrameEncoder frame (frameCodec.h), always the whole organized
+    frame; push() then needs the laser and return number of the layout.
+*/
+
+#ifndef _PANDAR_FRAME_WRITER_H_
+#define _PANDAR_FRAME_WRITER_H_ 1
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <pcl/point_cloud.h>
+#include "frameCodec.h"
+#include "point_types.h"
+
+#define FRAME_WRITER_FORMAT_PCD "pcd"
+#define FRAME_WRITER_FORMAT_COLUMNS "pfc"
+#define FRAME_WRITER_FORMAT_COMPRESSED "pcz"
+#define FRAME_WRITER_QUEUE_SIZE (4)
+#define FRAME_COLUMNS_MAGIC (0x43465050)  // "PPFC"
+#define FRAME_COLUMNS_VERSION (1)
+
+typedef struct __attribute__((__packed__)) FrameColumnsHeader_s {
+	uint32_t u32Magic;
+	uint16_t u16Version;
+	uint16_t u16Reserved;
+	uint32_t u32PointNum;
+	uint32_t u32Width;    // of the frame, 0 when the empty slots were skipped
+	uint32_t u32Height;
+	double dTimestamp;    // frame timestamp, the point times are relative to it
+} FrameColumnsHeader;
+
+typedef struct FrameWriterConfig_s {
+	std::string filePrefix;   // files are named <filePrefix>_<frame number, 6 digits>.<format>
+	std::string format;       // FRAME_WRITER_FORMAT_PCD, _COLUMNS or _COMPRESSED
+	uint32_t u32QueueSize;    // frames waiting for the disk
+	uint32_t u32Decimation;   // write frame n * u32Decimation only, 1: every frame
+	uint32_t u32MaxFrames;    // stop writing after this many files, 0: no limit
+	bool bSkipEmpty;          // leave out the empty slots (ring 0) of the organized frame
+	inline FrameWriterConfig_s() {
+		format = FRAME_WRITER_FORMAT_PCD;
+		u32QueueSize = FRAME_WRITER_QUEUE_SIZE;
+		u32Decimation = 1;
+		u32MaxFrames = 0;
+		bSkipEmpty = true;
+	}
+} FrameWriterConfig;
+
+typedef struct FrameWriterStats_s {
+	uint64_t u64PushedFrames;   // frames offered by the publish thread
+	uint64_t u64WrittenFrames;
+	uint64_t u64WrittenBytes;
+	uint64_t u64DroppedFrames;  // frames dropped because the queue was full
+	uint64_t u64FailedFrames;   // frames lost because the file could not be written
+	bool bWriting;
+} FrameWriterStats;
+
+class FrameWriter {
+ public:
+	FrameWriter();
+	~FrameWriter();
+	/** @return 0 if the I/O thread started, -1 if it is running or the prefix is empty */
+	int start(const FrameWriterConfig &config);
+	/** @brief write out the queued frames and stop the I/O thread */
+	void stop();
+	/**
+	 * @brief queue one frame, never blocks; called from the publish thread
+	 * @param laserNum, returnNum  organized layout for FRAME_WRITER_FORMAT_COMPRESSED, 0: not organized
+	 */
+	void push(boost::shared_ptr<pcl::PointCloud<PointXYZIT> > cloud, double timestamp, int laserNum = 0, int returnNum = 1);
+	FrameWriterStats getStats();
+	inline bool isWriting() { return m_bWriting.load(boost::memory_order_acquire); }
+
+ private:
+	typedef struct QueuedFrame_s {
+		boost::shared_ptr<pcl::PointCloud<PointXYZIT> > cloud;
+		double timestamp;
+		uint64_t number;
+		int laserNum;
+		int returnNum;
+	} QueuedFrame;
+
+	void ioThread();
+	void serializePcd(const pcl::PointCloud<PointXYZIT> &cloud);
+	void serializeColumns(const pcl::PointCloud<PointXYZIT> &cloud, double timestamp);
+	int writeFile(uint64_t number);
+
+	FrameWriterConfig m_objConfig;
+	boost::mutex m_mutexQueue;
+	boost::condition_variable m_condQueue;
+	std::deque<QueuedFrame> m_queFrames;
+	boost::thread *m_pIoThread;
+	bool m_bStopRequest;           // under m_mutexQueue
+	boost::atomic<bool> m_bWriting;
+	uint64_t m_u64FrameNumber;     // publish thread only
+	std::vector<uint8_t> m_vecBuffer;  // I/O thread only
+	FrameEncoder m_objEncoder;         // I/O thread only
+	boost::atomic<uint64_t> m_u64PushedFrames;
+	boost::atomic<uint64_t> m_u64WrittenFrames;
+	boost::atomic<uint64_t> m_u64WrittenBytes;
+	boost::atomic<uint64_t> m_u64DroppedFrames;
+	boost::atomic<uint64_t> m_u64FailedFrames;
+};
+
+#endif  // _PANDAR_FRAME_WRITER_H_
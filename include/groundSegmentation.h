@@ -0,0 +1,69 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Ground segmentation on the organized output cloud.
+
+    The cloud is laid out as azimuth bin x return block x laser, so every
+    (azimuth bin, return block) is a column of rings. Each column is walked
+    from the lowest to the highest elevation; a point is ground while the
+    slope from the last ground point and its height above the expected
+    ground plane stay within the limits. Columns are independent and can be
+    labeled in parallel.
+*/
+
+#ifndef _PANDAR_GROUND_SEGMENTATION_H_
+#define _PANDAR_GROUND_SEGMENTATION_H_ 1
+
+#include <stdint.h>
+#include <vector>
+#include <pcl/point_cloud.h>
+#include "point_types.h"
+
+#define GROUND_LABEL_NONE (0)    // empty slot
+#define GROUND_LABEL_GROUND (1)
+#define GROUND_LABEL_OBSTACLE (2)
+
+typedef struct GroundSegmentationConfig_s {
+	bool enable;
+	float groundZ;          // z of the ground below the sensor in the output frame, meters
+	float maxLocalSlope;    // degrees, between consecutive ground points of a column
+	float maxGlobalSlope;   // degrees, from the origin on the expected ground plane
+	float heightTolerance;  // meters, added to both slope limits
+	inline GroundSegmentationConfig_s() {
+		enable = false;
+		groundZ = -1.8f;
+		maxLocalSlope = 10.0f;
+		maxGlobalSlope = 5.0f;
+		heightTolerance = 0.15f;
+	}
+} GroundSegmentationConfig;
+
+class GroundSegmentation {
+ public:
+	GroundSegmentation();
+	void setConfig(const GroundSegmentationConfig &config);
+	/**
+	 * @brief sort the rings by elevation and size the labels for a frame
+	 * @param elevation  elevation angle per laser, degrees
+	 * @return number of columns of the frame
+	 */
+	int prepare(int columnNum, int laserNum, const float *elevation, std::vector<uint8_t> &labels);
+	/** @brief label the columns [begin, end) of cloud, safe to call concurrently on disjoint ranges */
+	void segmentColumns(const pcl::PointCloud<PointXYZIT> &cloud, int begin, int end, std::vector<uint8_t> &labels);
+
+ private:
+	GroundSegmentationConfig m_objConfig;
+	float m_fLocalSlopeTan;
+	float m_fGlobalSlopeTan;
+	int m_iLaserNum;
+	std::vector<int> m_vecRingOrder;  // laser ids from the lowest to the highest elevation
+};
+
+#endif  // _PANDAR_GROUND_SEGMENTATION_H_
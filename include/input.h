@@ -159,13 +159,11 @@ public:
 	InputSocket(std::string deviceipaddr, uint16_t lidarport = DATA_PORT_NUMBER, uint16_t gpsport = GPS_PORT_NUMBER);
 	virtual ~InputSocket();
 	virtual int getPacket(PandarPacket *pkt);
-	void calcPacketLoss(PandarPacket *pkt);
 
 private:
 	int m_iSockfd;
 	int m_iSockGpsfd;
 	int m_iSocktNumber;
-	uint32_t m_u32Sequencenum;
 };
 
 /** @brief pandar input from PCAP dump file.
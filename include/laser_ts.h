@@ -18,6 +18,7 @@
 #define LASER_TS_H_
 
 #include <map>
+#include <string>
 #include <vector>
 
 #ifndef CIRCLE
@@ -43,8 +44,8 @@ class LasersTSOffset {
     float getTSOffset(int nLaser, int nMode, int nState, float fDistance, int nMajorVersion);
     int   getBlockTS(int nBlock, int nRetMode, int nMode, int nLaserNum);
     float getAngleOffset(float nTSOffset, int speed, int nMajorVersion);
-    float getAzimuthOffset(std::string type, float azimuth, float originAzimuth, float distance);
-    float getPitchOffset(std::string type, float pitch, float distance);
+    float getAzimuthOffset(const std::string &type, float azimuth, float originAzimuth, float distance);
+    float getPitchOffset(const std::string &type, float pitch, float distance);
 
   private:
     float                              mFDist;
@@ -53,10 +54,10 @@ class LasersTSOffset {
     int                                mNLaserNum;
     std::vector<int> mShortOffsetIndex;
     std::vector<int> mLongOffsetIndex;
-    float                              mCosAllAngle[CIRCLE];
-    float                              mSinAllAngleHB[CIRCLE];
-    float                              mSinAllAngleH[CIRCLE];
-    float                              mArcSin[PAI_ANGLE];
+    // point into tables shared by all the instances, they never change after creation
+    const float                        *mSinAllAngleHB;
+    const float                        *mSinAllAngleH;
+    const float                        *mArcSin;
     float                              m_fAzimuthOffset[PANDAR128_LIDAR_NUM];
     float                              m_fCDAAzimuthOffset[PANDAR128_LIDAR_NUM];
     float                              m_fCDBAzimuthOffset[PANDAR128_LIDAR_NUM];
@@ -67,4 +68,40 @@ class LasersTSOffset {
     float asinAngle(float value);
 };
 
+// per point in the decoders, inline so that a constant version folds the switch
+inline float LasersTSOffset::getTSOffset(int nLaser, int nMode, int nState, float fDistance, int nMajorVersion) {
+  switch (nMajorVersion){
+    case 1:
+      if (nLaser >= mNLaserNum || !mBInitFlag) {
+        return 0;
+      }
+      if (fDistance >= mFDist) {
+        return mVLasers[nLaser][mLongOffsetIndex[nMode * 10 + nState]];
+      } 
+      else {
+        return mVLasers[nLaser][mShortOffsetIndex[nMode * 10 + nState]];
+      }
+    case 3:
+      switch (nMode){
+        case 0:
+          return m_fCDAAzimuthOffset[nLaser];
+        case 1:
+          return m_fCDBAzimuthOffset[nLaser];
+      }
+    default:
+      return 0;
+  }
+}
+
+inline float LasersTSOffset::getAngleOffset(float nTSOffset, int speed, int nMajorVersion) {
+  switch (nMajorVersion){
+    case 1:
+      return nTSOffset * speed * 6E-9;
+    case 3:
+      return nTSOffset * speed * 6E-6;
+    default:
+      return 0;
+  }
+}
+
 #endif  // ASER_TS_H_
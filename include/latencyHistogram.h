@@ -0,0 +1,78 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Lock free latency histogram in the spirit of HdrHistogram.
+
+    Values are microseconds. Values below 32 get one bucket each, larger
+    values 16 log-linear buckets per power of two, so every recorded value
+    is kept within 1/16 of its magnitude. record() is a handful of relaxed
+    atomic operations, getSnapshot() may run concurrently from any thread.
+*/
+
+#ifndef _PANDAR_LATENCY_HISTOGRAM_H_
+#define _PANDAR_LATENCY_HISTOGRAM_H_ 1
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+
+#define LATENCY_LINEAR_BUCKETS (32)
+#define LATENCY_SUB_BUCKET_BITS (4)
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_MAGNITUDE (40)  // 2^40 us, about 12 days
+#define LATENCY_BUCKET_NUM (LATENCY_LINEAR_BUCKETS + (LATENCY_MAX_MAGNITUDE - 5) * LATENCY_SUB_BUCKETS)
+
+typedef struct LatencySnapshot_s {
+	uint64_t u64Count;
+	uint64_t u64MinUs;
+	uint64_t u64MaxUs;
+	double dMeanUs;
+	uint64_t u64P50Us;
+	uint64_t u64P90Us;
+	uint64_t u64P99Us;
+	uint64_t u64P999Us;
+} LatencySnapshot;
+
+class LatencyHistogram {
+ public:
+	LatencyHistogram();
+	inline void record(uint64_t us) {
+		m_arrBuckets[bucketIndex(us)].fetch_add(1, boost::memory_order_relaxed);
+		m_u64Count.fetch_add(1, boost::memory_order_relaxed);
+		m_u64Sum.fetch_add(us, boost::memory_order_relaxed);
+		uint64_t max = m_u64Max.load(boost::memory_order_relaxed);
+		while (us > max && !m_u64Max.compare_exchange_weak(max, us, boost::memory_order_relaxed)) {}
+		uint64_t min = m_u64Min.load(boost::memory_order_relaxed);
+		while (us < min && !m_u64Min.compare_exchange_weak(min, us, boost::memory_order_relaxed)) {}
+	}
+	LatencySnapshot getSnapshot();
+	void reset();
+
+ private:
+	static inline int bucketIndex(uint64_t us) {
+		if(us < LATENCY_LINEAR_BUCKETS) {
+			return static_cast<int>(us);
+		}
+		int magnitude = 63 - __builtin_clzll(us);
+		if(magnitude >= LATENCY_MAX_MAGNITUDE) {
+			return LATENCY_BUCKET_NUM - 1;
+		}
+		int sub = static_cast<int>(us >> (magnitude - LATENCY_SUB_BUCKET_BITS)) - LATENCY_SUB_BUCKETS;
+		return LATENCY_LINEAR_BUCKETS + (magnitude - 5) * LATENCY_SUB_BUCKETS + sub;
+	}
+	static uint64_t bucketUpperBound(int index);
+
+	boost::atomic<uint64_t> m_arrBuckets[LATENCY_BUCKET_NUM];
+	boost::atomic<uint64_t> m_u64Count;
+	boost::atomic<uint64_t> m_u64Sum;
+	boost::atomic<uint64_t> m_u64Max;
+	boost::atomic<uint64_t> m_u64Min;
+};
+
+#endif  // _PANDAR_LATENCY_HISTOGRAM_H_
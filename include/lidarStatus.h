@@ -0,0 +1,91 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Background poller of the sensor status over PTC.
+
+    Every period a PTC_COMMAND_GET_LIDAR_STATUS request is queued on the
+    SDK's command client, at most one is in flight, so a slow sensor is
+    never buried in requests. The reply arrives on the client's worker
+    thread and is published as a seqlock snapshot: getStatus() takes no
+    lock and never blocks the writer, the decode path may call it freely.
+*/
+
+#ifndef _PANDAR_LIDAR_STATUS_H_
+#define _PANDAR_LIDAR_STATUS_H_ 1
+
+#include <stdint.h>
+#include <string.h>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include "tcp_command_client.h"
+
+#define PTC_LIDAR_STATUS_MIN_SIZE (49)  // the fields below, the reserved tail is not required
+#define LIDAR_STATUS_TEMPERATURE_NUM (8)
+
+typedef enum {
+	PTP_STATUS_FREE_RUN = 0,
+	PTP_STATUS_TRACKING,
+	PTP_STATUS_LOCKED,
+	PTP_STATUS_FROZEN,
+} PTP_STATUS;
+
+typedef struct LidarStatus_s {
+	uint64_t u64UpdateUs;     // GetMicroTickCountU64 of the last reply, 0: never answered
+	uint32_t u32Failures;     // consecutive polls without a reply since then
+	uint8_t u8RetCode;        // PTC return code of the last reply, non zero: the lidar refused
+	uint32_t u32Uptime;       // seconds
+	uint16_t u16MotorSpeed;   // rpm
+	float fTemperature[LIDAR_STATUS_TEMPERATURE_NUM];  // degree celsius, in the order of the lidar manual
+	uint8_t u8GpsPpsLock;     // 1: locked
+	uint8_t u8GpsGprmcStatus; // 1: locked
+	uint32_t u32StartupTimes;
+	uint32_t u32OperationMinutes;
+	uint8_t u8PtpStatus;      // PTP_STATUS
+	LidarStatus_s() {
+		memset(this, 0, sizeof(LidarStatus_s));
+	}
+} LidarStatus;
+
+class LidarStatusPoller {
+ public:
+	LidarStatusPoller();
+	~LidarStatusPoller();
+	/**
+	 * @brief Poll the lidar every periodms through client, a TcpCommandClientNew handle
+	 *        that must outlive stop()
+	 * @param statuscallback  optional, called with every new snapshot on the PTC worker thread
+	 * @return 0 on success, -1 if it is running already or client is NULL
+	 */
+	int start(void *client, uint32_t periodms, boost::function<void(const LidarStatus &)> statuscallback);
+	/** @brief stop polling and wait for the request in flight */
+	void stop();
+	/** @return false until the lidar answered once */
+	bool getStatus(LidarStatus &status);
+	/** @brief decode the big endian PTC status payload, @return 0 on success, -1 if it is short */
+	static int parseStatus(const uint8_t *data, uint32_t len, LidarStatus &status);
+
+ private:
+	void pollThread();
+	static void onReply(void *userdata, PTC_ErrCode error, unsigned char retcode, const unsigned char *data, unsigned int len);
+	void publish(const LidarStatus &status);
+
+	static const int m_iWordNum = (sizeof(LidarStatus) + 7) / 8;
+	void *m_pClient;
+	uint32_t m_u32Period;
+	boost::function<void(const LidarStatus &)> m_funcStatusCallback;
+	boost::thread *m_pollThread;
+	boost::atomic<bool> m_bInFlight;
+	LidarStatus m_objLast;  // written on the PTC worker thread only
+	boost::atomic<uint32_t> m_u32Sequence;  // odd while the snapshot is written
+	boost::atomic<uint64_t> m_arrSnapshot[m_iWordNum];
+};
+
+#endif  // _PANDAR_LIDAR_STATUS_H_
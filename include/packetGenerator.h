@@ -0,0 +1,118 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Synthetic lidar packets for testing without a sensor.
+
+    The packets follow the layouts decoded by PandarSwiftSDK: UDP 1.3
+    (Pandar128), 1.4 with any combination of the u8Flags sections, and 3.2
+    (QT128). The scene is a flat ground plane inside a cylindrical wall
+    around the sensor, the lasers are spread evenly over the elevation
+    range. CRC, IMU, function safety and signature sections are present
+    when flagged but zero filled, the SDK does not check them.
+*/
+
+#ifndef _PANDAR_PACKET_GENERATOR_H_
+#define _PANDAR_PACKET_GENERATOR_H_ 1
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "input.h"
+
+#define GENERATOR_FLAG_SEQ_NUM (0x01)
+#define GENERATOR_FLAG_IMU (0x02)
+#define GENERATOR_FLAG_FUNCTION_SAFETY (0x04)
+#define GENERATOR_FLAG_SIGNATURE (0x08)
+#define GENERATOR_FLAG_CONFIDENCE (0x10)
+#define GENERATOR_RETURN_MODE_STRONGEST (0x37)
+#define GENERATOR_RETURN_MODE_LAST (0x38)
+#define GENERATOR_RETURN_MODE_DUAL (0x39)
+
+typedef struct PacketGeneratorConfig_s {
+	uint8_t u8VersionMajor;   // 1 or 3
+	uint8_t u8VersionMinor;   // 3 or 4 for major 1, 2 for major 3
+	uint8_t u8Flags;          // GENERATOR_FLAG_*, UDP 1.4 and 3.2 only
+	int laserNum;             // 128, 80, 64 or 40; UDP 1.3 and 3.2 are always 128
+	int blockNum;             // blocks per packet, 0: the sensor's own
+	uint16_t u16MotorSpeed;   // rpm, 600 or 1200
+	uint8_t u8ReturnMode;     // GENERATOR_RETURN_MODE_*, dual modes fill two blocks per azimuth
+	uint8_t u8WorkMode;       // low bits of the shutdown flag, 0: high resolution
+	float fGroundHeight;      // meters of the sensor above the ground, <= 0: no ground
+	float fWallRadius;        // meters of the cylindrical wall around the sensor
+	float fMinElevation;      // degrees of the lowest laser
+	float fMaxElevation;      // degrees of the highest laser
+	double dStartTime;        // unix seconds of the first packet, 0: now
+	uint32_t u32StartSeq;
+	inline PacketGeneratorConfig_s() {
+		u8VersionMajor = 1;
+		u8VersionMinor = 4;
+		u8Flags = GENERATOR_FLAG_SEQ_NUM | GENERATOR_FLAG_FUNCTION_SAFETY;
+		laserNum = 128;
+		blockNum = 0;
+		u16MotorSpeed = 600;
+		u8ReturnMode = GENERATOR_RETURN_MODE_STRONGEST;
+		u8WorkMode = 0;
+		fGroundHeight = 1.8f;
+		fWallRadius = 30.0f;
+		fMinElevation = -25.0f;
+		fMaxElevation = 15.0f;
+		dStartTime = 0;
+		u32StartSeq = 1;
+	}
+} PacketGeneratorConfig;
+
+class PacketGenerator {
+ public:
+	PacketGenerator(const PacketGeneratorConfig &config);
+	/** @brief payload bytes of every packet */
+	inline int getPacketSize() {
+		return m_iPacketSize;
+	}
+	inline int getPacketsPerFrame() {
+		return m_iPacketsPerFrame;
+	}
+	/** @brief seconds between two packets at the configured motor speed */
+	inline double getPacketInterval() {
+		return m_dPacketInterval;
+	}
+	/** @brief fill the next packet, stamp is its sensor time */
+	void nextPacket(PandarPacket &pkt);
+	/**
+	 * @brief write frames rotations to a pcap file as udp packets to destport
+	 * @return packets written, -1 if the file cannot be opened
+	 */
+	int writePcap(std::string filename, uint32_t frames, uint16_t destport = 2368, std::string sourceip = "192.168.1.201");
+	/**
+	 * @brief send frames rotations over udp, 0: until the process is stopped
+	 * @param realtime  pace the packets at the sensor's packet rate, else send as fast as possible
+	 * @return packets sent, -1 if the socket cannot be created
+	 */
+	int sendUdp(std::string destip, uint16_t destport, uint32_t frames, bool realtime = true);
+
+ private:
+	uint8_t *fillBlock(uint8_t *buf, uint16_t azimuth, int returnid);
+	void fillTime(uint8_t *utc, uint32_t *timestamp, double time);
+
+	PacketGeneratorConfig m_objConfig;
+	int m_iPacketSize;
+	int m_iBlockNum;
+	int m_iReturnNum;
+	int m_iAngleStep;          // 0.01 degree per azimuth
+	int m_iPacketsPerFrame;
+	double m_dPacketInterval;
+	int m_iUnitSize;
+	std::vector<uint16_t> m_vecDistance;   // distance units per laser, the scene is rotation symmetric
+	std::vector<uint8_t> m_vecIntensity;
+	uint64_t m_u64PacketIndex;
+	uint32_t m_u32Seq;
+	uint16_t m_u16Azimuth;
+};
+
+#endif  // _PANDAR_PACKET_GENERATOR_H_
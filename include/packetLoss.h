@@ -0,0 +1,80 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Per-sensor packet loss accounting from the udp sequence number.
+
+    The last PACKET_LOSS_WINDOW sequence numbers are kept in a bitmap, so a
+    late packet is told apart from a duplicate and taken back out of the
+    lost count. A jump beyond PACKET_LOSS_MAX_GAP, or further back than the
+    window, is a sensor restart and starts the sequence again. After a
+    restart the window only covers the numbers from the restart on, an older
+    packet still in flight is counted as stale.
+    push() runs on the receive thread only; getStats() may be called from
+    any thread.
+*/
+
+#ifndef _PANDAR_PACKET_LOSS_H_
+#define _PANDAR_PACKET_LOSS_H_ 1
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+#include "input.h"
+
+#define PACKET_LOSS_WINDOW (1024)
+#define PACKET_LOSS_MAX_GAP (100000)
+#define PACKET_LOSS_BURST_BUCKETS (10)   // gap length 1, 2, 3-4, 5-8, ... 129-256, > 256
+
+typedef struct PacketLossStats_s {
+	uint64_t u64Received;     // packets carrying a sequence number
+	uint64_t u64Lost;         // sequence numbers missing and not received later
+	uint64_t u64Gaps;         // forward jumps in the sequence
+	uint64_t u64Reordered;    // packets that arrived after a later one
+	uint64_t u64Duplicates;
+	uint64_t u64Stale;        // packets from before the last restart, not in received
+	uint64_t u64Restarts;
+	uint64_t arrBurst[PACKET_LOSS_BURST_BUCKETS];  // gaps by length, counted when detected
+	double dLossRate;         // lost / (received + lost)
+} PacketLossStats;
+
+class PacketLossCounter {
+ public:
+	PacketLossCounter();
+	/** @brief account one lidar packet, packets without a sequence number are ignored */
+	void push(const PandarPacket &pkt);
+	PacketLossStats getStats();
+	void reset();
+	/** @brief sequence number of a lidar packet, false if the packet has none */
+	static bool getSequenceNumber(const PandarPacket &pkt, uint32_t &seq);
+
+ private:
+	inline bool isSeen(uint32_t seq) {
+		return m_arrSeen[(seq / 64) % (PACKET_LOSS_WINDOW / 64)] & (1ull << (seq % 64));
+	}
+	inline void setSeen(uint32_t seq, bool seen) {
+		uint64_t &word = m_arrSeen[(seq / 64) % (PACKET_LOSS_WINDOW / 64)];
+		word = seen ? (word | (1ull << (seq % 64))) : (word & ~(1ull << (seq % 64)));
+	}
+	void restart(uint32_t seq);
+
+	bool m_bStarted;
+	uint32_t m_u32HighestSeq;
+	uint32_t m_u32LowestSeq;   // oldest number the window accounts for
+	uint64_t m_arrSeen[PACKET_LOSS_WINDOW / 64];
+	boost::atomic<uint64_t> m_u64Received;
+	boost::atomic<uint64_t> m_u64Lost;
+	boost::atomic<uint64_t> m_u64Gaps;
+	boost::atomic<uint64_t> m_u64Reordered;
+	boost::atomic<uint64_t> m_u64Duplicates;
+	boost::atomic<uint64_t> m_u64Stale;
+	boost::atomic<uint64_t> m_u64Restarts;
+	boost::atomic<uint64_t> m_arrBurst[PACKET_LOSS_BURST_BUCKETS];
+};
+
+#endif  // _PANDAR_PACKET_LOSS_H_
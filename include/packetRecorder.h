@@ -0,0 +1,169 @@
+/* -*- mode: C++ -*-
+ *
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *
+ *  Raw packet recorder for the Pandar LiDARs
+ *
+ *    The receive thread hands every lidar packet to PacketRecorder::push(),
+ *    which only copies it into a single producer / single consumer ring.
+ *    A dedicated I/O thread drains the ring, frames the packets as pcap or
+ *    pcapng records in a page aligned staging buffer and writes the buffer
+ *    out in large chunks. When the ring is full the packet is dropped and
+ *    counted, the receive thread is never blocked by the disk.
+ */
+
+#ifndef __PANDAR_PACKET_RECORDER_H
+#define __PANDAR_PACKET_RECORDER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include "input.h"
+
+#define PACKET_RECORDER_FORMAT_PCAP "pcap"
+#define PACKET_RECORDER_FORMAT_PCAPNG "pcapng"
+#define PACKET_RECORDER_QUEUE_SIZE (8192)
+#define PACKET_RECORDER_WRITE_CHUNK_SIZE (4 * 1024 * 1024)
+#define PACKET_RECORDER_IO_ALIGN (4096)
+#define PACKET_RECORDER_FLUSH_INTERVAL_MS (1000)
+#define PACKET_RECORDER_NET_HEADER_SIZE (42)
+#define PCAP_MAGIC (0xa1b2c3d4)
+#define PCAP_LINKTYPE_ETHERNET (1)
+#define PCAP_SNAPLEN (65535)
+#define RECORDER_UDP_SOURCE_PORT (10000)
+
+typedef struct __attribute__((__packed__)) PcapFileHeader_s {
+	uint32_t u32Magic;
+	uint16_t u16VersionMajor;
+	uint16_t u16VersionMinor;
+	int32_t i32ThisZone;
+	uint32_t u32Sigfigs;
+	uint32_t u32Snaplen;
+	uint32_t u32LinkType;
+} PcapFileHeader;
+
+typedef struct __attribute__((__packed__)) PcapRecordHeader_s {
+	uint32_t u32Sec;
+	uint32_t u32Usec;
+	uint32_t u32CapLen;
+	uint32_t u32OrigLen;
+} PcapRecordHeader;
+
+typedef struct PacketRecorderConfig_s {
+	std::string filePrefix;     // files are named <filePrefix>_<YYYYmmdd_HHMMSS>_<index>.<format>
+	std::string format;         // PACKET_RECORDER_FORMAT_PCAP or PACKET_RECORDER_FORMAT_PCAPNG
+	uint64_t u64RotateSize;     // start a new file after this many bytes, 0: never
+	uint32_t u32RotateSeconds;  // start a new file after this many seconds, 0: never
+	uint32_t u32QueueSize;      // packets buffered between receive and I/O thread
+	uint32_t u32WriteChunkSize; // bytes per write(), rounded up to PACKET_RECORDER_IO_ALIGN
+	bool bDirectIO;             // open the files with O_DIRECT
+	std::string sourceIpAddr;   // source address of the synthesized IPv4 header, "": device ip
+	uint16_t u16DestPort;       // destination port of the synthesized UDP header, 0: lidar port
+	inline PacketRecorderConfig_s() {
+		format = PACKET_RECORDER_FORMAT_PCAP;
+		u64RotateSize = 0;
+		u32RotateSeconds = 0;
+		u32QueueSize = PACKET_RECORDER_QUEUE_SIZE;
+		u32WriteChunkSize = PACKET_RECORDER_WRITE_CHUNK_SIZE;
+		bDirectIO = false;
+		sourceIpAddr = "";
+		u16DestPort = 0;
+	}
+} PacketRecorderConfig;
+
+typedef struct PacketRecorderStats_s {
+	uint64_t u64PushedPackets;   // packets offered by the receive thread
+	uint64_t u64WrittenPackets;  // packets that reached the disk
+	uint64_t u64WrittenBytes;    // bytes written including file and record headers
+	uint64_t u64DroppedPackets;  // packets dropped because the queue was full
+	uint64_t u64FailedPackets;   // packets lost because write() failed
+	uint32_t u32FileCount;       // files opened since start()
+	bool bRecording;
+} PacketRecorderStats;
+
+typedef struct RecordPacket_s {
+	double stamp;
+	uint32_t size;
+	uint8_t data[ETHERNET_MTU];
+} RecordPacket;
+
+/** @brief ethernet / IPv4 / UDP header of PACKET_RECORDER_NET_HEADER_SIZE bytes in front of a lidar payload */
+void buildPcapNetHeader(uint8_t *buf, uint32_t sourceaddr, uint16_t destport, uint16_t ipid, uint32_t payloadSize);
+
+class PacketRecorder {
+ public:
+	PacketRecorder();
+	~PacketRecorder();
+
+	/** @brief open the first file and start the I/O thread
+	 *
+	 *  @returns 0 if successful, -1 if the recorder is running or the file can't be opened
+	 */
+	int start(const PacketRecorderConfig &config);
+	/** @brief write out the queued packets, close the file and stop the I/O thread */
+	void stop();
+	/** @brief queue one packet, never blocks; called from the receive thread */
+	inline void push(const PandarPacket &pkt) {
+		if(!m_bRecording.load(boost::memory_order_acquire))
+			return;
+		m_u64PushedPackets.fetch_add(1, boost::memory_order_relaxed);
+		uint32_t tail = m_u32QueueTail.load(boost::memory_order_relaxed);
+		uint32_t next = tail + 1 == m_vecQueue.size() ? 0 : tail + 1;
+		if(next == m_u32QueueHead.load(boost::memory_order_acquire)) {
+			m_u64DroppedPackets.fetch_add(1, boost::memory_order_relaxed);
+			return;
+		}
+		RecordPacket &slot = m_vecQueue[tail];
+		slot.stamp = pkt.stamp > 0 ? pkt.stamp : getNowTimeSec();  // receive time of the packet
+		slot.size = pkt.size > ETHERNET_MTU ? ETHERNET_MTU : pkt.size;
+		memcpy(slot.data, pkt.data, slot.size);
+		m_u32QueueTail.store(next, boost::memory_order_release);
+	}
+	PacketRecorderStats getStats();
+
+ private:
+	void ioThread();
+	int openFile();
+	void closeFile();
+	void appendPacket(const RecordPacket &pkt);
+	void appendBytes(const void *data, uint32_t len);
+	void flush(bool all);
+	void buildNetHeader(uint8_t *buf, uint32_t payloadSize);
+
+	PacketRecorderConfig m_objConfig;
+	std::vector<RecordPacket> m_vecQueue;
+	boost::atomic<uint32_t> m_u32QueueHead;
+	boost::atomic<uint32_t> m_u32QueueTail;
+	boost::thread *m_pIoThread;
+	boost::atomic<bool> m_bRecording;
+	boost::atomic<bool> m_bStopRequest;
+	boost::atomic<uint64_t> m_u64PushedPackets;
+	boost::atomic<uint64_t> m_u64WrittenPackets;
+	boost::atomic<uint64_t> m_u64WrittenBytes;
+	boost::atomic<uint64_t> m_u64DroppedPackets;
+	boost::atomic<uint64_t> m_u64FailedPackets;
+	boost::atomic<uint32_t> m_u32FileCount;
+	int m_iFd;
+	bool m_bFileDirect;
+	uint8_t *m_pStaging;
+	uint32_t m_u32StagingSize;
+	uint32_t m_u32StagingUsed;
+	uint32_t m_u32StagingPackets;
+	uint64_t m_u64FileBytes;
+	uint32_t m_u32FileOpenTick;
+	uint32_t m_u32LastFlushTick;
+	uint32_t m_u32SourceAddr;
+	uint16_t m_u16IpId;
+};
+
+#endif // __PANDAR_PACKET_RECORDER_H
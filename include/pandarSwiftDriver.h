@@ -17,6 +17,7 @@
 
 #include <string>
 #include <input.h>
+#include "packetRecorder.h"
 
 #define PANDAR128_READ_PACKET_SIZE (1800)
 #define PANDARQT128_READ_PACKET_SIZE (200)
@@ -29,6 +30,8 @@ typedef struct PandarGPS_s PandarGPS;
 typedef std::array<PandarPacket, PANDAR128_READ_PACKET_SIZE> PandarPacketsArray;
 class PandarSwiftSDK;
 
+int parseGPS(PandarGPS *packet, const uint8_t *recvbuf, const int size);
+
 class PandarSwiftDriver {
  public:
 	PandarSwiftDriver(std::string deviceipaddr, uint16_t lidarport, uint16_t gpsport, std::string frameid, std::string pcapfile,
@@ -44,12 +47,18 @@ class PandarSwiftDriver {
 	void publishRawData();
 	void setUdpVersion(uint8_t major, uint8_t minor);
 	int getPandarScanArraySize(boost::shared_ptr<Input>);
+	int startRecord(const PacketRecorderConfig &config);
+	void stopRecord();
+	PacketRecorderStats getRecorderStats();
 
  private:
 
 	boost::shared_ptr<Input> m_spInput;
+	boost::shared_ptr<PacketRecorder> m_spPacketRecorder;
 	boost::function<void(PandarPacketsArray*)> m_funcRawCallback;
 	std::string m_sFrameId;
+	std::string m_sDeviceIpAddr;
+	uint16_t m_u16LidarPort;
 	std::array<PandarPacketsArray, 2> m_arrPandarPackets;
 	bool m_bNeedPublish;
 	int m_iPktPushIndex;
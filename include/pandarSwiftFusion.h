@@ -0,0 +1,109 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    PandarSwiftFusion publishes one cloud for several lidars.
+
+    Every sensor transforms its points into the common frame with its
+    extrinsic matrix while the packets are decoded. The fusion collects one
+    frame per sensor, and when the frames of all the sensors lie within the
+    sync tolerance they are merged into a single cloud tagged by sensor id.
+    A sensor that sent no frame for the sensor timeout is left out, the
+    others are published as a partial cloud that names the missing ones.
+
+    With a pose interpolator every sensor deskews its frame while decoding
+    to a reference time shared by the frames of one fusion cycle, the first
+    packet time of the frame that opened the cycle. It is the timestamp of
+    each of these frames and of the fused cloud, the points are moved once.
+*/
+
+#ifndef _PANDAR_SWIFT_FUSION_H_
+#define _PANDAR_SWIFT_FUSION_H_ 1
+
+#include <boost/thread/mutex.hpp>
+#include "pandarSwiftManager.h"
+
+#define FUSION_SYNC_TOLERANCE (0.05)  // seconds, half a frame at 10 Hz
+#define FUSION_SENSOR_TIMEOUT (0.3)   // seconds, three frames at 10 Hz
+
+typedef PointXYZITS PFusedPoint;
+typedef pcl::PointCloud<PFusedPoint> PFusedPointCloud;
+
+typedef struct PandarFusionStats_s {
+	uint64_t u64PublishedFrames;
+	uint64_t u64DroppedFrames;  // sensor frames that could not be aligned
+	uint64_t u64PartialFrames;  // published without the sensors that timed out
+} PandarFusionStats;
+
+class PandarSwiftFusion {
+ public:
+	/**
+	 * @brief Constructor
+	 * @param fusedcallback     The callback of the merged cloud and its earliest timestamp
+	 *        frameid           The frame id of the merged cloud
+	 *        synctolerance     The max timestamp gap between the merged frames, in seconds
+	 *        receivethreadnum  The receive threads shared by all the sensors
+	 */
+	PandarSwiftFusion(boost::function<void(boost::shared_ptr<PFusedPointCloud>, double)> fusedcallback, \
+						std::string frameid = "vehicle", double synctolerance = FUSION_SYNC_TOLERANCE, \
+						int receivethreadnum = MANAGER_RECEIVE_THREAD_NUM);
+	~PandarSwiftFusion();
+
+	/**
+	 * @brief Add a sensor, must be called before start()
+	 * @param config     The sensor config, its pclcallback is replaced by the fusion
+	 *        extrinsic  row-major 4x4 matrix from the lidar frame to the fused frame
+	 * @return the sensor id used in PFusedPoint::sensor_id, -1 if failed
+	 */
+	int addSensor(PandarSensorConfig config, const float *extrinsic);
+	/**
+	 * @brief Publish without the sensors that sent no frame for timeout seconds of the
+	 *        sensor timestamps, must be called before start()
+	 * @param timeout          0: wait for every sensor
+	 *        partialcallback  receives the partial cloud and the ids of the missing sensors;
+	 *                         NULL: partial clouds go to the fused callback
+	 */
+	void setSensorTimeout(double timeout, \
+						boost::function<void(boost::shared_ptr<PFusedPointCloud>, double, const std::vector<int> &)> partialcallback = NULL);
+	/**
+	 * @brief Deskew every sensor to the fused timestamp, must be called after the
+	 *        sensors are added and before start()
+	 * @param interpolator  ego motion of the fused frame, NULL: merge the frames as they are
+	 */
+	void setPoseInterpolator(boost::shared_ptr<PoseInterpolator> interpolator);
+	int start();
+	void stop();
+	PandarFusionStats getStats();
+
+ private:
+	typedef struct FusionSlot_s {
+		boost::shared_ptr<PPointCloud> cloud;  // held, the sdk decodes its next frame into another one
+		double timestamp;
+		double lastTimestamp;  // of the last frame the sensor sent, a timeout is counted from it
+		bool ready;
+	} FusionSlot;
+
+	void onSensorFrame(int id, boost::shared_ptr<PPointCloud> cld, double timestamp);
+	double getDeskewReference(double frametime);
+
+	PandarSwiftManager m_objManager;
+	boost::function<void(boost::shared_ptr<PFusedPointCloud>, double)> m_funcFusedCallback;
+	std::string m_sFrameId;
+	double m_dSyncTolerance;
+	double m_dSensorTimeout;
+	boost::function<void(boost::shared_ptr<PFusedPointCloud>, double, const std::vector<int> &)> m_funcPartialCallback;
+	boost::mutex m_mtxSlots;
+	double m_dReferenceTime;  // deskew reference of the current fusion cycle
+	std::vector<FusionSlot> m_vecSlots;
+	uint64_t m_u64PublishedFrames;
+	uint64_t m_u64DroppedFrames;
+	uint64_t m_u64PartialFrames;
+};
+
+#endif  // _PANDAR_SWIFT_FUSION_H_
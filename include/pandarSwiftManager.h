@@ -0,0 +1,98 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    PandarSwiftManager hosts several Pandar LiDARs in one process.
+
+    Every sensor keeps its own PandarSwiftSDK for frame assembly, but the
+    UDP sockets are served by a small pool of receive threads which
+    demultiplex the packets by source ip and destination port. The decode
+    executor and the trigonometric tables are shared by all the sensors.
+*/
+
+#ifndef _PANDAR_SWIFT_MANAGER_H_
+#define _PANDAR_SWIFT_MANAGER_H_ 1
+
+#include <map>
+#include <vector>
+#include "pandarSwiftSDK.h"
+
+#define MANAGER_RECEIVE_THREAD_NUM (2)
+#define MANAGER_RECEIVE_BATCH_SIZE (64)
+#define MANAGER_SOCKET_RECV_BUF (26214400)
+
+typedef struct PandarSensorConfig_s {
+	std::string deviceipaddr;   // "" accepts any source on lidarport
+	uint16_t lidarport;
+	uint16_t gpsport;           // 0: no gps
+	std::string frameid;
+	std::string correctionfile;
+	std::string firtimeflie;
+	boost::function<void(boost::shared_ptr<PPointCloud>, double)> pclcallback;
+	boost::function<void(double)> gpscallback;
+	std::string certFile;
+	std::string privateKeyFile;
+	std::string caFile;
+	int startangle;
+	int timezone;
+	bool coordinateCorrectionFlag;
+	inline PandarSensorConfig_s() {
+		lidarport = 2368;
+		gpsport = 0;
+		frameid = "Pandar128";
+		startangle = 0;
+		timezone = 0;
+		coordinateCorrectionFlag = false;
+	}
+} PandarSensorConfig;
+
+class PandarSwiftManager {
+ public:
+	/**
+	 * @brief Constructor
+	 * @param receivethreadnum  number of threads serving all the sensor sockets
+	 */
+	PandarSwiftManager(int receivethreadnum = MANAGER_RECEIVE_THREAD_NUM);
+	~PandarSwiftManager();
+
+	/**
+	 * @brief Add a sensor, must be called before start()
+	 * @return the sensor id, -1 if the sensor can't be added
+	 */
+	int addSensor(const PandarSensorConfig &config);
+	/** @brief open the sockets and start the receive threads */
+	int start();
+	/** @brief stop the receive threads and all the sensors */
+	void stop();
+	boost::shared_ptr<PandarSwiftSDK> getSensor(int id);
+	int getSensorNum();
+
+ private:
+	typedef struct ManagerSocket_s {
+		int fd;
+		uint16_t port;
+	} ManagerSocket;
+
+	void receiveThread(int index);
+	int openSocket(uint16_t port);
+	void dispatchPacket(uint16_t port, uint32_t sourceaddr, PandarPacket &pkt);
+	int findSensor(uint16_t port, uint32_t sourceaddr);
+
+	int m_iReceiveThreadNum;
+	bool m_bStarted;
+	std::vector<boost::shared_ptr<PandarSwiftSDK> > m_vecSensors;
+	std::vector<PandarSensorConfig> m_vecSensorConfigs;
+	std::map<uint64_t, int> m_mapLidarRoute;  // (source ip, port) -> sensor id
+	std::map<uint64_t, int> m_mapGpsRoute;
+	std::vector<ManagerSocket> m_vecSockets;
+	std::vector<std::vector<ManagerSocket> > m_vecThreadSockets;
+	std::vector<boost::thread *> m_vecReceiveThreads;
+};
+
+#endif  // _PANDAR_SWIFT_MANAGER_H_
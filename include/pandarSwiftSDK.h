@@ -19,8 +19,10 @@
 #ifndef _PANDAR_POINTCLOUD_PANDAR128SDK_H_
 #define _PANDAR_POINTCLOUD_PANDAR128SDK_H_ 1
 
+#include <float.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <bitset>
 #include <pcl/io/pcd_io.h>
 #include <pcl/point_types.h>
 #include <boost/atomic.hpp>
@@ -29,6 +31,18 @@
 #include "laser_ts.h"
 #include "tcp_command_client.h"
 #include "point_types.h"
+#include "poseInterpolator.h"
+#include "voxelGrid.h"
+#include "groundSegmentation.h"
+#include "dualReturn.h"
+#include "backgroundModel.h"
+#include "latencyHistogram.h"
+#include "packetLoss.h"
+#include "traceRecorder.h"
+#include "calibrationCache.h"
+#include "lidarStatus.h"
+#include "shmFrameRing.h"
+#include "frameWriter.h"
 #include <boost/thread.hpp>
 
 #ifndef CIRCLE
@@ -37,6 +51,7 @@
 
 #define PANDARSDK_TCP_COMMAND_PORT (9347)
 #define LIDAR_DATA_TYPE "lidar"
+#define MANAGER_DATA_TYPE "manager"  // packets are pushed by PandarSwiftManager
 #define LIDAR_ANGLE_SIZE_10 (10)
 #define LIDAR_ANGLE_SIZE_18 (18)
 #define LIDAR_ANGLE_SIZE_20 (20)
@@ -109,6 +124,7 @@
 
 #define TASKFLOW_STEP_SIZE (225)
 #define PANDARQT128_TASKFLOW_STEP_SIZE (100)
+#define GROUND_SECTOR_NUM (64)
 #define PANDAR128_CRC_SIZE (4)
 #define PANDAR128_FUNCTION_SAFETY_SIZE (17)
 
@@ -238,24 +254,52 @@ struct PandarGPS_s {
 };
 
 typedef std::array<PandarPacket, 36000> PktArray;
+typedef std::array<uint16_t, std::tuple_size<PktArray>::value> AzimuthArray;
+
+// azimuths of the first and the last block, 1.3 blocks always hold 128 units
+inline void getPacketAzimuths(const PandarPacket &pkt, uint16_t &first, uint16_t &last) {
+  const uint8_t *data = pkt.data;
+  int blockNum = PANDAR128_BLOCK_NUM;
+  int blockSize = PANDAR128_BLOCK_SIZE;
+  if(1 != data[PANDAR_MAJOR_VERSION_INDEX] || 3 != data[PANDAR_MAJOR_VERSION_INDEX + 1]) {
+    const Pandar128HeadVersion14 *header = reinterpret_cast<const Pandar128HeadVersion14 *>(data);
+    blockNum = header->u8BlockNum;
+    blockSize = PANDAR128_AZIMUTH_SIZE + header->u8LaserNum *
+                (header->hasConfidence() ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE);
+  }
+  int lastIndex = PANDAR128_HEAD_SIZE + (blockNum > 1 ? blockNum - 1 : 0) * blockSize;
+  memcpy(&first, data + PANDAR128_HEAD_SIZE, sizeof(uint16_t));
+  if(lastIndex + sizeof(uint16_t) > sizeof(pkt.data)) {
+    last = first;
+    return;
+  }
+  memcpy(&last, data + lastIndex, sizeof(uint16_t));
+}
 
 typedef struct PacketsBuffer_s {
     PktArray m_buffers{};
+    AzimuthArray m_firstAzimuths{};  // taken from every packet as it is pushed
+    AzimuthArray m_lastAzimuths{};
     PktArray::iterator m_iterPush;
     PktArray::iterator m_iterTaskBegin;
     PktArray::iterator m_iterTaskEnd;
     int m_stepSize;
     bool m_startFlag;
+    bool m_lastOverflowed;
+    int m_lastOverflowIndex;
     inline PacketsBuffer_s() {
         m_stepSize = TASKFLOW_STEP_SIZE;
         m_iterPush = m_buffers.begin();
         m_iterTaskBegin = m_buffers.begin();
         m_iterTaskEnd = m_iterTaskBegin + m_stepSize;
         m_startFlag = false;
+        m_lastOverflowed = false;
+        m_lastOverflowIndex = -1;
     }
 
     inline int push_back(PandarPacket pkt) {
         if(!m_startFlag) {
+			recordAzimuths(pkt);
 			*(m_iterPush++) = pkt;
 			m_startFlag = true;
           	return 1;
@@ -264,20 +308,19 @@ typedef struct PacketsBuffer_s {
           	if(m_buffers.end() == m_iterPush) {
             	m_iterPush = m_buffers.begin();
           	}
-			static bool lastOverflowed = false;
 			if(m_iterPush == m_iterTaskBegin) {
-				static uint32_t tmp = m_iterTaskBegin - m_buffers.begin();
-				if(m_iterTaskBegin - m_buffers.begin() != tmp) {
+				if(m_iterTaskBegin - m_buffers.begin() != m_lastOverflowIndex) {
 					printf("buffer don't have space!,%d\n",m_iterTaskBegin - m_buffers.begin());
-					tmp = m_iterTaskBegin - m_buffers.begin();
+					m_lastOverflowIndex = m_iterTaskBegin - m_buffers.begin();
 				}
-				lastOverflowed = true;
+				m_lastOverflowed = true;
 				return 0;
 			}
-			if(lastOverflowed) {
-				lastOverflowed = false;
+			if(m_lastOverflowed) {
+				m_lastOverflowed = false;
 				printf("buffer recovered\n");
 			}
+			recordAzimuths(pkt);
 			*(m_iterPush++) = pkt;
 			return 1;
         }
@@ -288,6 +331,13 @@ typedef struct PacketsBuffer_s {
               (m_iterPush < m_iterTaskBegin && m_iterPush < m_iterTaskEnd));
     }
 
+    inline void recordAzimuths(const PandarPacket &pkt) {
+      int index = m_iterPush - m_buffers.begin();
+      getPacketAzimuths(pkt, m_firstAzimuths[index], m_lastAzimuths[index]);
+    }
+    inline uint16_t getFirstAzimuth(PktArray::iterator iter) { return m_firstAzimuths[iter - m_buffers.begin()]; }
+    inline uint16_t getLastAzimuth(PktArray::iterator iter) { return m_lastAzimuths[iter - m_buffers.begin()]; }
+
     inline PktArray::iterator getTaskBegin() { return m_iterTaskBegin; }
     inline PktArray::iterator getTaskEnd() { return m_iterTaskEnd; }
 	inline void moveTaskEnd(PktArray::iterator iter) {
@@ -311,6 +361,55 @@ typedef struct PacketsBuffer_s {
     }
 } PacketsBuffer;
 
+typedef struct PandarSwiftStats_s {
+  uint64_t u64Packets;              // packets accepted into the buffer
+  uint64_t u64DroppedPackets;       // packets dropped because the buffer was full
+  uint64_t u64BufferOverflows;      // times the buffer ran full
+  uint64_t u64RedundantPoints;      // points carried over to the next frame
+  uint64_t u64Frames;
+  LatencySnapshot receive;          // socket / pcap read to pushLiDARData
+  LatencySnapshot bufferWait;       // packet arrival to its decode task start
+  LatencySnapshot decode;           // one decode task
+  LatencySnapshot frameAssembly;    // start angle crossed to frame handed to the publisher
+  LatencySnapshot callback;         // all user callbacks of one frame
+} PandarSwiftStats;
+
+/**
+ * Angle correction and firetimes of one sensor. A table is never changed
+ * once the decode workers can see it, a new calibration is a new table that
+ * replaces the old one between two frames; the last frame using the old
+ * table holds it until its tasks are done.
+ */
+typedef struct CalibrationTable_s {
+  float elevAngle[PANDAR128_LASER_NUM];
+  float horizatalAzimuth[PANDAR128_LASER_NUM];
+  LasersTSOffset laserOffset;
+} CalibrationTable;
+
+typedef struct PointFilterConfig_s {
+  float minRange;                                   // meters
+  float maxRange;                                   // meters, 0: no limit
+  uint8_t minIntensity;
+  std::bitset<PANDAR128_LASER_NUM> ringMask;        // bit n keeps ring n + 1
+  std::vector<std::pair<float, float> > azimuthSectors;  // kept [start, end) in degrees, may wrap, empty: all
+  bool cropBoxEnable;
+  bool cropBoxNegative;                             // true: drop the points inside the box (e.g. the vehicle body)
+  float cropBoxMin[3];                              // in the output frame, after the extrinsic
+  float cropBoxMax[3];
+  inline PointFilterConfig_s() {
+    minRange = 0;
+    maxRange = 0;
+    minIntensity = 0;
+    ringMask.set();
+    cropBoxEnable = false;
+    cropBoxNegative = false;
+    for (int i = 0; i < 3; i++) {
+      cropBoxMin[i] = -FLT_MAX;
+      cropBoxMax[i] = FLT_MAX;
+    }
+  }
+} PointFilterConfig;
+
 typedef PointXYZIT PPoint;
 typedef pcl::PointCloud<PPoint> PPointCloud;
 typedef struct RedundantPoint_s {
@@ -340,13 +439,17 @@ class PandarSwiftSDK {
    *        timezone          The timezone of local
    *        publishmode       The mode of publish
    *        datatype          The model of input data
+   *        calibrationcachedir  Cache the correction fetched from the lidar here, see
+   *                          calibrationCache.h; the cached one is used at once and
+   *                          revalidated in the background. Empty: fetch while constructing
    */
 	PandarSwiftSDK(std::string deviceipaddr, uint16_t lidarport, uint16_t gpsport, std::string frameid, std::string correctionfile, std::string firtimeflie, std::string pcapfile, \
 								boost::function<void(boost::shared_ptr<PPointCloud>, double)> pclcallback, \
 								boost::function<void(PandarPacketsArray*)> rawcallback, \
 								boost::function<void(double)> gpscallback, \
 								std::string certFile, std::string privateKeyFile, std::string caFile, \
-								int startangle, int timezone, std::string publishmode, bool coordinateCorrectionFlag, std::string datatype=LIDAR_DATA_TYPE);
+								int startangle, int timezone, std::string publishmode, bool coordinateCorrectionFlag, std::string datatype=LIDAR_DATA_TYPE, \
+								std::string calibrationcachedir="");
 	~PandarSwiftSDK() {}
 
 	void driverReadThread();
@@ -356,28 +459,244 @@ class PandarSwiftSDK {
 	int processLiDARData();
 	void publishPointsThread();
   void stop();
+  /**
+   * @brief Record the received lidar packets to pcap/pcapng files
+   * @param config  output prefix, format, rotation and I/O options
+   * @return 0 if the recorder started, -1 otherwise
+   */
+  int startRecord(const PacketRecorderConfig &config);
+  void stopRecord();
+  PacketRecorderStats getRecorderStats();
+  /**
+   * @brief Write the published frames to binary PCD or columnar files on a background
+   *        I/O thread, see frameWriter.h; frames are dropped while the disk is behind
+   * @return 0 if the writer started, -1 otherwise
+   */
+  int startFrameWriter(const FrameWriterConfig &config);
+  void stopFrameWriter();
+  FrameWriterStats getFrameWriterStats();
+  /**
+   * @brief Transform the points into another frame while they are decoded
+   * @param matrix  row-major 4x4 extrinsic matrix, NULL to publish in the lidar frame
+   *
+   * Set it before the first packet is processed.
+   */
+  void setExtrinsic(const float *matrix);
+  /**
+   * @brief Deskew the points to the time of the first packet of each frame,
+   *        which is then published as the frame timestamp
+   * @param interpolator  ego motion of the lidar frame, or of the extrinsic
+   *                      frame if one is set; NULL disables deskewing
+   *        reference     maps the first packet time of a frame to the time it is
+   *                      deskewed to, called on the processing thread; NULL: that time
+   *
+   * Used from the next frame on, the frame being decoded keeps the current one.
+   */
+  void setPoseInterpolator(boost::shared_ptr<PoseInterpolator> interpolator, boost::function<double(double)> reference = NULL);
+  /**
+   * @brief Reject points while they are decoded; range, intensity and ring are
+   *        checked before any angle correction, the crop box after xyz
+   *
+   * Used from the next frame on.
+   */
+  void setPointFilter(const PointFilterConfig &config);
+  /**
+   * @brief Downsample every frame with a voxel grid filled while decoding
+   * @param config         leaf size and centroid / first hit, leafSize <= 0 disables it
+   *        voxelcallback  receives the reduced cloud next to the full frame;
+   *                       if NULL the reduced cloud is published instead of the full frame
+   *
+   * Used from the next frame on.
+   */
+  void setVoxelGrid(const VoxelGridConfig &config, boost::function<void(boost::shared_ptr<PPointCloud>, double)> voxelcallback);
+  /**
+   * @brief Label every frame as ground / obstacle, see groundSegmentation.h
+   * @param groundcallback  receives the full frame and one GROUND_LABEL_* per point
+   *
+   * Used from the next frame on.
+   */
+  void setGroundSegmentation(const GroundSegmentationConfig &config, \
+								boost::function<void(boost::shared_ptr<PPointCloud>, boost::shared_ptr<std::vector<uint8_t> >, double)> groundcallback);
+  /**
+   * @brief Learn the static background over config.learnFrames frames, then publish
+   *        the foreground points only, see backgroundModel.h
+   * @param summarycallback  receives the per-frame background summary
+   *
+   * Used from the next frame on.
+   */
+  void setBackgroundSubtraction(const BackgroundConfig &config, \
+								boost::function<void(boost::shared_ptr<BackgroundSummary>, double)> summarycallback);
+  /**
+   * @brief Publish every frame split by return as columns next to the cloud, see dualReturn.h
+   * @param returncallback  receives the return planes of the frame
+   *
+   * With config.dedupe the second return of a unit measuring the same distance as the
+   * kept first return is dropped from the cloud too. Used from the next frame on.
+   */
+  void setDualReturnOutput(const DualReturnConfig &config, \
+								boost::function<void(boost::shared_ptr<DualReturnFrame>, double)> returncallback);
+  /** @brief drop the background model and learn it again from the next frame */
+  void relearnBackground();
+  /**
+   * @brief Build new correction and firetime tables on the calling thread, the stream
+   *        switches to them at the next frame without losing packets
+   * @param correctionfile  angle correction csv, empty: fetch it from the lidar
+   *        firetimefile    firetime csv, empty: keep the current firetimes
+   * @return 0 if the tables were built, -1 if a file could not be read or parsed
+   */
+  int reloadCalibration(std::string correctionfile, std::string firetimefile);
+  /**
+   * @brief Poll motor speed, temperatures, GPS and PTP lock of the lidar every periodms
+   *        over PTC in the background, see lidarStatus.h
+   * @param statuscallback  optional, receives every poll result on the PTC thread
+   * @return 0 on success, -1 when replaying a pcap or already polling
+   */
+  int startStatusPoller(uint32_t periodms = 1000, boost::function<void(const LidarStatus &)> statuscallback = NULL);
+  /** @brief the last polled status without locking, false until the lidar answered once */
+  bool getLidarStatus(LidarStatus &status);
+  /**
+   * @brief Copy every published frame once into a POSIX shared memory ring that other
+   *        processes map read-only with ShmFrameReader, see shmFrameRing.h
+   * @param name       shm object name, e.g. "/pandar_front"
+   *        slotnum    frames in the ring, a reader has slotnum - 1 frame periods per frame
+   *        maxpoints  points per slot, 0: the largest frame of a 128 laser sensor
+   * @return 0 on success, -1 if the ring could not be created
+   *
+   * Set it before the first packet is processed, stop() removes the ring.
+   */
+  int startSharedMemoryOutput(std::string name, int slotnum = 4, uint32_t maxpoints = 0);
+  /**
+   * @brief Counters and per-stage latencies since start or the last resetStats(),
+   *        read without locking, so the fields may be a few samples apart
+   */
+  PandarSwiftStats getStats();
+  void resetStats();
+  /** @brief sequence gaps, reordered and duplicate packets of this sensor, see packetLoss.h */
+  PacketLossStats getPacketLossStats();
+  /**
+   * @brief Report the packet loss statistics every periodms from the publish thread,
+   *        without a callback a line is printed when packets were lost in the period
+   */
+  void setPacketLossCallback(boost::function<void(const PacketLossStats &)> losscallback, uint32_t periodms = 1000);
+  /**
+   * @brief Record receive, decode and publish spans of every sensor in the process,
+   *        see traceRecorder.h; the decode executor is shared, so is the timeline
+   */
+  void enableTrace(bool enabled);
+  /** @brief write the spans of the last windowsec seconds (0: all kept) as Chrome trace JSON */
+  int dumpTrace(std::string filename, double windowsec = 0);
+  /** @brief workers of the decode executor all the sensors share */
+  static int getDecodeThreadNum();
+  /** @brief parse a UDP 1.x packet into pkt, 0 on success */
+  static int parseData(Pandar128PacketVersion13 &pkt, const uint8_t *buf, const int len);
+  /**
+   * Stage entry points for test/benchmark.cc. They run on the calling thread
+   * against frame buffer 0, only on an SDK created with MANAGER_DATA_TYPE that
+   * has published a frame of the stream and was stopped.
+   */
+  /** @brief decode one packet with the kernel selected for the stream, or with calcPointXYZIT */
+  void benchmarkDecode(PandarPacket &pkt, bool dispatch = false);
+  /** @brief empty frame buffer 0 */
+  void benchmarkClearFrame();
+  /** @brief copy packets to the start of the packet buffer, the tasks below index them */
+  void benchmarkLoadPackets(const std::vector<PandarPacket> &packets);
+  /** @return isNeedPublish and moveTaskEndToStartAngle on [begin, begin + size): the size up to the start angle, 0 if not crossed */
+  int benchmarkFindFrameEnd(int begin, int size);
+  /** @brief doTaskFlow on [begin, begin + size) */
+  void benchmarkDecodeTask(int begin, int size);
 
  private:
 
-	int parseData(Pandar128PacketVersion13 &pkt, const uint8_t *buf, const int len);
-  void calcPointXYZIT(PandarPacket &pkt, int cursor);
-  void calcQT128PointXYZIT(PandarPacket &pkt, int cursor);
+  // a decode kernel handles one packet, specialized for a sensor mode
+  typedef void (PandarSwiftSDK::*DecodeKernel)(PandarPacket &pkt, int cursor);
+  void calcPointXYZIT(PandarPacket &pkt, int cursor);  // kernel picked per packet
+  template <int Minor, int LaserNum, bool Confidence, bool DualReturn, bool CoordinateCorrection>
+  void calcPandar128Points(PandarPacket &pkt, int cursor);
+  template <int LaserNum, bool Confidence, bool DualReturn>
+  void calcQT128Points(PandarPacket &pkt, int cursor);
+  template <int Minor, int LaserNum, bool Confidence>
+  DecodeKernel getPandar128Kernel(bool dualreturn, bool correction);
+  template <int LaserNum, bool Confidence>
+  DecodeKernel getQT128Kernel(bool dualreturn);
+  DecodeKernel getDecodeKernel(const uint8_t *data);
+  void selectDecodeKernel();
   void doTaskFlow(int cursor);
 	void loadOffsetFile(std::string file);
+	void publishCalibration(boost::shared_ptr<CalibrationTable> calibration);
 	void loadCorrectionFile();
 	int loadCorrectionString(std::string correctionstring);
+	int parseCorrectionString(std::string correctionstring, float *elevangle, float *azimuthoffset, int &lasernum);
+	int fetchLidarCalibration(std::string &serial, std::string &correctionstring);
+	void revalidateCalibration();
+	void applyPendingCalibration();
+	void applyPendingConfig();
+	void applyPointFilter(const PointFilterConfig &config);
+	void setPublishOutputs();
 	int checkLiadaMode();
+	void *getTcpCommandClient();
 	void init();
 	void changeAngleSize();
 	void changeReturnBlockSize();
 	void moveTaskEndToStartAngle();
+	void resetOutCloud(int cursor);
   void checkClockwise();
   void SetEnvironmentVariableTZ();
   bool isNeedPublish();
+  double getPacketTimestamp(PandarPacket &pkt);
+  bool getBlockTransform(double blocktime, float *matrix);
+  int getVoxelPartition();
+  void segmentGround(int cursor);
+  void splitReturns(int cursor);
+  inline bool isPointRejected(float distance, uint8_t intensity, int laser) {
+	return m_bFilterFlag && (distance < m_fMinRange || distance > m_fMaxRange || intensity < m_u8MinIntensity || !m_bitRingKeep[laser]);
+  }
+  // learn: false for the second return of a unit, a cell takes one observation per frame
+  inline bool isBackgroundPoint(int azimuth, int laser, float distance, bool learn) {
+	uint32_t cell = azimuth / m_iAngleSize * m_iLaserNum + laser;
+	if(m_objBackgroundModel.isLearning()) {
+		if(learn) {
+			m_objBackgroundModel.learn(cell, distance);
+		}
+		return false;
+	}
+	return m_objBackgroundModel.isBackground(cell, distance);
+  }
+  // angle in 0.01 degree the lidar turns from one azimuth to the other
+  inline int getRotatedAngle(int from, int to) {
+	int angle = (m_bClockwise ? to - from : from - to) % CIRCLE_ANGLE;
+	return angle < 0 ? angle + CIRCLE_ANGLE : angle;
+  }
+  inline void storePoint(int cursor, int index, const PPoint &point) {
+	if(m_OutMsgArray[cursor]->points[index].ring == 0){
+		m_OutMsgArray[cursor]->points[index] = point;
+	}
+	else{
+		pthread_mutex_lock(&m_RedundantPointLock);
+		m_RedundantPointBuffer.push_back(RedundantPoint{index, point});
+		pthread_mutex_unlock(&m_RedundantPointLock);
+	}
+  }
+  // one update per packet, the earliest point of the frame stamps it
+  inline void updateFrameTimestamp(double timestamp) {
+	if(0 != timestamp && (0 == m_dTimestamp || m_dTimestamp > timestamp)) {
+		m_dTimestamp = timestamp;
+	}
+  }
+  inline bool isPointCropped(const PPoint &point) {
+	bool inside = point.x >= m_fCropBoxMin[0] && point.x <= m_fCropBoxMax[0] &&
+				point.y >= m_fCropBoxMin[1] && point.y <= m_fCropBoxMax[1] &&
+				point.z >= m_fCropBoxMin[2] && point.z <= m_fCropBoxMax[2];
+	return inside == m_bCropBoxNegative;
+  }
+  inline void transformPoint(PPoint &point, const float *matrix) {
+	float x = point.x, y = point.y, z = point.z;
+	point.x = matrix[0] * x + matrix[1] * y + matrix[2] * z + matrix[3];
+	point.y = matrix[4] * x + matrix[5] * y + matrix[6] * z + matrix[7];
+	point.z = matrix[8] * x + matrix[9] * y + matrix[10] * z + matrix[11];
+  }
 
   pthread_mutex_t m_RedundantPointLock;
 	boost::shared_ptr<PandarSwiftDriver> m_spPandarDriver;
-  	LasersTSOffset m_objLaserOffset;
 	boost::function<void(boost::shared_ptr<PPointCloud> cld, double timestamp)> m_funcPclCallback;
 	boost::function<void(double timestamp)> m_funcGpsCallback;
 	std::array<boost::shared_ptr<PPointCloud>, 2> m_OutMsgArray;
@@ -386,10 +705,8 @@ class PandarSwiftSDK {
 	double m_dTimestamp;
 	int m_iLidarRotationStartAngle;
     int m_iTimeZoneSecond;
-	float m_fCosAllAngle[CIRCLE];
-	float m_fSinAllAngle[CIRCLE];
-	float m_fElevAngle[PANDAR128_LASER_NUM];
-	float m_fHorizatalAzimuth[PANDAR128_LASER_NUM];
+	const float *m_fCosAllAngle;  // shared by all the instances, see allAngleTable()
+	const float *m_fSinAllAngle;
 	std::string m_sFrameId;
 	std::string m_sLidarFiretimeFile;
 	std::string m_sLidarCorrectionFile;
@@ -404,7 +721,8 @@ class PandarSwiftSDK {
   int m_iLaserNum;
 	int m_iAngleSize;  // 10->0.1degree,20->0.2degree
 	int m_iReturnBlockSize;
-	bool m_bPublishPointsFlag;
+	DecodeKernel m_pfnDecodeKernel;  // chosen when the mode changes
+	boost::atomic<bool> m_bPublishPointsFlag;
 	int m_iPublishPointsIndex;
 	void *m_pTcpCommandClient;
 	std::string m_sDeviceIpAddr;
@@ -416,6 +734,99 @@ class PandarSwiftSDK {
   int m_iLastAzimuthIndex;
   bool m_bClockwise;
   bool m_bCoordinateCorrectionFlag;
+  bool m_bExtrinsicFlag;
+  float m_fExtrinsic[12];  // upper 3 rows of the extrinsic matrix
+  boost::shared_ptr<PoseInterpolator> m_spPoseInterpolator;  // replaced by the processing thread between frames only
+  boost::function<double(double)> m_funcDeskewReference;
+  bool m_bNewFrame;
+  bool m_bFilterFlag;
+  float m_fMinRange;
+  float m_fMaxRange;
+  uint8_t m_u8MinIntensity;
+  std::bitset<PANDAR128_LASER_NUM> m_bitRingKeep;
+  std::vector<uint8_t> m_vecAzimuthKeep;  // per 0.01 degree
+  bool m_bCropBoxFlag;
+  bool m_bCropBoxNegative;
+  float m_fCropBoxMin[3];
+  float m_fCropBoxMax[3];
+  bool m_bVoxelFlag;
+  VoxelGrid m_objVoxelGrid;
+  boost::function<void(boost::shared_ptr<PPointCloud> cld, double timestamp)> m_funcVoxelCallback;
+  std::array<boost::shared_ptr<PPointCloud>, 2> m_VoxelOutArray;
+  bool m_bGroundFlag;
+  GroundSegmentation m_objGroundSegmentation;
+  boost::function<void(boost::shared_ptr<PPointCloud>, boost::shared_ptr<std::vector<uint8_t> >, double)> m_funcGroundCallback;
+  std::array<boost::shared_ptr<std::vector<uint8_t> >, 2> m_GroundLabelArray;
+  bool m_bDualReturnFlag;
+  bool m_bDualReturnDedupe;
+  DualReturnSplitter m_objDualReturnSplitter;
+  boost::function<void(boost::shared_ptr<DualReturnFrame>, double)> m_funcDualReturnCallback;
+  std::array<boost::shared_ptr<DualReturnFrame>, 2> m_DualReturnArray;
+  bool m_bBackgroundFlag;
+  boost::atomic<bool> m_bRelearnBackground;
+  BackgroundModel m_objBackgroundModel;
+  boost::function<void(boost::shared_ptr<BackgroundSummary>, double)> m_funcBackgroundCallback;
+  std::array<boost::shared_ptr<BackgroundSummary>, 2> m_BackgroundSummaryArray;
+  double m_dDeskewRefTime;
+  LatencyHistogram m_objReceiveLatency;
+  LatencyHistogram m_objBufferWaitLatency;
+  LatencyHistogram m_objDecodeLatency;
+  LatencyHistogram m_objFrameAssemblyLatency;
+  LatencyHistogram m_objCallbackLatency;
+  boost::atomic<uint64_t> m_u64Packets;
+  boost::atomic<uint64_t> m_u64DroppedPackets;
+  boost::atomic<uint64_t> m_u64BufferOverflows;
+  boost::atomic<uint64_t> m_u64RedundantPoints;
+  boost::atomic<uint64_t> m_u64Frames;
+  PacketLossCounter m_objPacketLoss;
+  boost::function<void(const PacketLossStats &)> m_funcPacketLossCallback;
+  uint32_t m_u32PacketLossPeriod;
+  uint32_t m_u32LastPacketLossTick;
+  PacketLossStats m_objLastPacketLoss;
+  void reportPacketLoss();
+  CalibrationCache m_objCalibrationCache;
+  std::string m_sCalibrationSerial;
+  uint32_t m_u32CalibrationChecksum;
+  boost::thread *m_calibrationThread;
+  boost::shared_ptr<CalibrationTable> m_spCalibration;         // replaced by the processing thread between frames only
+  boost::shared_ptr<CalibrationTable> m_spPendingCalibration;  // boost::atomic_* access, taken at the next frame
+  boost::mutex m_mutexTcpCommandClient;  // the calibration and status threads share the client
+  LidarStatusPoller m_objStatusPoller;
+  // the setters stage their change here, the processing thread applies it between two frames
+  boost::mutex m_mutexPendingConfig;
+  boost::atomic<bool> m_bConfigPending;
+  bool m_bPoseInterpolatorPending;
+  boost::shared_ptr<PoseInterpolator> m_spPendingPoseInterpolator;
+  boost::function<double(double)> m_funcPendingDeskewReference;
+  bool m_bPointFilterPending;
+  PointFilterConfig m_objPendingPointFilter;
+  bool m_bVoxelPending;
+  VoxelGridConfig m_objPendingVoxelConfig;
+  boost::function<void(boost::shared_ptr<PPointCloud> cld, double timestamp)> m_funcPendingVoxelCallback;
+  bool m_bGroundPending;
+  GroundSegmentationConfig m_objPendingGroundConfig;
+  boost::function<void(boost::shared_ptr<PPointCloud>, boost::shared_ptr<std::vector<uint8_t> >, double)> m_funcPendingGroundCallback;
+  bool m_bBackgroundPending;
+  BackgroundConfig m_objPendingBackgroundConfig;
+  boost::function<void(boost::shared_ptr<BackgroundSummary>, double)> m_funcPendingBackgroundCallback;
+  bool m_bDualReturnPending;
+  DualReturnConfig m_objPendingDualReturnConfig;
+  boost::function<void(boost::shared_ptr<DualReturnFrame>, double)> m_funcPendingDualReturnCallback;
+  // outputs of the frame handed to the publish thread, set with m_bPublishPointsFlag;
+  // the processing thread may change its own settings while the frame is published
+  typedef struct PublishOutputs_s {
+	bool voxel;
+	boost::function<void(boost::shared_ptr<PPointCloud> cld, double timestamp)> voxelCallback;
+	bool ground;
+	boost::function<void(boost::shared_ptr<PPointCloud>, boost::shared_ptr<std::vector<uint8_t> >, double)> groundCallback;
+	bool background;
+	boost::function<void(boost::shared_ptr<BackgroundSummary>, double)> backgroundCallback;
+	bool dualReturn;
+	boost::function<void(boost::shared_ptr<DualReturnFrame>, double)> dualReturnCallback;
+  } PublishOutputs;
+  PublishOutputs m_objPublishOutputs;
+  ShmFrameWriter m_objShmWriter;
+  FrameWriter m_objFrameWriter;
 };
 
 #endif  // _PANDAR_POINTCLOUD_Pandar128SDK_H_
@@ -43,6 +43,16 @@ struct PointXYZIT {
 } EIGEN_ALIGN16;
 // enforce SSE padding for correct memory alignment
 
+/** Fused multi-lidar point, sensor_id is the index of the sensor in PandarSwiftFusion. */
+struct PointXYZITS {
+    PCL_ADD_POINT4D
+    float intensity;
+    double timestamp;
+    uint16_t ring;                      ///< laser ring number
+    uint16_t sensor_id;                 ///< source sensor
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW // make sure our new allocators are aligned
+} EIGEN_ALIGN16;
+
 struct PointXYZITd {
     double x;
     double y;
@@ -79,6 +89,11 @@ POINT_CLOUD_REGISTER_POINT_STRUCT(PointXYZIT,
                                   (float, x, x)(float, y, y)(float, z, z)
                                   (float, intensity, intensity)(double, timestamp, timestamp)(uint16_t, ring, ring))
 
+POINT_CLOUD_REGISTER_POINT_STRUCT(PointXYZITS,
+                                  (float, x, x)(float, y, y)(float, z, z)
+                                  (float, intensity, intensity)(double, timestamp, timestamp)(uint16_t, ring, ring)
+                                  (uint16_t, sensor_id, sensor_id))
+
 POINT_CLOUD_REGISTER_POINT_STRUCT(PointXYZITd,
                                   (double, x, x)(double, y, y)(double, z, z)(float, intensity, intensity)(double, timestamp,
                                           timestamp))
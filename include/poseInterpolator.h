@@ -0,0 +1,67 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    PoseInterpolator supplies the ego motion used to deskew the points.
+
+    The motion is either a constant twist or a list of timestamped poses.
+    getRelativeTransform() returns the transform which moves a point
+    measured at one time into the body frame at the reference time.
+*/
+
+#ifndef _PANDAR_POSE_INTERPOLATOR_H_
+#define _PANDAR_POSE_INTERPOLATOR_H_ 1
+
+#include <stdint.h>
+#include <deque>
+#include <boost/thread/shared_mutex.hpp>
+
+#define POSE_INTERPOLATOR_CAPACITY (1000)
+
+typedef struct PandarPose_s {
+	double timestamp;      // same clock as the point timestamps
+	float x, y, z;         // position in the world frame
+	float qw, qx, qy, qz;  // orientation, unit quaternion
+} PandarPose;
+
+class PoseInterpolator {
+ public:
+	/**
+	 * @brief Constructor
+	 * @param capacity  number of poses kept, the oldest poses are dropped
+	 */
+	PoseInterpolator(int capacity = POSE_INTERPOLATOR_CAPACITY);
+
+	/**
+	 * @brief Use a constant twist expressed in the body frame
+	 * @param vx, vy, vz  linear velocity, m/s
+	 *        wx, wy, wz  angular velocity, rad/s
+	 */
+	void setTwist(float vx, float vy, float vz, float wx, float wy, float wz);
+	/** @brief Append a pose, the timestamps must increase; switches to pose mode */
+	void addPose(const PandarPose &pose);
+	/**
+	 * @brief Transform from the body frame at time to the body frame at reftime
+	 * @param matrix  row-major upper 3x4 of the transform
+	 * @return false if the motion at these times is unknown
+	 */
+	bool getRelativeTransform(double time, double reftime, float *matrix);
+
+ private:
+	bool interpolate(double time, float *rotation, float *translation);
+
+	boost::shared_mutex m_mtxPoses;
+	std::deque<PandarPose> m_dequePoses;
+	int m_iCapacity;
+	bool m_bTwistMode;
+	float m_fLinear[3];
+	float m_fAngular[3];
+};
+
+#endif  // _PANDAR_POSE_INTERPOLATOR_H_
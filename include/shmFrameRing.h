@@ -0,0 +1,124 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Frames in a POSIX shared memory ring for consumers in other processes.
+
+    The object holds a ring header and slotNum fixed size slots, each a
+    slot header followed by the points of one organized frame. Frame n
+    (counted from 1) goes to slot (n - 1) % slotNum. A slot sequence is
+    odd while the writer fills it and 2n once frame n is complete. The
+    writer then stores n as the latest frame and wakes the readers on a
+    futex word in the ring header.
+
+    Readers map the object read-only and use the points in place. Nothing
+    blocks the writer, so a reader checks isValid() after using a frame:
+    it has slotNum - 1 frame periods before the slot is reused. Closing
+    the writer marks the ring closed and wakes all waiting readers.
+*/
+
+#ifndef _PANDAR_SHM_FRAME_RING_H_
+#define _PANDAR_SHM_FRAME_RING_H_ 1
+
+#include <stdint.h>
+#include <string>
+#include <pcl/point_cloud.h>
+#include "point_types.h"
+
+#define SHM_RING_MAGIC (0x4D485350)  // "PSHM"
+#define SHM_RING_VERSION (2)
+#define SHM_RING_FRAME_ID_SIZE (64)
+#define SHM_RING_ALIGN (64)
+
+// shared by the processes, only plain fields accessed with __atomic builtins
+typedef struct ShmRingHeader_s {
+	uint32_t u32Magic;
+	uint32_t u32Version;
+	uint32_t u32SlotNum;
+	uint32_t u32MaxPoints;   // per slot
+	uint32_t u32PointSize;   // sizeof(PointXYZIT) of the writer
+	uint32_t u32Futex;       // low 32 bits of u64Latest, readers wait on it; changed on close too
+	uint32_t u32Closed;      // 1 once the writer closed the ring, no frame follows
+	uint64_t u64SlotStride;  // bytes from one slot header to the next
+	uint64_t u64Latest;      // sequence of the latest complete frame, 0: none yet
+	char frameId[SHM_RING_FRAME_ID_SIZE];
+} __attribute__((aligned(SHM_RING_ALIGN))) ShmRingHeader;
+
+typedef struct ShmSlotHeader_s {
+	uint64_t u64Sequence;  // 2 * frame sequence when complete, odd while written
+	double dTimestamp;     // as passed to the cloud callback
+	uint32_t u32Width;
+	uint32_t u32Height;
+	uint32_t u32PointNum;  // points following the header, width * height
+} __attribute__((aligned(SHM_RING_ALIGN))) ShmSlotHeader;
+
+// a frame mapped read-only, valid while isValid() says so
+typedef struct ShmFrame_s {
+	uint64_t u64Sequence;
+	double dTimestamp;
+	uint32_t u32Width;
+	uint32_t u32Height;
+	uint32_t u32PointNum;
+	const PointXYZIT *points;
+	const ShmSlotHeader *slot;
+	inline ShmFrame_s() {
+		u64Sequence = 0;
+		dTimestamp = 0;
+		u32Width = 0;
+		u32Height = 0;
+		u32PointNum = 0;
+		points = NULL;
+		slot = NULL;
+	}
+} ShmFrame;
+
+class ShmFrameWriter {
+ public:
+	ShmFrameWriter();
+	~ShmFrameWriter();
+	/**
+	 * @brief create the shm object name, replacing one left by an earlier writer
+	 * @return 0 on success, -1 otherwise
+	 */
+	int open(std::string name, int slotNum, uint32_t maxPoints, std::string frameId);
+	/** @brief mark the ring closed, wake the readers, unmap and unlink the object; mapped readers keep their frames */
+	void close();
+	inline bool isOpen() const { return NULL != m_pHeader; }
+	/** @return 0 on success, -1 if the ring is closed or cloud exceeds a slot */
+	int publish(const pcl::PointCloud<PointXYZIT> &cloud, double timestamp);
+
+ private:
+	std::string m_sName;
+	ShmRingHeader *m_pHeader;
+	size_t m_u64Size;
+	uint64_t m_u64Sequence;
+};
+
+class ShmFrameReader {
+ public:
+	ShmFrameReader();
+	~ShmFrameReader();
+	/** @return 0 on success, -1 if name is missing or not a ring of this version */
+	int open(std::string name);
+	void close();
+	/**
+	 * @brief wait up to timeoutms for a frame newer than lastSequence, the latest one is mapped
+	 * @return 0 on success, -1 on timeout or if the ring is closed
+	 */
+	int waitFrame(uint64_t lastSequence, ShmFrame &frame, int timeoutms);
+	/** @brief true while the writer has not started to reuse the slot of frame */
+	bool isValid(const ShmFrame &frame);
+	inline const char *getFrameId() const { return NULL != m_pHeader ? m_pHeader->frameId : ""; }
+
+ private:
+	const ShmRingHeader *m_pHeader;
+	size_t m_u64Size;
+};
+
+#endif  // _PANDAR_SHM_FRAME_RING_H_
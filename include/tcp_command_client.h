@@ -30,8 +30,12 @@ typedef enum {
   PTC_COMMAND_RESET_CALIBRATION,
   PTC_COMMAND_TEST,
   PTC_COMMAND_GET_LIDAR_CALIBRATION,
+  PTC_COMMAND_GET_INVENTORY_INFO = 0x07,
+  PTC_COMMAND_GET_LIDAR_STATUS = 0x09,
 } PTC_COMMAND;
 
+#define PTC_INVENTORY_SERIAL_SIZE (18)  // the serial number opens the inventory info
+
 typedef enum {
   PTC_ERROR_NO_ERROR = 0,
   PTC_ERROR_BAD_PARAMETER,
@@ -61,6 +65,19 @@ typedef struct TC_Command_s {
   unsigned int ret_size;
 } TC_Command;
 
+#define PTC_IO_TIMEOUT_SEC (5)
+#define PTC_KEEPALIVE_IDLE_SEC (5)
+#define PTC_KEEPALIVE_INTERVAL_SEC (1)
+#define PTC_KEEPALIVE_COUNT (3)
+#define PTC_PIPELINE_DEPTH (16)  // requests written before the first feed back is read
+
+/**
+ * Feed back of TcpCommandSendAsync, called on the client's worker thread.
+ * data is ret_len bytes plus a terminating '\0' and freed after the return.
+ */
+typedef void (*TcpCommandCallback)(void* userdata, PTC_ErrCode error, unsigned char ret_code,
+                                   const unsigned char* data, unsigned int ret_len);
+
 void* TcpCommandClientNew(const char* ip, const unsigned short port);
 PTC_ErrCode TcpCommandSetCalibration(const void* handle, const char* buffer,
                                      unsigned int len);
@@ -68,7 +85,18 @@ PTC_ErrCode TcpCommandGetCalibration(const void* handle, char** buffer,
                                      unsigned int* len);
 PTC_ErrCode TcpCommandGetLidarCalibration(const void* handle, char** buffer,
                                           unsigned int* len);
+PTC_ErrCode TcpCommandGetInventoryInfo(const void* handle, char** buffer,
+                                      unsigned int* len);
 PTC_ErrCode TcpCommandResetCalibration(const void* handle);
+/**
+ * Queue a command without waiting. Commands queued while others are in flight
+ * are pipelined on the client's connection, the callbacks run in queue order.
+ * If the connection fails within a pipelined batch, the commands answered
+ * before get their feed back, the one that failed and those after it get the error.
+ */
+PTC_ErrCode TcpCommandSendAsync(const void* handle, unsigned char command,
+                                const unsigned char* payload, unsigned int len,
+                                TcpCommandCallback callback, void* userdata);
 void TcpCommandClientDestroy(const void* handle);
 SSL_CTX* initial_client_ssl(const char* cert, const char* private_key, const char* ca);
 void TcpCommandSetSsl(const char* cert, const char* private_key, const char* ca);
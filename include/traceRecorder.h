@@ -0,0 +1,92 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Process wide timeline of the receive / decode / publish pipeline.
+
+    Every thread writes its spans into its own ring, so recording takes no
+    lock; the rings are only walked by dump(), which writes the spans of a
+    time window as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+    While tracing is disabled a span costs one relaxed load.
+*/
+
+#ifndef _PANDAR_TRACE_RECORDER_H_
+#define _PANDAR_TRACE_RECORDER_H_ 1
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include "platUtil.h"
+
+#define TRACE_RING_SIZE (16384)  // spans kept per thread, power of 2
+
+typedef struct TraceSpan_s {
+	const char *name;    // string literal, not copied
+	uint64_t u64BeginUs;
+	uint64_t u64EndUs;
+	uint32_t u32Arg;
+} TraceSpan;
+
+class TraceRecorder {
+ public:
+	static TraceRecorder &instance();
+	inline bool isEnabled() {
+		return m_bEnabled.load(boost::memory_order_relaxed);
+	}
+	void enable(bool enabled);
+	/** @brief record one span of the calling thread, times from GetMicroTickCountU64() */
+	void record(const char *name, uint64_t beginus, uint64_t endus, uint32_t arg = 0);
+	/**
+	 * @brief write the spans that ended in the last windowsec seconds as Chrome trace JSON
+	 * @param windowsec  0: everything still in the rings
+	 * @return number of spans written, -1 if the file cannot be opened
+	 */
+	int dump(std::string filename, double windowsec = 0);
+
+ private:
+	typedef struct TraceRing_s {
+		uint32_t u32Tid;
+		boost::atomic<uint64_t> u64Head;
+		TraceSpan arrSpans[TRACE_RING_SIZE];
+	} TraceRing;
+
+	TraceRecorder();
+	TraceRing *getThreadRing();
+
+	boost::atomic<bool> m_bEnabled;
+	boost::mutex m_mutexRings;
+	std::vector<TraceRing *> m_vecRings;  // never freed, one per thread that traced
+};
+
+/** @brief span from construction to the end of the scope */
+class TraceScope {
+ public:
+	inline TraceScope(const char *name, uint32_t arg = 0) {
+		m_pName = TraceRecorder::instance().isEnabled() ? name : NULL;
+		m_u32Arg = arg;
+		m_u64Begin = NULL != m_pName ? GetMicroTickCountU64() : 0;
+	}
+	inline ~TraceScope() {
+		if(NULL != m_pName) {
+			TraceRecorder::instance().record(m_pName, m_u64Begin, GetMicroTickCountU64(), m_u32Arg);
+		}
+	}
+	inline void setArg(uint32_t arg) {
+		m_u32Arg = arg;
+	}
+
+ private:
+	const char *m_pName;
+	uint32_t m_u32Arg;
+	uint64_t m_u64Begin;
+};
+
+#endif  // _PANDAR_TRACE_RECORDER_H_
@@ -0,0 +1,134 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Hashed voxel grid filled by the decode workers.
+
+    Every worker inserts into its own partial map, so the hot loop takes no
+    lock; the partial maps are merged once per frame into the reduced cloud.
+    A partial map is an open addressing table that keeps its capacity from
+    frame to frame, once it has grown to the scene no point allocates.
+*/
+
+#ifndef _PANDAR_VOXEL_GRID_H_
+#define _PANDAR_VOXEL_GRID_H_ 1
+
+#include <math.h>
+#include <string>
+#include <vector>
+#include <pcl/point_cloud.h>
+#include "point_types.h"
+
+#define VOXEL_MODE_CENTROID "centroid"
+#define VOXEL_MODE_FIRST "first"
+#define VOXEL_KEY_BITS (21)
+#define VOXEL_KEY_OFFSET (1 << (VOXEL_KEY_BITS - 1))
+#define VOXEL_KEY_MASK ((1 << VOXEL_KEY_BITS) - 1)
+#define VOXEL_EMPTY_KEY (~0ULL)  // keys use the lower 3 * VOXEL_KEY_BITS bits only
+#define VOXEL_TABLE_MIN_BITS (12)
+
+typedef struct VoxelGridConfig_s {
+	float leafSize;    // meters, <= 0 disables the voxel grid
+	std::string mode;  // VOXEL_MODE_CENTROID or VOXEL_MODE_FIRST
+	inline VoxelGridConfig_s() {
+		leafSize = 0;
+		mode = VOXEL_MODE_CENTROID;
+	}
+} VoxelGridConfig;
+
+class VoxelGrid {
+ public:
+	typedef struct VoxelCell_s {
+		float x, y, z;      // sums for centroid, first hit otherwise
+		float intensity;
+		double timestamp;   // earliest point
+		uint32_t count;
+		uint16_t ring;
+	} VoxelCell;
+
+	VoxelGrid();
+	/** @brief set the leaf size and allocate one partial map per partition */
+	void setup(const VoxelGridConfig &config, int partitions);
+	/** @brief add a point to the partial map of a worker, one writer per partition */
+	inline void insert(int partition, const PointXYZIT &point) {
+		int64_t ix = static_cast<int64_t>(floorf(point.x * m_fInverseLeaf)) + VOXEL_KEY_OFFSET;
+		int64_t iy = static_cast<int64_t>(floorf(point.y * m_fInverseLeaf)) + VOXEL_KEY_OFFSET;
+		int64_t iz = static_cast<int64_t>(floorf(point.z * m_fInverseLeaf)) + VOXEL_KEY_OFFSET;
+		uint64_t key = (static_cast<uint64_t>(ix & VOXEL_KEY_MASK) << (2 * VOXEL_KEY_BITS)) |
+					   (static_cast<uint64_t>(iy & VOXEL_KEY_MASK) << VOXEL_KEY_BITS) |
+					   static_cast<uint64_t>(iz & VOXEL_KEY_MASK);
+		bool found;
+		VoxelCell &cell = takeCell(m_vecPartitions[partition], key, found);
+		if(!found) {
+			cell = VoxelCell{point.x, point.y, point.z, point.intensity, point.timestamp, 1, point.ring};
+			return;
+		}
+		if(m_bCentroid) {
+			cell.x += point.x;
+			cell.y += point.y;
+			cell.z += point.z;
+			cell.intensity += point.intensity;
+			cell.count++;
+		}
+		if(point.timestamp < cell.timestamp) {
+			if(!m_bCentroid) {
+				cell.x = point.x;
+				cell.y = point.y;
+				cell.z = point.z;
+				cell.intensity = point.intensity;
+			}
+			cell.timestamp = point.timestamp;
+			cell.ring = point.ring;
+		}
+	}
+	/** @brief merge the partial maps into out and clear them */
+	void merge(pcl::PointCloud<PointXYZIT> &out);
+	/** @brief drop the partial frame */
+	void clear();
+
+ private:
+	// one cache line per partial map header, the workers write them concurrently
+	typedef struct alignas(64) Partition_s {
+		std::vector<uint64_t> keys;   // VOXEL_EMPTY_KEY: free slot
+		std::vector<VoxelCell> cells;
+		std::vector<uint32_t> used;   // slots taken in this frame, in insertion order
+		int shift;                    // 64 - log2(capacity)
+		inline Partition_s() {
+			shift = 64;
+		}
+	} Partition;
+
+	/** @brief the cell of key, a free one if the frame has no point in that voxel yet */
+	inline VoxelCell &takeCell(Partition &partition, uint64_t key, bool &found) {
+		if(2 * (partition.used.size() + 1) > partition.keys.size()) {
+			grow(partition);
+		}
+		size_t mask = partition.keys.size() - 1;
+		size_t slot = (key * 0x9E3779B97F4A7C15ULL) >> partition.shift;
+		while (partition.keys[slot] != key) {
+			if(VOXEL_EMPTY_KEY == partition.keys[slot]) {
+				partition.keys[slot] = key;
+				partition.used.push_back(slot);
+				found = false;
+				return partition.cells[slot];
+			}
+			slot = (slot + 1) & mask;
+		}
+		found = true;
+		return partition.cells[slot];
+	}
+	void grow(Partition &partition);
+	void clearPartition(Partition &partition);
+
+	std::vector<Partition> m_vecPartitions;
+	float m_fInverseLeaf;
+	bool m_bCentroid;
+};
+
+#endif  // _PANDAR_VOXEL_GRID_H_
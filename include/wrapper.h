@@ -1,3 +1,8 @@
+    #ifndef _PANDAR_SWIFT_WRAPPER_H_
+    #define _PANDAR_SWIFT_WRAPPER_H_
+
+    #include <stdint.h>
+
     #ifdef __cplusplus
     extern "C" {
     #endif
@@ -7,6 +12,48 @@
     void SetPcdFileWriteFlag(int flag ,int frameNum);
     void SetPrintFlag(int flag);
 
+    /* one point, the memory layout of PointXYZIT */
+    typedef struct PandarSwiftPoint_s {
+        float x;
+        float y;
+        float z;
+        float reserved0;
+        float intensity;
+        uint32_t reserved1;
+        double timestamp;
+        uint16_t ring;                /* laser ring number, 0: empty slot of the organized frame */
+        uint8_t reserved2[14];
+    } PandarSwiftPoint;
+
+    /* a frame borrowed from the SDK, valid until PandarSwiftSDKReleaseFrame */
+    typedef struct PandarSwiftFrame_s {
+        const PandarSwiftPoint* points;
+        uint32_t pointNum;            /* width * height */
+        uint32_t width;
+        uint32_t height;
+        double timestamp;
+        uint64_t sequence;            /* frames published since start, a gap means frames were dropped */
+        void* reserved;               /* keeps the frame alive */
+    } PandarSwiftFrame;
+
+    /*
+     * Handle based pull API: create the SDK with the same arguments as RunPandarSwiftSDK,
+     * start receiving, take frames with PandarSwiftSDKNextFrame and give them back with
+     * PandarSwiftSDKReleaseFrame. The newest queueSize frames are queued, older ones dropped.
+     */
+    void* PandarSwiftSDKCreate(const char* deviceipaddr, int lidarport, int gpsport, const char* correctionfile, const char* firtimeflie,
+                                const char* pcapfile, const char* certFile, const char* privateKeyFile, const char* caFile, int queueSize);
+    /* return 0 on success, -1 if it is running already */
+    int PandarSwiftSDKStart(void* handle);
+    void PandarSwiftSDKStop(void* handle);
+    /* stops the SDK, frames not released yet stay valid */
+    void PandarSwiftSDKDestroy(void* handle);
+    /* wait up to timeoutMs, 0: do not wait; return 0 with the oldest queued frame, -1 if there is none */
+    int PandarSwiftSDKNextFrame(void* handle, PandarSwiftFrame* frame, int timeoutMs);
+    void PandarSwiftSDKReleaseFrame(PandarSwiftFrame* frame);
+
     #ifdef __cplusplus
     };
-    #endif
\ No newline at end of file
+    #endif
+
+    #endif  // _PANDAR_SWIFT_WRAPPER_H_
@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   BackgroundModel: learned per-cell background range
+ */
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include "backgroundModel.h"
+
+BackgroundModel::BackgroundModel() {
+	m_u32CellNum = 0;
+	m_bLearning = true;
+	m_u32LearnedFrames = 0;
+	m_u32ForegroundPoints = 0;
+	m_u32BackgroundPoints = 0;
+}
+
+void BackgroundModel::setup(const BackgroundConfig &config, uint32_t cellnum) {
+	m_objConfig = config;
+	if(cellnum != m_u32CellNum) {
+		m_u32CellNum = cellnum;
+		m_arrCount.reset(new boost::atomic<uint32_t>[cellnum]);
+		m_arrSum.reset(new boost::atomic<uint64_t>[cellnum]);
+		m_arrSumSq.reset(new boost::atomic<uint64_t>[cellnum]);
+		m_arrMask.reset(new boost::atomic<uint32_t>[(cellnum + 31) / 32]);
+		m_vecThreshold.assign(cellnum, 0);
+	}
+	reset();
+}
+
+void BackgroundModel::reset() {
+	for (uint32_t i = 0; i < m_u32CellNum; i++) {
+		m_arrCount[i].store(0, boost::memory_order_relaxed);
+		m_arrSum[i].store(0, boost::memory_order_relaxed);
+		m_arrSumSq[i].store(0, boost::memory_order_relaxed);
+	}
+	for (uint32_t i = 0; i < (m_u32CellNum + 31) / 32; i++) {
+		m_arrMask[i].store(0, boost::memory_order_relaxed);
+	}
+	m_u32LearnedFrames = 0;
+	m_bLearning = true;
+	m_u32ForegroundPoints = 0;
+	m_u32BackgroundPoints = 0;
+}
+
+void BackgroundModel::endFrame(BackgroundSummary &summary) {
+	summary.u32CellNum = m_u32CellNum;
+	summary.u32ForegroundPoints = 0;
+	summary.u32BackgroundPoints = 0;
+	if(m_bLearning) {
+		m_u32LearnedFrames++;
+		if(m_u32LearnedFrames >= m_objConfig.learnFrames) {
+			uint32_t minCount = static_cast<uint32_t>(m_objConfig.minOccupancy * m_u32LearnedFrames);
+			uint32_t emptyCells = 0;
+			for (uint32_t i = 0; i < m_u32CellNum; i++) {
+				uint32_t count = m_arrCount[i].load(boost::memory_order_relaxed);
+				if(0 == count || count < minCount) {
+					m_vecThreshold[i] = FLT_MAX;
+					emptyCells++;
+					continue;
+				}
+				double mean = static_cast<double>(m_arrSum[i].load(boost::memory_order_relaxed)) / count;
+				double variance = static_cast<double>(m_arrSumSq[i].load(boost::memory_order_relaxed)) / count - mean * mean;
+				double sigma = variance > 0 ? sqrt(variance) : 0;
+				double margin = std::max(static_cast<double>(m_objConfig.minMargin) * 1000, m_objConfig.sigmaScale * sigma);
+				m_vecThreshold[i] = static_cast<float>((mean - margin) / 1000);
+			}
+			m_bLearning = false;
+			printf("Background learned over %u frames, %u of %u cells empty\n", m_u32LearnedFrames, emptyCells, m_u32CellNum);
+		}
+		summary.learning = true;
+		summary.u32LearnedFrames = m_u32LearnedFrames;
+		summary.backgroundMask.clear();
+		return;
+	}
+	summary.learning = false;
+	summary.u32LearnedFrames = m_u32LearnedFrames;
+	summary.u32ForegroundPoints = m_u32ForegroundPoints.exchange(0, boost::memory_order_relaxed);
+	summary.u32BackgroundPoints = m_u32BackgroundPoints.exchange(0, boost::memory_order_relaxed);
+	summary.backgroundMask.resize((m_u32CellNum + 7) / 8);
+	for (uint32_t i = 0; i < (m_u32CellNum + 31) / 32; i++) {
+		uint32_t word = m_arrMask[i].exchange(0, boost::memory_order_relaxed);
+		for (int b = 0; b < 4 && i * 4 + b < summary.backgroundMask.size(); b++) {
+			summary.backgroundMask[i * 4 + b] = (word >> (8 * b)) & 0xFF;
+		}
+	}
+}
@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   CalibrationCache: correction files stored by serial number and checksum
+ */
+#include <stdio.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include <boost/crc.hpp>
+#include "calibrationCache.h"
+
+// serial numbers and addresses become file names, keep them to a safe alphabet
+static std::string sanitize(std::string name) {
+	for (int i = 0; i < name.size(); i++) {
+		if(!isalnum(name[i]) && '-' != name[i]) {
+			name[i] = '_';
+		}
+	}
+	return name;
+}
+
+CalibrationCache::CalibrationCache() {
+	m_sDir = "";
+}
+
+void CalibrationCache::setDirectory(std::string dir) {
+	m_sDir = dir;
+	if(!m_sDir.empty()) {
+		mkdir(m_sDir.c_str(), 0755);
+	}
+}
+
+uint32_t CalibrationCache::getChecksum(const std::string &content) {
+	boost::crc_32_type crc;
+	crc.process_bytes(content.data(), content.size());
+	return crc.checksum();
+}
+
+std::string CalibrationCache::getEntryPath(std::string serial, uint32_t checksum) {
+	char name[16];
+	snprintf(name, sizeof(name), "_%08x.csv", checksum);
+	return m_sDir + "/" + sanitize(serial) + name;
+}
+
+std::string CalibrationCache::getDevicePath(std::string deviceip) {
+	return m_sDir + "/" + sanitize(deviceip) + ".last";
+}
+
+int CalibrationCache::readFile(std::string path, std::string &content) {
+	std::ifstream fin(path.c_str(), std::ios::binary);
+	if(!fin.is_open()) {
+		return -1;
+	}
+	std::stringstream ss;
+	ss << fin.rdbuf();
+	content = ss.str();
+	return 0;
+}
+
+int CalibrationCache::writeFile(std::string path, const std::string &content) {
+	std::string tmp = path + ".tmp";
+	FILE *fp = fopen(tmp.c_str(), "wb");
+	if(NULL == fp) {
+		printf("Open calibration cache %s failed\n", tmp.c_str());
+		return -1;
+	}
+	bool ok = fwrite(content.data(), 1, content.size(), fp) == content.size();
+	ok = 0 == fclose(fp) && ok;
+	if(!ok || 0 != rename(tmp.c_str(), path.c_str())) {
+		printf("Write calibration cache %s failed\n", path.c_str());
+		remove(tmp.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+int CalibrationCache::load(std::string deviceip, std::string &serial, uint32_t &checksum, std::string &content) {
+	if(!isEnabled()) {
+		return -1;
+	}
+	std::string last;
+	if(0 != readFile(getDevicePath(deviceip), last)) {
+		return -1;
+	}
+	std::istringstream ss(last);
+	ss >> serial >> std::hex >> checksum;
+	if(ss.fail()) {
+		printf("Calibration cache %s is corrupt\n", getDevicePath(deviceip).c_str());
+		return -1;
+	}
+	if(0 != readFile(getEntryPath(serial, checksum), content)) {
+		return -1;
+	}
+	if(getChecksum(content) != checksum) {
+		printf("Calibration cache %s does not match its checksum\n", getEntryPath(serial, checksum).c_str());
+		return -1;
+	}
+	return 0;
+}
+
+int CalibrationCache::store(std::string deviceip, std::string serial, const std::string &content) {
+	if(!isEnabled()) {
+		return -1;
+	}
+	uint32_t checksum = getChecksum(content);
+	if(0 != writeFile(getEntryPath(serial, checksum), content)) {
+		return -1;
+	}
+	char last[64];
+	snprintf(last, sizeof(last), " %08x\n", checksum);
+	return writeFile(getDevicePath(deviceip), sanitize(serial) + last);
+}
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   DualReturnSplitter: one column set per return block of the organized cloud
+ */
+#include "dualReturn.h"
+
+DualReturnSplitter::DualReturnSplitter() {
+}
+
+void DualReturnSplitter::setConfig(const DualReturnConfig &config) {
+	m_objConfig = config;
+}
+
+void DualReturnSplitter::reset(int cellNum) {
+	m_vecDuplicates.assign(cellNum, 0);
+}
+
+void DualReturnSplitter::getReturnTypes(uint8_t returnMode, uint8_t *types) {
+	switch (returnMode) {
+		case 0x33:
+		types[0] = types[1] = RETURN_TYPE_FIRST;
+		break;
+		case 0x38:
+		types[0] = types[1] = RETURN_TYPE_LAST;
+		break;
+		case 0x39:
+		types[0] = RETURN_TYPE_LAST;
+		types[1] = RETURN_TYPE_STRONGEST;
+		break;
+		case 0x3b:
+		types[0] = RETURN_TYPE_LAST;
+		types[1] = RETURN_TYPE_FIRST;
+		break;
+		case 0x3c:
+		types[0] = RETURN_TYPE_FIRST;
+		types[1] = RETURN_TYPE_STRONGEST;
+		break;
+		default:
+		types[0] = types[1] = RETURN_TYPE_STRONGEST;
+		break;
+	}
+}
+
+uint32_t DualReturnSplitter::split(const pcl::PointCloud<PointXYZIT> &cloud, int laserNum, int returnBlockSize, int returnBlock,
+				uint8_t returnMode, ReturnPlane &plane) {
+	uint8_t types[RETURN_PLANE_NUM];
+	getReturnTypes(returnMode, types);
+	int columnNum = cloud.points.size() / (laserNum * returnBlockSize);
+	bool checkDuplicates = 0 == returnBlock && returnBlockSize > 1 && m_vecDuplicates.size() >= columnNum * laserNum;
+	plane.x.clear();
+	plane.y.clear();
+	plane.z.clear();
+	plane.intensity.clear();
+	plane.timestamp.clear();
+	plane.ring.clear();
+	plane.returnType.clear();
+	uint32_t duplicates = 0;
+	for (int column = 0; column < columnNum; column++) {
+		const PointXYZIT *point = &cloud.points[(column * returnBlockSize + returnBlock) * laserNum];
+		for (int i = 0; i < laserNum; i++, point++) {
+			if(0 == point->ring) {
+				continue;  // empty slot
+			}
+			uint8_t type = types[returnBlock];
+			if(checkDuplicates && m_vecDuplicates[column * laserNum + i]) {
+				type |= types[1];
+				duplicates++;
+			}
+			plane.x.push_back(point->x);
+			plane.y.push_back(point->y);
+			plane.z.push_back(point->z);
+			plane.intensity.push_back(static_cast<uint8_t>(point->intensity));
+			plane.timestamp.push_back(point->timestamp);
+			plane.ring.push_back(point->ring);
+			plane.returnType.push_back(type);
+		}
+	}
+	return duplicates;
+}
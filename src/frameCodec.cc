@@ -0,0 +1,770 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   FrameEncoder / FrameDecoder: organized frames as ranges and angle indices, rANS coded per lane
+ */
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "frameCodec.h"
+#include "pandarSwiftShared.h"
+#include "taskflow.hpp"
+
+#define STREAM_KIND (0)
+#define STREAM_RANGE (1)
+#define STREAM_PITCH (2)
+#define STREAM_AZIMUTH (3)
+#define STREAM_INTENSITY (4)
+#define STREAM_TIME (5)
+#define STREAM_RAW (6)      // stored as is, the streams before it are rANS coded
+
+#define POINT_EMPTY (0)
+#define POINT_NATIVE (1)   // range and angle indices
+#define POINT_RAW_XYZ (2)  // raw x y z, intensity and timestamp coded
+#define POINT_RAW (3)      // raw x y z intensity timestamp ring
+#define RAW_XYZ_SIZE (12)
+#define RAW_POINT_SIZE (26)
+
+#define DECODE_BLOCK_COLUMNS (16)
+
+#define RANS_PROB_BITS (12)
+#define RANS_PROB_SCALE (1 << RANS_PROB_BITS)
+#define RANS_LOW (1u << 23)
+
+typedef struct LaneState_s {
+	uint16_t u16Range;          // of the previous native point
+	uint16_t u16PitchBase;      // pitch and azimuth offset of the first native point
+	uint16_t u16AzimuthBase;
+	bool bBase;
+	int32_t i32AzimuthOffset;   // azimuth offset to the base of the previous native point
+	uint16_t u16Pitch;          // of the previous native point, the first guess for the next one
+	uint64_t u64Time;           // timestamp bits of the previous point
+	uint64_t u64TimeDelta;
+	inline LaneState_s() {
+		u16Range = 0;
+		u16PitchBase = 0;
+		u16AzimuthBase = 0;
+		bBase = false;
+		i32AzimuthOffset = 0;
+		u16Pitch = 0;
+		u64Time = 0;
+		u64TimeDelta = 0;
+	}
+} LaneState;
+
+typedef struct LaneCursor_s {
+	const uint8_t *pos[FRAME_CODEC_STREAM_NUM];
+	const uint8_t *end[FRAME_CODEC_STREAM_NUM];
+} LaneCursor;
+
+static inline uint32_t floatBits(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static inline uint64_t doubleBits(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static inline uint64_t zigzag(int64_t value) {
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// angle in [-CIRCLE, 2 * CIRCLE) to [0, CIRCLE)
+static inline int wrapAngle(int angle) {
+	if(angle >= CIRCLE) {
+		return angle - CIRCLE;
+	}
+	return angle < 0 ? angle + CIRCLE : angle;
+}
+
+// difference of two angles in [0, CIRCLE) to [-CIRCLE / 2, CIRCLE / 2)
+static inline int angleOffset(int angle, int base) {
+	int offset = angle - base;
+	if(offset >= CIRCLE / 2) {
+		return offset - CIRCLE;
+	}
+	return offset < -CIRCLE / 2 ? offset + CIRCLE : offset;
+}
+
+static inline int degreeToIndex(double degree) {
+	int index = static_cast<int>(lround(degree * 100)) % CIRCLE;
+	return index < 0 ? index + CIRCLE : index;
+}
+
+static inline void putVarint(std::vector<uint8_t> &stream, uint64_t value) {
+	while (value >= 0x80) {
+		stream.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	stream.push_back(static_cast<uint8_t>(value));
+}
+
+static inline bool getVarint(const uint8_t *&pos, const uint8_t *end, uint64_t &value) {
+	if(pos < end && *pos < 0x80) {
+		value = *pos++;
+		return true;
+	}
+	value = 0;
+	for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+		uint8_t byte = *pos++;
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if(0 == (byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline bool isEmptyPoint(const PointXYZIT &point) {
+	return 0 == point.ring && 0 == (floatBits(point.x) | floatBits(point.y) | floatBits(point.z) | floatBits(point.intensity)) &&
+			0 == doubleBits(point.timestamp);
+}
+
+// as the decode kernels compute it
+static inline float rangeToDistance(int range) {
+	return static_cast<float>(range) * PANDAR128_DISTANCE_UNIT;
+}
+
+// the azimuth index that gives x and y from xyDistance bit for bit, -1 if there is none
+static int findAzimuth(const PointXYZIT &point, float xyDistance, int guess) {
+	const AllAngleTable &table = allAngleTable();
+	if(floatBits(xyDistance * table.sinAllAngle[guess]) == floatBits(point.x) &&
+			floatBits(xyDistance * table.cosAllAngle[guess]) == floatBits(point.y)) {
+		return guess;
+	}
+	int center = degreeToIndex(atan2(static_cast<double>(point.x), static_cast<double>(point.y)) * 180.0 / M_PI);
+	for (int i = -1; i <= 1; i++) {
+		int azimuth = wrapAngle(center + i);
+		if(floatBits(xyDistance * table.sinAllAngle[azimuth]) == floatBits(point.x) &&
+				floatBits(xyDistance * table.cosAllAngle[azimuth]) == floatBits(point.y)) {
+			return azimuth;
+		}
+	}
+	return -1;
+}
+
+// the range, pitch and azimuth indices the point was built from, false if xyz does not come back
+static bool findNative(const PointXYZIT &point, int pitchGuess, int azimuthGuess, int &range, int &pitch, int &azimuth) {
+	const AllAngleTable &table = allAngleTable();
+	double norm = sqrt(static_cast<double>(point.x) * point.x + static_cast<double>(point.y) * point.y +
+			static_cast<double>(point.z) * point.z) / PANDAR128_DISTANCE_UNIT;
+	if(!(norm < UINT16_MAX + 0.5)) {
+		return false;
+	}
+	int rangeGuess = static_cast<int>(norm + 0.5);
+	for (int r = 0; r < 3; r++) {
+		range = rangeGuess + (r + 1) / 2 * (r & 1 ? -1 : 1);  // guess, guess - 1, guess + 1
+		if(range < 0 || range > UINT16_MAX) {
+			continue;
+		}
+		float distance = rangeToDistance(range);
+		// the pitch of the previous point of the lane first, then around the one of z
+		int center = -1;
+		for (int p = 0; p < 4; p++) {
+			if(0 == p) {
+				pitch = pitchGuess;
+			}
+			else {
+				if(center < 0) {
+					double sine = 0 != distance ? point.z / static_cast<double>(distance) : 0;
+					center = degreeToIndex(asin(std::max(-1.0, std::min(1.0, sine))) * 180.0 / M_PI);
+				}
+				pitch = wrapAngle(center + p - 2);
+				if(pitch == pitchGuess) {
+					continue;
+				}
+			}
+			if(floatBits(distance * table.sinAllAngle[pitch]) != floatBits(point.z)) {
+				continue;
+			}
+			azimuth = findAzimuth(point, distance * table.cosAllAngle[pitch], azimuthGuess);
+			if(azimuth >= 0) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// frequencies of the symbols scaled to RANS_PROB_SCALE, every present symbol keeps at least 1
+static void normalizeFrequencies(const uint32_t *counts, uint16_t *freqs) {
+	uint64_t total = 0;
+	int largest = 0;
+	for (int s = 0; s < 256; s++) {
+		total += counts[s];
+		largest = counts[s] > counts[largest] ? s : largest;
+	}
+	memset(freqs, 0, 256 * sizeof(uint16_t));
+	if(0 == total) {
+		return;
+	}
+	int sum = 0;
+	for (int s = 0; s < 256; s++) {
+		if(0 != counts[s]) {
+			freqs[s] = std::max<uint64_t>(1, static_cast<uint64_t>(counts[s]) * RANS_PROB_SCALE / total);
+			sum += freqs[s];
+		}
+	}
+	freqs[largest] += std::max(0, RANS_PROB_SCALE - sum);
+	sum = std::max(sum, RANS_PROB_SCALE);
+	while (sum > RANS_PROB_SCALE) {
+		int s = std::max_element(freqs, freqs + 256) - freqs;
+		int cut = std::min(sum - RANS_PROB_SCALE, freqs[s] / 2);
+		freqs[s] -= cut;
+		sum -= cut;
+	}
+}
+
+// encoder side of a symbol, the division by the frequency as a multiplication by its reciprocal
+typedef struct RansEncodeSymbol_s {
+	uint32_t u32Limit;   // renormalize while the state is at or above it
+	uint32_t u32Reciprocal;
+	uint32_t u32Bias;
+	uint16_t u16ComplementFreq;
+	uint16_t u16Shift;
+} RansEncodeSymbol;
+
+static void ransInitSymbol(RansEncodeSymbol &symbol, uint32_t freq, uint32_t cum) {
+	symbol.u32Limit = ((RANS_LOW >> RANS_PROB_BITS) << 8) * freq;
+	symbol.u16ComplementFreq = RANS_PROB_SCALE - freq;
+	if(freq < 2) {
+		symbol.u32Reciprocal = ~0u;
+		symbol.u16Shift = 0;
+		symbol.u32Bias = cum + RANS_PROB_SCALE - 1;
+		return;
+	}
+	uint32_t shift = 0;
+	while (freq > (1u << shift)) {
+		shift++;
+	}
+	symbol.u32Reciprocal = static_cast<uint32_t>(((1ull << (shift + 31)) + freq - 1) / freq);
+	symbol.u16Shift = shift - 1;
+	symbol.u32Bias = cum;
+}
+
+// rANS bytes of the symbols, last byte first: the decoder reads scratch backwards.
+// Even and odd symbols go to two interleaved states, a stream of one symbol takes no bytes.
+static void ransEncode(const std::vector<uint8_t> &symbols, const RansEncodeSymbol *table, std::vector<uint8_t> &scratch) {
+	scratch.clear();
+	if(symbols.empty() || 0 == table[symbols[0]].u16ComplementFreq) {
+		return;
+	}
+	uint32_t states[2] = {RANS_LOW, RANS_LOW};
+	for (size_t i = symbols.size(); i > 0; i--) {
+		uint32_t &state = states[(i - 1) & 1];
+		const RansEncodeSymbol &symbol = table[symbols[i - 1]];
+		while (state >= symbol.u32Limit) {
+			scratch.push_back(static_cast<uint8_t>(state));
+			state >>= 8;
+		}
+		uint32_t quotient = static_cast<uint32_t>((static_cast<uint64_t>(state) * symbol.u32Reciprocal) >> 32) >> symbol.u16Shift;
+		state += symbol.u32Bias + quotient * symbol.u16ComplementFreq;
+	}
+	for (int s = 1; s >= 0; s--) {
+		for (int i = 0; i < 4; i++) {
+			scratch.push_back(static_cast<uint8_t>(states[s]));
+			states[s] >>= 8;
+		}
+	}
+}
+
+// one entry per slot: frequency, slot - cumulative frequency and symbol, 12 + 12 + 8 bits
+static inline uint8_t ransDecodeSymbol(uint32_t &state, const uint32_t *slots) {
+	uint32_t slot = state & (RANS_PROB_SCALE - 1);
+	uint32_t entry = slots[slot];
+	state = (entry & 0xFFF) * (state >> RANS_PROB_BITS) + (entry >> 12 & 0xFFF);
+	return static_cast<uint8_t>(entry >> 24);
+}
+
+static inline bool ransRenormalize(uint32_t &state, const uint8_t *&data, const uint8_t *end) {
+	while (state < RANS_LOW) {
+		if(data == end) {
+			return false;
+		}
+		state = state << 8 | *data++;
+	}
+	return true;
+}
+
+static bool ransDecode(const uint8_t *data, size_t size, const uint32_t *slots, uint8_t *symbols, size_t symbolNum) {
+	if(0 == symbolNum) {
+		return 0 == size;
+	}
+	if(0 == (slots[0] & 0xFFF)) {
+		// a stream of one symbol, its frequency RANS_PROB_SCALE does not fit the entry
+		memset(symbols, slots[0] >> 24, symbolNum);
+		return 0 == size;
+	}
+	if(size < 8) {
+		return false;
+	}
+	const uint8_t *end = data + size;
+	uint32_t states[2];
+	for (int s = 0; s < 2; s++, data += 4) {
+		states[s] = static_cast<uint32_t>(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+	}
+	size_t i = 0;
+	for (; i + 1 < symbolNum; i += 2) {
+		symbols[i] = ransDecodeSymbol(states[0], slots);
+		symbols[i + 1] = ransDecodeSymbol(states[1], slots);
+		if(!ransRenormalize(states[0], data, end) || !ransRenormalize(states[1], data, end)) {
+			return false;
+		}
+	}
+	if(i < symbolNum) {
+		symbols[i] = ransDecodeSymbol(states[0], slots);
+		if(!ransRenormalize(states[0], data, end)) {
+			return false;
+		}
+	}
+	return data == end;
+}
+
+FrameEncoder::FrameEncoder() {
+	memset(&m_objStats, 0, sizeof(m_objStats));
+}
+
+int FrameEncoder::encode(const pcl::PointCloud<PointXYZIT> &cloud, double timestamp, int laserNum, int returnNum, std::vector<uint8_t> &out) {
+	size_t pointNum = cloud.points.size();
+	if(pointNum != static_cast<size_t>(cloud.width) * cloud.height) {
+		printf("Frame encoder: the cloud is not %u x %u points\n", cloud.width, cloud.height);
+		return -1;
+	}
+	if(pointNum > FRAME_CODEC_MAX_POINTS) {
+		printf("Frame encoder: %lu points exceed the frame limit\n", pointNum);
+		return -1;
+	}
+	int angleSize = 0;
+	if(laserNum > 0 && laserNum <= UINT16_MAX && returnNum > 0 && returnNum <= UINT16_MAX &&
+			pointNum > 0 && 0 == pointNum % (static_cast<size_t>(laserNum) * returnNum)) {
+		size_t binNum = pointNum / laserNum / returnNum;
+		angleSize = 0 == CIRCLE % binNum ? CIRCLE / binNum : 0;
+	}
+	if(0 == angleSize) {
+		laserNum = 0;
+		returnNum = 0;
+	}
+	int laneNum = std::max(laserNum, 1);
+	if(m_vecStreams.size() < static_cast<size_t>(laneNum) * FRAME_CODEC_STREAM_NUM) {
+		m_vecStreams.resize(laneNum * FRAME_CODEC_STREAM_NUM);
+	}
+	for (int i = 0; i < laneNum * FRAME_CODEC_STREAM_NUM; i++) {
+		m_vecStreams[i].clear();
+	}
+	std::vector<LaneState> lanes(laneNum);
+	for (int i = 0; i < laneNum; i++) {
+		lanes[i].u64Time = doubleBits(timestamp);
+	}
+	memset(&m_objStats, 0, sizeof(m_objStats));
+	int lane = 0;
+	int column = 0;
+	int binAzimuth = 0;
+	for (size_t i = 0; i < pointNum; i++) {
+		const PointXYZIT &point = cloud.points[i];
+		std::vector<uint8_t> *streams = &m_vecStreams[lane * FRAME_CODEC_STREAM_NUM];
+		LaneState &state = lanes[lane];
+		uint8_t intensity = point.intensity >= 0 && point.intensity <= 255 ? static_cast<uint8_t>(point.intensity) : 0;
+		uint8_t kind = POINT_RAW;
+		int range = 0, pitch = 0, azimuth = 0;
+		if(isEmptyPoint(point)) {
+			kind = POINT_EMPTY;
+		}
+		else if(0 != laserNum && lane + 1 == point.ring && floatBits(static_cast<float>(intensity)) == floatBits(point.intensity)) {
+			int azimuthGuess = wrapAngle(wrapAngle(binAzimuth + state.u16AzimuthBase) + state.i32AzimuthOffset);
+			kind = findNative(point, state.u16Pitch, azimuthGuess, range, pitch, azimuth) ? POINT_NATIVE : POINT_RAW_XYZ;
+		}
+		streams[STREAM_KIND].push_back(kind);
+		if(POINT_NATIVE == kind) {
+			if(!state.bBase) {
+				state.u16PitchBase = pitch;
+				state.u16AzimuthBase = wrapAngle(azimuth - binAzimuth);
+				state.bBase = true;
+			}
+			int azimuthOffset = angleOffset(azimuth, wrapAngle(binAzimuth + state.u16AzimuthBase));
+			putVarint(streams[STREAM_RANGE], zigzag(range - state.u16Range));
+			putVarint(streams[STREAM_PITCH], zigzag(angleOffset(pitch, state.u16PitchBase)));
+			putVarint(streams[STREAM_AZIMUTH], zigzag(azimuthOffset - state.i32AzimuthOffset));
+			state.u16Range = range;
+			state.u16Pitch = pitch;
+			state.i32AzimuthOffset = azimuthOffset;
+			m_objStats.u32NativePoints++;
+		}
+		else if(POINT_RAW_XYZ == kind) {
+			streams[STREAM_RAW].insert(streams[STREAM_RAW].end(), reinterpret_cast<const uint8_t *>(&point.x),
+					reinterpret_cast<const uint8_t *>(&point.x) + RAW_XYZ_SIZE);
+			m_objStats.u32RawXyzPoints++;
+		}
+		else if(POINT_RAW == kind) {
+			uint8_t raw[RAW_POINT_SIZE];
+			memcpy(raw, &point.x, RAW_XYZ_SIZE);
+			memcpy(raw + 12, &point.intensity, sizeof(float));
+			memcpy(raw + 16, &point.timestamp, sizeof(double));
+			memcpy(raw + 24, &point.ring, sizeof(uint16_t));
+			streams[STREAM_RAW].insert(streams[STREAM_RAW].end(), raw, raw + RAW_POINT_SIZE);
+			m_objStats.u32RawPoints++;
+		}
+		else {
+			m_objStats.u32EmptyPoints++;
+		}
+		if(POINT_NATIVE == kind || POINT_RAW_XYZ == kind) {
+			uint64_t time = doubleBits(point.timestamp);
+			streams[STREAM_INTENSITY].push_back(intensity);
+			putVarint(streams[STREAM_TIME], zigzag(static_cast<int64_t>(time - state.u64Time - state.u64TimeDelta)));
+			state.u64TimeDelta = time - state.u64Time;
+			state.u64Time = time;
+		}
+		if(0 != laserNum && ++lane == laserNum) {
+			lane = 0;
+			binAzimuth = ++column / returnNum * angleSize;
+		}
+	}
+	// one frequency table per stream for all the lanes
+	uint32_t counts[STREAM_RAW][256];
+	uint16_t freqs[STREAM_RAW][256];
+	RansEncodeSymbol symbols[STREAM_RAW][256];
+	memset(counts, 0, sizeof(counts));
+	for (int l = 0; l < laneNum; l++) {
+		for (int s = 0; s < STREAM_RAW; s++) {
+			const std::vector<uint8_t> &stream = m_vecStreams[l * FRAME_CODEC_STREAM_NUM + s];
+			for (size_t i = 0; i < stream.size(); i++) {
+				counts[s][stream[i]]++;
+			}
+		}
+	}
+	FrameCodecHeader header;
+	header.u32Magic = FRAME_CODEC_MAGIC;
+	header.u16Version = FRAME_CODEC_VERSION;
+	header.u16LaserNum = laserNum;
+	header.u16ReturnNum = returnNum;
+	header.u16AngleSize = angleSize;
+	header.u32Width = cloud.width;
+	header.u32Height = cloud.height;
+	header.dTimestamp = timestamp;
+	header.u32Size = 0;
+	out.assign(reinterpret_cast<const uint8_t *>(&header), reinterpret_cast<const uint8_t *>(&header) + sizeof(header));
+	for (int l = 0; l < laserNum; l++) {
+		uint16_t bases[2] = {lanes[l].u16PitchBase, lanes[l].u16AzimuthBase};
+		out.insert(out.end(), reinterpret_cast<const uint8_t *>(bases), reinterpret_cast<const uint8_t *>(bases + 2));
+	}
+	for (int s = 0; s < STREAM_RAW; s++) {
+		normalizeFrequencies(counts[s], freqs[s]);
+		int symbolNum = 0;
+		uint32_t cum = 0;
+		for (int i = 0; i < 256; i++) {
+			ransInitSymbol(symbols[s][i], freqs[s][i], cum);
+			cum += freqs[s][i];
+			symbolNum += 0 != freqs[s][i];
+		}
+		putVarint(out, symbolNum);
+		for (int i = 0; i < 256; i++) {
+			if(0 != freqs[s][i]) {
+				out.push_back(i);
+				putVarint(out, freqs[s][i]);
+			}
+		}
+	}
+	for (int l = 0; l < laneNum; l++) {
+		for (int s = 0; s < STREAM_RAW; s++) {
+			const std::vector<uint8_t> &stream = m_vecStreams[l * FRAME_CODEC_STREAM_NUM + s];
+			ransEncode(stream, symbols[s], m_vecScratch);
+			putVarint(out, stream.size());
+			putVarint(out, m_vecScratch.size());
+			out.insert(out.end(), m_vecScratch.rbegin(), m_vecScratch.rend());
+		}
+		const std::vector<uint8_t> &raw = m_vecStreams[l * FRAME_CODEC_STREAM_NUM + STREAM_RAW];
+		putVarint(out, raw.size());
+		out.insert(out.end(), raw.begin(), raw.end());
+	}
+	uint32_t size = out.size();
+	memcpy(&out[0] + offsetof(FrameCodecHeader, u32Size), &size, sizeof(size));
+	m_objStats.u32Bytes = size;
+	return 0;
+}
+
+// pointNum points of one lane from column, stride laserNum (1 if not organized)
+static bool decodeLane(LaneCursor &laneCursor, LaneState &laneState, int lane, int laserNum, int returnNum, int angleSize,
+		size_t column, PointXYZIT *points, size_t pointNum) {
+	const AllAngleTable &table = allAngleTable();
+	// the lane in locals, the compiler cannot keep them in registers while it writes the points
+	LaneCursor cursor = laneCursor;
+	LaneState state = laneState;
+	size_t stride = std::max(laserNum, 1);
+	int returnIndex = 0 != laserNum ? column % returnNum : 0;
+	int binAzimuth = 0 != laserNum ? column / returnNum * angleSize : 0;
+	for (size_t i = 0; i < pointNum; i++) {
+		float x = 0, y = 0, z = 0, intensity = 0;
+		uint64_t time = 0;
+		uint16_t ring = 0;
+		if(cursor.pos[STREAM_KIND] == cursor.end[STREAM_KIND]) {
+			return false;
+		}
+		uint8_t kind = *cursor.pos[STREAM_KIND]++;
+		if(POINT_NATIVE == kind && 0 != laserNum) {
+			uint64_t range, pitch, azimuth;
+			if(!getVarint(cursor.pos[STREAM_RANGE], cursor.end[STREAM_RANGE], range) ||
+					!getVarint(cursor.pos[STREAM_PITCH], cursor.end[STREAM_PITCH], pitch) ||
+					!getVarint(cursor.pos[STREAM_AZIMUTH], cursor.end[STREAM_AZIMUTH], azimuth)) {
+				return false;
+			}
+			int64_t pitchOffset = unzigzag(pitch);
+			int64_t azimuthOffset = state.i32AzimuthOffset + unzigzag(azimuth);
+			range = state.u16Range + unzigzag(range);
+			if(range > UINT16_MAX || pitchOffset < -CIRCLE / 2 || pitchOffset >= CIRCLE / 2 ||
+					azimuthOffset < -CIRCLE / 2 || azimuthOffset >= CIRCLE / 2) {
+				return false;
+			}
+			int pitchIdx = wrapAngle(state.u16PitchBase + pitchOffset);
+			int azimuthIdx = wrapAngle(wrapAngle(binAzimuth + state.u16AzimuthBase) + azimuthOffset);
+			float distance = rangeToDistance(range);
+			float xyDistance = distance * table.cosAllAngle[pitchIdx];
+			x = xyDistance * table.sinAllAngle[azimuthIdx];
+			y = xyDistance * table.cosAllAngle[azimuthIdx];
+			z = distance * table.sinAllAngle[pitchIdx];
+			ring = lane + 1;
+			state.u16Range = range;
+			state.i32AzimuthOffset = azimuthOffset;
+		}
+		else if(POINT_RAW_XYZ == kind && 0 != laserNum) {
+			if(cursor.end[STREAM_RAW] - cursor.pos[STREAM_RAW] < RAW_XYZ_SIZE) {
+				return false;
+			}
+			memcpy(&x, cursor.pos[STREAM_RAW], sizeof(float));
+			memcpy(&y, cursor.pos[STREAM_RAW] + 4, sizeof(float));
+			memcpy(&z, cursor.pos[STREAM_RAW] + 8, sizeof(float));
+			cursor.pos[STREAM_RAW] += RAW_XYZ_SIZE;
+			ring = lane + 1;
+		}
+		else if(POINT_RAW == kind) {
+			if(cursor.end[STREAM_RAW] - cursor.pos[STREAM_RAW] < RAW_POINT_SIZE) {
+				return false;
+			}
+			const uint8_t *raw = cursor.pos[STREAM_RAW];
+			memcpy(&x, raw, sizeof(float));
+			memcpy(&y, raw + 4, sizeof(float));
+			memcpy(&z, raw + 8, sizeof(float));
+			memcpy(&intensity, raw + 12, sizeof(float));
+			memcpy(&time, raw + 16, sizeof(uint64_t));
+			memcpy(&ring, raw + 24, sizeof(uint16_t));
+			cursor.pos[STREAM_RAW] += RAW_POINT_SIZE;
+		}
+		else if(POINT_EMPTY != kind) {
+			return false;
+		}
+		if(POINT_NATIVE == kind || POINT_RAW_XYZ == kind) {
+			uint64_t delta;
+			if(cursor.pos[STREAM_INTENSITY] == cursor.end[STREAM_INTENSITY] ||
+					!getVarint(cursor.pos[STREAM_TIME], cursor.end[STREAM_TIME], delta)) {
+				return false;
+			}
+			intensity = *cursor.pos[STREAM_INTENSITY]++;
+			state.u64TimeDelta += static_cast<uint64_t>(unzigzag(delta));
+			state.u64Time += state.u64TimeDelta;
+			time = state.u64Time;
+		}
+		PointXYZIT &point = points[i * stride];
+		point.x = x;
+		point.y = y;
+		point.z = z;
+		point.data[3] = 0;
+		point.intensity = intensity;
+		memcpy(&point.timestamp, &time, sizeof(double));
+		point.ring = ring;
+		if(0 != laserNum && ++returnIndex == returnNum) {
+			returnIndex = 0;
+			binAzimuth += angleSize;
+		}
+	}
+	laneCursor = cursor;
+	laneState = state;
+	return true;
+}
+
+size_t FrameDecoder::getFrameSize(const uint8_t *data, size_t size) {
+	FrameCodecHeader header;
+	if(size < sizeof(header)) {
+		return 0;
+	}
+	memcpy(&header, data, sizeof(header));
+	if(FRAME_CODEC_MAGIC != header.u32Magic || FRAME_CODEC_VERSION != header.u16Version || header.u32Size < sizeof(header)) {
+		return 0;
+	}
+	return header.u32Size;
+}
+
+int FrameDecoder::decode(const uint8_t *data, size_t size, pcl::PointCloud<PointXYZIT> &cloud, double &timestamp) {
+	size_t frameSize = getFrameSize(data, size);
+	if(0 == frameSize || frameSize > size) {
+		printf("Frame decoder: no complete frame\n");
+		return -1;
+	}
+	FrameCodecHeader header;
+	memcpy(&header, data, sizeof(header));
+	uint64_t pointNum = static_cast<uint64_t>(header.u32Width) * header.u32Height;
+	if(pointNum > FRAME_CODEC_MAX_POINTS) {
+		printf("Frame decoder: %lu points exceed the frame limit\n", pointNum);
+		return -1;
+	}
+	int laserNum = header.u16LaserNum;
+	int returnNum = header.u16ReturnNum;
+	int angleSize = header.u16AngleSize;
+	if(0 != laserNum && (0 == returnNum || 0 == angleSize || 0 != CIRCLE % angleSize ||
+			pointNum != static_cast<uint64_t>(CIRCLE / angleSize) * laserNum * returnNum)) {
+		printf("Frame decoder: inconsistent frame layout\n");
+		return -1;
+	}
+	const uint8_t *pos = data + sizeof(header);
+	const uint8_t *end = data + frameSize;
+	int laneNum = std::max(laserNum, 1);
+	if(static_cast<size_t>(end - pos) < laserNum * 2 * sizeof(uint16_t)) {
+		printf("Frame decoder: truncated frame\n");
+		return -1;
+	}
+	std::vector<LaneState> lanes(laneNum);
+	for (int l = 0; l < laneNum; l++) {
+		if(0 != laserNum) {
+			memcpy(&lanes[l].u16PitchBase, pos, sizeof(uint16_t));
+			memcpy(&lanes[l].u16AzimuthBase, pos + 2, sizeof(uint16_t));
+			pos += 2 * sizeof(uint16_t);
+			if(lanes[l].u16PitchBase >= CIRCLE || lanes[l].u16AzimuthBase >= CIRCLE) {
+				printf("Frame decoder: invalid lane angles\n");
+				return -1;
+			}
+		}
+		lanes[l].u64Time = doubleBits(header.dTimestamp);
+	}
+	std::vector<uint32_t> slots(STREAM_RAW * RANS_PROB_SCALE);
+	bool coded[STREAM_RAW];
+	for (int s = 0; s < STREAM_RAW; s++) {
+		uint64_t symbolNum;
+		if(!getVarint(pos, end, symbolNum) || symbolNum > 256) {
+			printf("Frame decoder: invalid frequency table\n");
+			return -1;
+		}
+		uint32_t cum = 0;
+		for (uint64_t i = 0; i < symbolNum; i++) {
+			uint64_t freq;
+			if(pos == end) {
+				printf("Frame decoder: invalid frequency table\n");
+				return -1;
+			}
+			uint8_t symbol = *pos++;
+			if(!getVarint(pos, end, freq) || 0 == freq || cum + freq > RANS_PROB_SCALE) {
+				printf("Frame decoder: invalid frequency table\n");
+				return -1;
+			}
+			for (uint32_t slot = 0; slot < freq; slot++) {
+				slots[s * RANS_PROB_SCALE + cum + slot] = (freq & 0xFFF) | slot << 12 | static_cast<uint32_t>(symbol) << 24;
+			}
+			cum += freq;
+		}
+		if(0 != symbolNum && RANS_PROB_SCALE != cum) {
+			printf("Frame decoder: invalid frequency table\n");
+			return -1;
+		}
+		coded[s] = 0 != symbolNum;
+	}
+	// no stream of a lane is longer than its points stored raw
+	uint64_t maxSymbols = (pointNum / laneNum + 1) * (RAW_POINT_SIZE + 2 * 10);
+	if(m_vecStreams.size() < static_cast<size_t>(laneNum) * STREAM_RAW) {
+		m_vecStreams.resize(laneNum * STREAM_RAW);
+	}
+	// the coded bytes of every stream first, they become the decoded symbols in the tasks
+	std::vector<LaneCursor> cursors(laneNum);
+	std::vector<uint64_t> symbolNums(laneNum * STREAM_RAW);
+	for (int l = 0; l < laneNum; l++) {
+		LaneCursor &cursor = cursors[l];
+		for (int s = 0; s < STREAM_RAW; s++) {
+			uint64_t symbolNum, byteNum;
+			if(!getVarint(pos, end, symbolNum) || !getVarint(pos, end, byteNum) || symbolNum > maxSymbols ||
+					byteNum > static_cast<uint64_t>(end - pos) || (0 != symbolNum && !coded[s])) {
+				printf("Frame decoder: invalid lane %d\n", l);
+				return -1;
+			}
+			cursor.pos[s] = pos;
+			cursor.end[s] = pos + byteNum;
+			symbolNums[l * STREAM_RAW + s] = symbolNum;
+			pos += byteNum;
+		}
+		uint64_t rawSize;
+		if(!getVarint(pos, end, rawSize) || rawSize > static_cast<uint64_t>(end - pos)) {
+			printf("Frame decoder: invalid lane %d\n", l);
+			return -1;
+		}
+		cursor.pos[STREAM_RAW] = pos;
+		cursor.end[STREAM_RAW] = pos + rawSize;
+		pos += rawSize;
+	}
+	// every point has its kind, empty ones may cost no byte, so the kinds bound the frame instead of its size
+	for (int l = 0; l < laneNum; l++) {
+		if(symbolNums[l * STREAM_RAW + STREAM_KIND] != pointNum / laneNum) {
+			printf("Frame decoder: lane %d does not hold %lu points\n", l, pointNum / laneNum);
+			return -1;
+		}
+	}
+	cloud.resize(pointNum);
+	cloud.width = header.u32Width;
+	cloud.height = header.u32Height;
+	// one task per group of lanes on the SDK's executor: the streams of its lanes, then
+	// their points lane by lane over blocks of columns that stay in the cache
+	tf::Executor &executor = sharedExecutor();
+	int groupNum = std::max<int>(1, std::min<int>(laneNum, executor.num_workers()));
+	int groupLanes = (laneNum + groupNum - 1) / groupNum;
+	size_t columnNum = pointNum / laneNum;
+	std::vector<int> failedLanes(groupNum, -1);
+	auto decodeGroup = [&](int group) {
+		int laneEnd = std::min(laneNum, (group + 1) * groupLanes);
+		for (int l = group * groupLanes; l < laneEnd; l++) {
+			for (int s = 0; s < STREAM_RAW; s++) {
+				std::vector<uint8_t> &stream = m_vecStreams[l * STREAM_RAW + s];
+				LaneCursor &cursor = cursors[l];
+				stream.resize(symbolNums[l * STREAM_RAW + s]);
+				if(!ransDecode(cursor.pos[s], cursor.end[s] - cursor.pos[s], &slots[s * RANS_PROB_SCALE], stream.data(), stream.size())) {
+					failedLanes[group] = l;
+					return;
+				}
+				cursor.pos[s] = stream.data();
+				cursor.end[s] = stream.data() + stream.size();
+			}
+		}
+		for (size_t column = 0; column < columnNum; column += DECODE_BLOCK_COLUMNS) {
+			size_t blockColumns = std::min<size_t>(DECODE_BLOCK_COLUMNS, columnNum - column);
+			for (int l = group * groupLanes; l < laneEnd; l++) {
+				if(!decodeLane(cursors[l], lanes[l], l, laserNum, returnNum, angleSize, column,
+						cloud.points.data() + column * laneNum + l, blockColumns)) {
+					failedLanes[group] = l;
+					return;
+				}
+			}
+		}
+	};
+	if(1 == groupNum) {
+		decodeGroup(0);
+	}
+	else {
+		tf::Taskflow taskFlow;
+		taskFlow.parallel_for(0, groupNum, 1, decodeGroup);
+		executor.run(taskFlow).wait();
+	}
+	for (int g = 0; g < groupNum; g++) {
+		if(failedLanes[g] >= 0) {
+			printf("Frame decoder: invalid lane %d\n", failedLanes[g]);
+			return -1;
+		}
+	}
+	timestamp = header.dTimestamp;
+	return 0;
+}
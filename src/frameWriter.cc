@@ -0,0 +1,252 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   FrameWriter: binary PCD / columnar / compressed frame files from a dedicated I/O thread
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "frameWriter.h"
+#include "platUtil.h"
+
+#define FRAME_PCD_POINT_SIZE (26)
+#define FRAME_COLUMNS_POINT_SIZE (18)
+
+FrameWriter::FrameWriter() {
+	m_pIoThread = NULL;
+	m_bStopRequest = false;
+	m_bWriting = false;
+	m_u64FrameNumber = 0;
+	m_u64PushedFrames = 0;
+	m_u64WrittenFrames = 0;
+	m_u64WrittenBytes = 0;
+	m_u64DroppedFrames = 0;
+	m_u64FailedFrames = 0;
+}
+
+FrameWriter::~FrameWriter() {
+	stop();
+}
+
+int FrameWriter::start(const FrameWriterConfig &config) {
+	if(NULL != m_pIoThread) {
+		printf("Frame writer is already running\n");
+		return -1;
+	}
+	if(config.filePrefix.empty()) {
+		printf("Frame writer needs a file prefix\n");
+		return -1;
+	}
+	m_objConfig = config;
+	if(m_objConfig.format != FRAME_WRITER_FORMAT_COLUMNS && m_objConfig.format != FRAME_WRITER_FORMAT_COMPRESSED) {
+		m_objConfig.format = FRAME_WRITER_FORMAT_PCD;
+	}
+	if(0 == m_objConfig.u32QueueSize) {
+		m_objConfig.u32QueueSize = FRAME_WRITER_QUEUE_SIZE;
+	}
+	if(0 == m_objConfig.u32Decimation) {
+		m_objConfig.u32Decimation = 1;
+	}
+	m_u64FrameNumber = 0;
+	m_u64PushedFrames = 0;
+	m_u64WrittenFrames = 0;
+	m_u64WrittenBytes = 0;
+	m_u64DroppedFrames = 0;
+	m_u64FailedFrames = 0;
+	m_bStopRequest = false;
+	m_bWriting.store(true, boost::memory_order_release);
+	m_pIoThread = new boost::thread(boost::bind(&FrameWriter::ioThread, this));
+	return 0;
+}
+
+void FrameWriter::stop() {
+	if(NULL == m_pIoThread) {
+		return;
+	}
+	m_bWriting.store(false, boost::memory_order_release);
+	{
+		boost::mutex::scoped_lock lock(m_mutexQueue);
+		m_bStopRequest = true;
+		m_condQueue.notify_one();
+	}
+	m_pIoThread->join();
+	delete m_pIoThread;
+	m_pIoThread = NULL;
+	printf("Frame writer stopped, written: %lu, dropped: %lu, failed: %lu\n",
+		   (unsigned long)m_u64WrittenFrames.load(), (unsigned long)m_u64DroppedFrames.load(),
+		   (unsigned long)m_u64FailedFrames.load());
+}
+
+void FrameWriter::push(boost::shared_ptr<pcl::PointCloud<PointXYZIT> > cloud, double timestamp, int laserNum, int returnNum) {
+	if(!isWriting()) {
+		return;
+	}
+	uint64_t number = ++m_u64FrameNumber;
+	if(0 != number % m_objConfig.u32Decimation ||
+			(0 != m_objConfig.u32MaxFrames && number / m_objConfig.u32Decimation > m_objConfig.u32MaxFrames)) {
+		return;
+	}
+	m_u64PushedFrames.fetch_add(1, boost::memory_order_relaxed);
+	boost::mutex::scoped_lock lock(m_mutexQueue);
+	if(m_queFrames.size() >= m_objConfig.u32QueueSize) {
+		m_u64DroppedFrames.fetch_add(1, boost::memory_order_relaxed);
+		return;
+	}
+	QueuedFrame frame = {cloud, timestamp, number, laserNum, returnNum};
+	m_queFrames.push_back(frame);
+	m_condQueue.notify_one();
+}
+
+FrameWriterStats FrameWriter::getStats() {
+	FrameWriterStats stats;
+	stats.u64PushedFrames = m_u64PushedFrames.load(boost::memory_order_relaxed);
+	stats.u64WrittenFrames = m_u64WrittenFrames.load(boost::memory_order_relaxed);
+	stats.u64WrittenBytes = m_u64WrittenBytes.load(boost::memory_order_relaxed);
+	stats.u64DroppedFrames = m_u64DroppedFrames.load(boost::memory_order_relaxed);
+	stats.u64FailedFrames = m_u64FailedFrames.load(boost::memory_order_relaxed);
+	stats.bWriting = m_bWriting.load(boost::memory_order_relaxed);
+	return stats;
+}
+
+void FrameWriter::ioThread() {
+	SetThreadPriority(SCHED_OTHER, 0);
+	while (1) {
+		QueuedFrame frame;
+		{
+			boost::mutex::scoped_lock lock(m_mutexQueue);
+			while (m_queFrames.empty() && !m_bStopRequest) {
+				m_condQueue.wait(lock);
+			}
+			if(m_queFrames.empty()) {
+				break;  // stopped and drained
+			}
+			frame = m_queFrames.front();
+			m_queFrames.pop_front();
+		}
+		int ret = 0;
+		if(m_objConfig.format == FRAME_WRITER_FORMAT_COLUMNS) {
+			serializeColumns(*frame.cloud, frame.timestamp);
+		}
+		else if(m_objConfig.format == FRAME_WRITER_FORMAT_COMPRESSED) {
+			ret = m_objEncoder.encode(*frame.cloud, frame.timestamp, frame.laserNum, frame.returnNum, m_vecBuffer);
+		}
+		else {
+			serializePcd(*frame.cloud);
+		}
+		frame.cloud.reset();  // the SDK may reuse the cloud from now on
+		if(0 == ret && 0 == writeFile(frame.number)) {
+			m_u64WrittenFrames.fetch_add(1, boost::memory_order_relaxed);
+			m_u64WrittenBytes.fetch_add(m_vecBuffer.size(), boost::memory_order_relaxed);
+		}
+		else {
+			m_u64FailedFrames.fetch_add(1, boost::memory_order_relaxed);
+		}
+	}
+}
+
+void FrameWriter::serializePcd(const pcl::PointCloud<PointXYZIT> &cloud) {
+	uint32_t pointNum = 0;
+	for (size_t i = 0; i < cloud.points.size(); i++) {
+		pointNum += !m_objConfig.bSkipEmpty || 0 != cloud.points[i].ring;
+	}
+	bool organized = !m_objConfig.bSkipEmpty && cloud.width * cloud.height == pointNum;
+	char header[512];
+	int headerSize = snprintf(header, sizeof(header),
+			"# .PCD v0.7 - Point Cloud Data file format\n"
+			"VERSION 0.7\n"
+			"FIELDS x y z intensity timestamp ring\n"
+			"SIZE 4 4 4 4 8 2\n"
+			"TYPE F F F F F U\n"
+			"COUNT 1 1 1 1 1 1\n"
+			"WIDTH %u\n"
+			"HEIGHT %u\n"
+			"VIEWPOINT 0 0 0 1 0 0 0\n"
+			"POINTS %u\n"
+			"DATA binary\n",
+			organized ? cloud.width : pointNum, organized ? cloud.height : 1, pointNum);
+	m_vecBuffer.resize(headerSize + static_cast<size_t>(pointNum) * FRAME_PCD_POINT_SIZE);
+	memcpy(m_vecBuffer.data(), header, headerSize);
+	uint8_t *out = m_vecBuffer.data() + headerSize;
+	for (size_t i = 0; i < cloud.points.size(); i++) {
+		const PointXYZIT &point = cloud.points[i];
+		if(m_objConfig.bSkipEmpty && 0 == point.ring) {
+			continue;
+		}
+		memcpy(out, &point.x, 3 * sizeof(float));
+		memcpy(out + 12, &point.intensity, sizeof(float));
+		memcpy(out + 16, &point.timestamp, sizeof(double));
+		memcpy(out + 24, &point.ring, sizeof(uint16_t));
+		out += FRAME_PCD_POINT_SIZE;
+	}
+}
+
+void FrameWriter::serializeColumns(const pcl::PointCloud<PointXYZIT> &cloud, double timestamp) {
+	uint32_t pointNum = 0;
+	for (size_t i = 0; i < cloud.points.size(); i++) {
+		pointNum += !m_objConfig.bSkipEmpty || 0 != cloud.points[i].ring;
+	}
+	FrameColumnsHeader header;
+	header.u32Magic = FRAME_COLUMNS_MAGIC;
+	header.u16Version = FRAME_COLUMNS_VERSION;
+	header.u16Reserved = 0;
+	header.u32PointNum = pointNum;
+	header.u32Width = m_objConfig.bSkipEmpty ? 0 : cloud.width;
+	header.u32Height = m_objConfig.bSkipEmpty ? 0 : cloud.height;
+	header.dTimestamp = timestamp;
+	m_vecBuffer.resize(sizeof(header) + static_cast<size_t>(pointNum) * FRAME_COLUMNS_POINT_SIZE);
+	memcpy(m_vecBuffer.data(), &header, sizeof(header));
+	float *x = reinterpret_cast<float *>(m_vecBuffer.data() + sizeof(header));
+	float *y = x + pointNum;
+	float *z = y + pointNum;
+	float *time = z + pointNum;
+	uint8_t *intensity = reinterpret_cast<uint8_t *>(time + pointNum);
+	uint8_t *ring = intensity + pointNum;
+	uint32_t index = 0;
+	for (size_t i = 0; i < cloud.points.size(); i++) {
+		const PointXYZIT &point = cloud.points[i];
+		if(m_objConfig.bSkipEmpty && 0 == point.ring) {
+			continue;
+		}
+		x[index] = point.x;
+		y[index] = point.y;
+		z[index] = point.z;
+		time[index] = 0 != point.ring ? static_cast<float>(point.timestamp - timestamp) : 0;
+		intensity[index] = static_cast<uint8_t>(point.intensity);
+		ring[index] = static_cast<uint8_t>(point.ring);
+		index++;
+	}
+}
+
+int FrameWriter::writeFile(uint64_t number) {
+	char path[1024];
+	snprintf(path, sizeof(path), "%s_%06lu.%s", m_objConfig.filePrefix.c_str(), (unsigned long)number, m_objConfig.format.c_str());
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0) {
+		printf("Frame writer: open %s failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+	const uint8_t *data = m_vecBuffer.data();
+	size_t left = m_vecBuffer.size();
+	while (left > 0) {
+		ssize_t written = write(fd, data, left);
+		if(written < 0) {
+			if(EINTR == errno) {
+				continue;
+			}
+			printf("Frame writer: write %s failed: %s\n", path, strerror(errno));
+			close(fd);
+			return -1;
+		}
+		data += written;
+		left -= written;
+	}
+	close(fd);
+	return 0;
+}
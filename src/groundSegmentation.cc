@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   GroundSegmentation: per-column slope walk over the rings
+ */
+#include <math.h>
+#include <algorithm>
+#include "groundSegmentation.h"
+
+GroundSegmentation::GroundSegmentation() {
+	setConfig(GroundSegmentationConfig());
+	m_iLaserNum = 0;
+}
+
+void GroundSegmentation::setConfig(const GroundSegmentationConfig &config) {
+	m_objConfig = config;
+	m_fLocalSlopeTan = tanf(config.maxLocalSlope * M_PI / 180.0f);
+	m_fGlobalSlopeTan = tanf(config.maxGlobalSlope * M_PI / 180.0f);
+}
+
+int GroundSegmentation::prepare(int columnNum, int laserNum, const float *elevation, std::vector<uint8_t> &labels) {
+	m_iLaserNum = laserNum;
+	m_vecRingOrder.resize(laserNum);
+	for (int i = 0; i < laserNum; i++) {
+		m_vecRingOrder[i] = i;
+	}
+	std::sort(m_vecRingOrder.begin(), m_vecRingOrder.end(), [elevation](int a, int b) {
+		return elevation[a] < elevation[b];
+	});
+	labels.assign(columnNum * laserNum, GROUND_LABEL_NONE);
+	return columnNum;
+}
+
+void GroundSegmentation::segmentColumns(const pcl::PointCloud<PointXYZIT> &cloud, int begin, int end, std::vector<uint8_t> &labels) {
+	for (int column = begin; column < end; column++) {
+		int base = column * m_iLaserNum;
+		float groundR = 0;
+		float groundZ = m_objConfig.groundZ;
+		for (int k = 0; k < m_iLaserNum; k++) {
+			int index = base + m_vecRingOrder[k];
+			const PointXYZIT &point = cloud.points[index];
+			if(0 == point.ring) {
+				continue;
+			}
+			float r = sqrtf(point.x * point.x + point.y * point.y);
+			bool global = fabsf(point.z - m_objConfig.groundZ) <= m_fGlobalSlopeTan * r + m_objConfig.heightTolerance;
+			bool local = fabsf(point.z - groundZ) <= m_fLocalSlopeTan * std::max(r - groundR, 0.0f) + m_objConfig.heightTolerance;
+			if(global && local) {
+				labels[index] = GROUND_LABEL_GROUND;
+				groundR = r;
+				groundZ = point.z;
+			}
+			else {
+				labels[index] = GROUND_LABEL_OBSTACLE;
+			}
+		}
+	}
+}
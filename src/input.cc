@@ -186,7 +186,6 @@ InputSocket::InputSocket(std::string deviceipaddr, uint16_t lidarport, uint16_t
 	: Input(deviceipaddr, lidarport) {
 	m_iSockfd = -1;
 	m_iSockGpsfd = -1;
-	m_u32Sequencenum = 0;
 
 	// connect to Pandar UDP port
 	printf("Opening UDP socket: %d\n", lidarport);
@@ -301,6 +300,7 @@ int InputSocket::getPacket(PandarPacket *pkt) {
     	if (fds[i].revents & POLLIN) {
       		nbytes = recvfrom(fds[i].fd, &pkt->data[0], 10000, 0, (sockaddr *)&sender_address, &sender_address_len);
 			pkt->size = nbytes;
+			pkt->stamp = getNowTimeSec();
 			// printf("fds[%d] size: %d\n",i, nbytes);
       		break;
     	}
@@ -312,43 +312,9 @@ int InputSocket::getPacket(PandarPacket *pkt) {
 	else if(!checkPacketSize(pkt)){
 		return 1;  // Packet size not match
 	}
-	calcPacketLoss(pkt);
 	return 0;
 }
 
-void InputSocket::calcPacketLoss(PandarPacket *pkt) {
-	if(m_bGetUdpVersion) {
-		if(m_sUdpVresion == UDP_VERSION_1_4 && !(pkt->data[11] & 1))
-			return;
-		static uint32_t dropped = 0, u32StartSeq = 0;
-		static uint32_t startTick = GetTickCount();
-		uint32_t *pSeq = (uint32_t *)&pkt->data[m_iSequenceNumberIndex];
-		uint32_t seqnub = *pSeq;
-		// printf("index: %d,%d, seq: %d\n", nbytes, m_iSequenceNumberIndex, seqnub);
-
-		if(m_u32Sequencenum == 0) {
-			m_u32Sequencenum = seqnub;
-			u32StartSeq = m_u32Sequencenum;
-		} 
-		else {
-			uint32_t diff = seqnub - m_u32Sequencenum;
-			if(diff > 1) {
-				printf("seq diff: %x \n", diff);
-				dropped += diff - 1;
-			}
-		}
-		m_u32Sequencenum = seqnub;
-		uint32_t endTick = GetTickCount();
-		if(endTick - startTick >= 1000 && dropped > 0) {
-			printf("dropped: %d, %d, percent, %f\n", dropped, m_u32Sequencenum - u32StartSeq,
-					float(dropped) / float(m_u32Sequencenum - u32StartSeq) * 100.0);
-			dropped = 0;
-			u32StartSeq = m_u32Sequencenum;
-			startTick = endTick;
-		}
-	}
-}
-
 ////////////////////////////////////////////////////////////////////////
 // InputPCAP class implementation
 ////////////////////////////////////////////////////////////////////////
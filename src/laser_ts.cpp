@@ -40,23 +40,47 @@
 #define PANDAR128_COORDINATE_CORRECTION_H (0.04)
 #define PANDAR128_COORDINATE_CORRECTION_B (0.012)
 
+// The coordinate correction tables only depend on the mechanical constants,
+// build them once and let every LasersTSOffset read the same copy.
+struct LasersTSTable {
+  float sinAllAngleHB[CIRCLE];
+  float sinAllAngleH[CIRCLE];
+  float arcSin[PAI_ANGLE];
+
+  LasersTSTable() {
+    for (int j = 0; j < CIRCLE; j++) {
+      float angle = static_cast<float>(j) / 100.0f;
+
+      sinAllAngleHB[j] = sinf(A_TO_R * angle) * sqrtf(PANDAR128_COORDINATE_CORRECTION_B * PANDAR128_COORDINATE_CORRECTION_B  + PANDAR128_COORDINATE_CORRECTION_H * PANDAR128_COORDINATE_CORRECTION_H);
+      sinAllAngleH[j] = sinf(A_TO_R * angle) * PANDAR128_COORDINATE_CORRECTION_H;
+    }
+
+    for (int j = 0; j < PAI_ANGLE; j++) {
+      arcSin[j] = asinf(float(j - HALF_PAI_ANGLE) / HALF_PAI_ANGLE);
+    }
+  }
+};
+
+static const LasersTSTable &sharedLasersTSTable() {
+  static const LasersTSTable table;
+  return table;
+}
+
 LasersTSOffset::LasersTSOffset() {
   mBInitFlag = false;
   mNLaserNum = 0;
 
-  for (int j = 0; j < CIRCLE; j++) {
-    float angle = static_cast<float>(j) / 100.0f;
-
-    mSinAllAngleHB[j] = sinf(A_TO_R * angle) * sqrtf(PANDAR128_COORDINATE_CORRECTION_B * PANDAR128_COORDINATE_CORRECTION_B  + PANDAR128_COORDINATE_CORRECTION_H * PANDAR128_COORDINATE_CORRECTION_H);
-    mSinAllAngleH[j] = sinf(A_TO_R * angle) * PANDAR128_COORDINATE_CORRECTION_H;
-  }
-
-  for (int j = 0; j < PAI_ANGLE; j++) {
-    mArcSin[j] = asinf(float(j - HALF_PAI_ANGLE) / HALF_PAI_ANGLE);
-  }
+  const LasersTSTable &table = sharedLasersTSTable();
+  mSinAllAngleHB = table.sinAllAngleHB;
+  mSinAllAngleH = table.sinAllAngleH;
+  mArcSin = table.arcSin;
 
   mShortOffsetIndex.resize(100);
   mLongOffsetIndex.resize(100);
+  // a channel missing from the firetime file gets no offset instead of garbage
+  memset(m_fAzimuthOffset, 0, sizeof(m_fAzimuthOffset));
+  memset(m_fCDAAzimuthOffset, 0, sizeof(m_fCDAAzimuthOffset));
+  memset(m_fCDBAzimuthOffset, 0, sizeof(m_fCDBAzimuthOffset));
   m_fArctanHB = atanf(PANDAR128_COORDINATE_CORRECTION_B / PANDAR128_COORDINATE_CORRECTION_H) + 0.5f;
 }
 
@@ -198,30 +222,6 @@ void LasersTSOffset::fillVector(char *pContent, int nLen, std::vector<int> &vec)
   }
 }
 
-float LasersTSOffset::getTSOffset(int nLaser, int nMode, int nState, float fDistance, int nMajorVersion) {
-  switch (nMajorVersion){
-    case 1:
-      if (nLaser >= mNLaserNum || !mBInitFlag) {
-        return 0;
-      }
-      if (fDistance >= mFDist) {
-        return mVLasers[nLaser][mLongOffsetIndex[nMode * 10 + nState]];
-      } 
-      else {
-        return mVLasers[nLaser][mShortOffsetIndex[nMode * 10 + nState]];
-      }
-    case 3:
-      switch (nMode){
-        case 0:
-          return m_fCDAAzimuthOffset[nLaser];
-        case 1:
-          return m_fCDBAzimuthOffset[nLaser];
-      }
-    default:
-      return 0;
-  }
-}
-
 int LasersTSOffset::getBlockTS(int nBlock, int nRetMode, int nMode, int nLaserNum) {
   switch (nLaserNum){
     case PANDAR80_LIDAR_NUM:
@@ -245,19 +245,7 @@ int LasersTSOffset::getBlockTS(int nBlock, int nRetMode, int nMode, int nLaserNu
   }
 }
 
-float LasersTSOffset::getAngleOffset(float nTSOffset, int speed, int nMajorVersion) {
-  switch (nMajorVersion){
-    case 1:
-      return nTSOffset * speed * 6E-9;
-    case 3:
-      return nTSOffset * speed * 6E-6;
-    default:
-      return 0;
-  }
-}
-
-
-float LasersTSOffset::getAzimuthOffset(std::string type, float azimuth, \
+float LasersTSOffset::getAzimuthOffset(const std::string &type, float azimuth, \
     float originAzimuth, float distance) {
   int  angle = static_cast<int>(100 * (m_fArctanHB + azimuth - originAzimuth));
 
@@ -280,7 +268,7 @@ float LasersTSOffset::getAzimuthOffset(std::string type, float azimuth, \
   return -mArcSin[index];
 }
 
-float LasersTSOffset::getPitchOffset(std::string type, float pitch, float distance) {
+float LasersTSOffset::getPitchOffset(const std::string &type, float pitch, float distance) {
   int  angle = static_cast<int>(100 * pitch + 0.5f);
 
   if (angle < 0) {
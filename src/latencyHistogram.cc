@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   LatencyHistogram: log-linear microsecond histogram
+ */
+#include "latencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+void LatencyHistogram::reset() {
+	for (int i = 0; i < LATENCY_BUCKET_NUM; i++) {
+		m_arrBuckets[i].store(0, boost::memory_order_relaxed);
+	}
+	m_u64Count.store(0, boost::memory_order_relaxed);
+	m_u64Sum.store(0, boost::memory_order_relaxed);
+	m_u64Max.store(0, boost::memory_order_relaxed);
+	m_u64Min.store(UINT64_MAX, boost::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+	if(index < LATENCY_LINEAR_BUCKETS) {
+		return index;
+	}
+	int magnitude = (index - LATENCY_LINEAR_BUCKETS) / LATENCY_SUB_BUCKETS + 5;
+	uint64_t sub = (index - LATENCY_LINEAR_BUCKETS) % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+	return ((sub + 1) << (magnitude - LATENCY_SUB_BUCKET_BITS)) - 1;
+}
+
+LatencySnapshot LatencyHistogram::getSnapshot() {
+	LatencySnapshot snapshot;
+	uint64_t buckets[LATENCY_BUCKET_NUM];
+	uint64_t total = 0;
+	for (int i = 0; i < LATENCY_BUCKET_NUM; i++) {
+		buckets[i] = m_arrBuckets[i].load(boost::memory_order_relaxed);
+		total += buckets[i];
+	}
+	snapshot.u64Count = m_u64Count.load(boost::memory_order_relaxed);
+	snapshot.dMeanUs = snapshot.u64Count > 0 ? static_cast<double>(m_u64Sum.load(boost::memory_order_relaxed)) / snapshot.u64Count : 0;
+	snapshot.u64MaxUs = m_u64Max.load(boost::memory_order_relaxed);
+	snapshot.u64MinUs = snapshot.u64Count > 0 ? m_u64Min.load(boost::memory_order_relaxed) : 0;
+	// the buckets are read one by one while recording goes on, the percentiles use their own total
+	const double quantiles[4] = {0.5, 0.9, 0.99, 0.999};
+	uint64_t *results[4] = {&snapshot.u64P50Us, &snapshot.u64P90Us, &snapshot.u64P99Us, &snapshot.u64P999Us};
+	int q = 0;
+	uint64_t seen = 0;
+	for (int i = 0; i < LATENCY_BUCKET_NUM && q < 4; i++) {
+		seen += buckets[i];
+		while (q < 4 && total > 0 && seen >= quantiles[q] * total) {
+			uint64_t value = bucketUpperBound(i);
+			*results[q] = value < snapshot.u64MaxUs ? value : snapshot.u64MaxUs;
+			q++;
+		}
+	}
+	for (; q < 4; q++) {
+		*results[q] = 0;
+	}
+	return snapshot;
+}
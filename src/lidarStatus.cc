@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   LidarStatusPoller: sensor status over PTC, published as a seqlock snapshot
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include "lidarStatus.h"
+#include "platUtil.h"
+
+static inline uint32_t readU32(const uint8_t *p) {
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline uint16_t readU16(const uint8_t *p) {
+	return (uint16_t(p[0]) << 8) | uint16_t(p[1]);
+}
+
+LidarStatusPoller::LidarStatusPoller() {
+	m_pClient = NULL;
+	m_u32Period = 1000;
+	m_pollThread = NULL;
+	m_bInFlight = false;
+	m_u32Sequence = 0;
+	for (int i = 0; i < m_iWordNum; i++) {
+		m_arrSnapshot[i] = 0;
+	}
+}
+
+LidarStatusPoller::~LidarStatusPoller() {
+	stop();
+}
+
+int LidarStatusPoller::parseStatus(const uint8_t *data, uint32_t len, LidarStatus &status) {
+	if(NULL == data || len < PTC_LIDAR_STATUS_MIN_SIZE) {
+		return -1;
+	}
+	int index = 0;
+	status.u32Uptime = readU32(&data[index]);
+	index += 4;
+	status.u16MotorSpeed = readU16(&data[index]);
+	index += 2;
+	for (int i = 0; i < LIDAR_STATUS_TEMPERATURE_NUM; i++) {
+		status.fTemperature[i] = int32_t(readU32(&data[index])) * 0.01f;  // 0.01 degree
+		index += 4;
+	}
+	status.u8GpsPpsLock = data[index++];
+	status.u8GpsGprmcStatus = data[index++];
+	status.u32StartupTimes = readU32(&data[index]);
+	index += 4;
+	status.u32OperationMinutes = readU32(&data[index]);
+	index += 4;
+	status.u8PtpStatus = data[index];
+	return 0;
+}
+
+int LidarStatusPoller::start(void *client, uint32_t periodms, boost::function<void(const LidarStatus &)> statuscallback) {
+	if(NULL == client || NULL != m_pollThread) {
+		return -1;
+	}
+	m_pClient = client;
+	m_u32Period = periodms > 0 ? periodms : 1;
+	m_funcStatusCallback = statuscallback;
+	m_pollThread = new boost::thread(boost::bind(&LidarStatusPoller::pollThread, this));
+	return 0;
+}
+
+void LidarStatusPoller::stop() {
+	if(NULL == m_pollThread) {
+		return;
+	}
+	m_pollThread->interrupt();
+	m_pollThread->join();
+	delete m_pollThread;
+	m_pollThread = NULL;
+	// the reply refers to this, wait for it; the client gives up after its io timeout
+	while (m_bInFlight.load(boost::memory_order_acquire)) {
+		usleep(1000);
+	}
+}
+
+void LidarStatusPoller::pollThread() {
+	while (1) {
+		if(!m_bInFlight.exchange(true, boost::memory_order_acq_rel)) {
+			if(PTC_ERROR_NO_ERROR != TcpCommandSendAsync(m_pClient, PTC_COMMAND_GET_LIDAR_STATUS, NULL, 0, &LidarStatusPoller::onReply, this)) {
+				onReply(this, PTC_ERROR_TRANSFER_FAILED, 0, NULL, 0);
+			}
+		}
+		boost::this_thread::sleep(boost::posix_time::milliseconds(m_u32Period));
+	}
+}
+
+void LidarStatusPoller::onReply(void *userdata, PTC_ErrCode error, unsigned char retcode, const unsigned char *data, unsigned int len) {
+	LidarStatusPoller *poller = static_cast<LidarStatusPoller *>(userdata);
+	LidarStatus &status = poller->m_objLast;
+	if(PTC_ERROR_NO_ERROR == error && 0 == retcode && 0 == parseStatus(data, len, status)) {
+		status.u64UpdateUs = GetMicroTickCountU64();
+		status.u32Failures = 0;
+		status.u8RetCode = 0;
+	}
+	else {
+		status.u32Failures++;
+		if(PTC_ERROR_NO_ERROR == error) {
+			status.u8RetCode = retcode;
+		}
+	}
+	poller->publish(status);
+	if(poller->m_funcStatusCallback) {
+		poller->m_funcStatusCallback(status);
+	}
+	poller->m_bInFlight.store(false, boost::memory_order_release);
+}
+
+void LidarStatusPoller::publish(const LidarStatus &status) {
+	uint64_t words[m_iWordNum] = {0};
+	memcpy(words, &status, sizeof(LidarStatus));
+	uint32_t sequence = m_u32Sequence.load(boost::memory_order_relaxed);
+	m_u32Sequence.store(sequence + 1, boost::memory_order_relaxed);
+	boost::atomic_thread_fence(boost::memory_order_release);
+	for (int i = 0; i < m_iWordNum; i++) {
+		m_arrSnapshot[i].store(words[i], boost::memory_order_relaxed);
+	}
+	m_u32Sequence.store(sequence + 2, boost::memory_order_release);
+}
+
+bool LidarStatusPoller::getStatus(LidarStatus &status) {
+	uint64_t words[m_iWordNum];
+	uint32_t sequence;
+	while (1) {
+		sequence = m_u32Sequence.load(boost::memory_order_acquire);
+		if(sequence & 1) {
+			continue;
+		}
+		for (int i = 0; i < m_iWordNum; i++) {
+			words[i] = m_arrSnapshot[i].load(boost::memory_order_relaxed);
+		}
+		boost::atomic_thread_fence(boost::memory_order_acquire);
+		if(m_u32Sequence.load(boost::memory_order_relaxed) == sequence) {
+			break;
+		}
+	}
+	memcpy(&status, words, sizeof(LidarStatus));
+	return 0 != status.u64UpdateUs;
+}
@@ -0,0 +1,276 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   PacketGenerator: synthetic UDP 1.3 / 1.4 / 3.2 packets
+ */
+#include <arpa/inet.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "packetGenerator.h"
+#include "packetRecorder.h"
+#include "pandarSwiftSDK.h"
+#include "platUtil.h"
+
+#define GENERATOR_TAIL_SIZE (sizeof(Pandar128TailVersion14) - PANDAR128_SEQ_NUM_SIZE)
+#define GENERATOR_GROUND_INTENSITY (20)
+#define GENERATOR_WALL_INTENSITY (80)
+
+PacketGenerator::PacketGenerator(const PacketGeneratorConfig &config) {
+	m_objConfig = config;
+	if(1 == m_objConfig.u8VersionMajor && 3 == m_objConfig.u8VersionMinor) {
+		m_objConfig.laserNum = PANDAR128_LASER_NUM;
+		m_objConfig.blockNum = PANDAR128_BLOCK_NUM;
+		m_objConfig.u8Flags = 0;
+	}
+	if(3 == m_objConfig.u8VersionMajor) {
+		m_objConfig.laserNum = PANDAR128_LASER_NUM;
+	}
+	// blocks per packet of the real sensors, the packets per frame match the driver's read sizes
+	m_iBlockNum = m_objConfig.blockNum;
+	if(m_iBlockNum <= 0) {
+		if(PANDAR64S_LASER_NUM == m_objConfig.laserNum && 1 == m_objConfig.u8VersionMajor) {
+			m_iBlockNum = 4;
+		}
+		else if(PANDAR40S_LASER_NUM == m_objConfig.laserNum && 1 == m_objConfig.u8VersionMajor) {
+			m_iBlockNum = MAX_BLOCK_NUM;
+		}
+		else {
+			m_iBlockNum = PANDAR128_BLOCK_NUM;
+		}
+	}
+	m_iReturnNum = (0x39 == m_objConfig.u8ReturnMode || 0x3b == m_objConfig.u8ReturnMode || 0x3c == m_objConfig.u8ReturnMode) ? 2 : 1;
+	if(m_iBlockNum % m_iReturnNum != 0) {
+		m_iBlockNum++;
+	}
+	// azimuth resolution as expected by PandarSwiftSDK::changeAngleSize
+	int speedScale = m_objConfig.u16MotorSpeed >= MOTOR_SPEED_1200 - 100 ? 2 : 1;
+	if(3 == m_objConfig.u8VersionMajor) {
+		m_iAngleStep = LIDAR_ANGLE_SIZE_40 * speedScale;
+	}
+	else if(PANDAR80_LASER_NUM == m_objConfig.laserNum) {
+		m_iAngleStep = LIDAR_ANGLE_SIZE_18;
+	}
+	else if(PANDAR64S_LASER_NUM == m_objConfig.laserNum || PANDAR40S_LASER_NUM == m_objConfig.laserNum) {
+		m_iAngleStep = LIDAR_ANGLE_SIZE_20 * speedScale;
+	}
+	else {
+		m_iAngleStep = (0 == m_objConfig.u8WorkMode ? LIDAR_ANGLE_SIZE_10 : LIDAR_ANGLE_SIZE_20) * speedScale;
+	}
+	int azimuthsPerPacket = m_iBlockNum / m_iReturnNum;
+	m_iPacketsPerFrame = (CIRCLE_ANGLE / m_iAngleStep + azimuthsPerPacket - 1) / azimuthsPerPacket;
+	m_dPacketInterval = static_cast<double>(azimuthsPerPacket * m_iAngleStep) / CIRCLE_ANGLE / (m_objConfig.u16MotorSpeed / 60.0);
+
+	bool hasConfidence = m_objConfig.u8Flags & GENERATOR_FLAG_CONFIDENCE;
+	m_iUnitSize = hasConfidence ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE;
+	if(1 == m_objConfig.u8VersionMajor && 3 == m_objConfig.u8VersionMinor) {
+		m_iPacketSize = sizeof(Pandar128PacketVersion13);
+	}
+	else {
+		m_iPacketSize = PANDAR128_HEAD_SIZE + (PANDAR128_AZIMUTH_SIZE + m_iUnitSize * m_objConfig.laserNum) * m_iBlockNum +
+						PANDAR128_CRC_SIZE +
+						((m_objConfig.u8Flags & GENERATOR_FLAG_FUNCTION_SAFETY) ? PANDAR128_FUNCTION_SAFETY_SIZE : 0) +
+						GENERATOR_TAIL_SIZE +
+						((m_objConfig.u8Flags & GENERATOR_FLAG_SEQ_NUM) ? PANDAR128_SEQ_NUM_SIZE : 0) +
+						((m_objConfig.u8Flags & GENERATOR_FLAG_IMU) ? PANDAR128_IMU_SIZE : 0) +
+						PANDAR128_CRC_SIZE +
+						((m_objConfig.u8Flags & GENERATOR_FLAG_SIGNATURE) ? PANDAR128_SIGNATURE_SIZE : 0);
+	}
+	if(m_iPacketSize > ETHERNET_MTU) {
+		printf("Generated packet of %d bytes exceeds the MTU, use fewer blocks\n", m_iPacketSize);
+	}
+
+	// ground plane inside a cylindrical wall, the same for every azimuth
+	m_vecDistance.resize(m_objConfig.laserNum);
+	m_vecIntensity.resize(m_objConfig.laserNum);
+	for (int i = 0; i < m_objConfig.laserNum; i++) {
+		float elevation = m_objConfig.fMinElevation;
+		if(m_objConfig.laserNum > 1) {
+			elevation += (m_objConfig.fMaxElevation - m_objConfig.fMinElevation) * i / (m_objConfig.laserNum - 1);
+		}
+		float radian = elevation * M_PI / 180.0f;
+		float distance = m_objConfig.fWallRadius / cosf(radian);
+		m_vecIntensity[i] = GENERATOR_WALL_INTENSITY;
+		if(m_objConfig.fGroundHeight > 0 && elevation < 0) {
+			float ground = m_objConfig.fGroundHeight / sinf(-radian);
+			if(ground < distance) {
+				distance = ground;
+				m_vecIntensity[i] = GENERATOR_GROUND_INTENSITY;
+			}
+		}
+		float units = distance / PANDAR128_DISTANCE_UNIT;
+		m_vecDistance[i] = units > 65535 ? 0 : static_cast<uint16_t>(units);
+	}
+
+	if(0 == m_objConfig.dStartTime) {
+		m_objConfig.dStartTime = floor(getNowTimeSec());
+	}
+	m_u64PacketIndex = 0;
+	m_u32Seq = m_objConfig.u32StartSeq;
+	m_u16Azimuth = 0;
+}
+
+uint8_t *PacketGenerator::fillBlock(uint8_t *buf, uint16_t azimuth, int returnid) {
+	memcpy(buf, &azimuth, sizeof(azimuth));
+	buf += PANDAR128_AZIMUTH_SIZE;
+	for (int i = 0; i < m_objConfig.laserNum; i++) {
+		memcpy(buf, &m_vecDistance[i], sizeof(uint16_t));
+		// the second return is weaker
+		buf[DISTANCE_SIZE] = m_vecIntensity[i] >> returnid;
+		if(m_iUnitSize == PANDAR128_UNIT_WITH_CONFIDENCE_SIZE) {
+			buf[DISTANCE_SIZE + INTENSITY_SIZE] = 0;
+		}
+		buf += m_iUnitSize;
+	}
+	return buf;
+}
+
+void PacketGenerator::fillTime(uint8_t *utc, uint32_t *timestamp, double time) {
+	time_t second = static_cast<time_t>(time);
+	struct tm t;
+	gmtime_r(&second, &t);
+	utc[0] = t.tm_year;
+	utc[1] = t.tm_mon + 1;
+	utc[2] = t.tm_mday;
+	utc[3] = t.tm_hour;
+	utc[4] = t.tm_min;
+	utc[5] = t.tm_sec;
+	*timestamp = static_cast<uint32_t>((time - second) * 1000000);
+}
+
+void PacketGenerator::nextPacket(PandarPacket &pkt) {
+	memset(pkt.data, 0, m_iPacketSize);
+	pkt.size = m_iPacketSize;
+	pkt.stamp = m_objConfig.dStartTime + m_u64PacketIndex * m_dPacketInterval;
+	uint8_t shutdownFlag = m_objConfig.u8WorkMode & 0x03;
+	if(1 == m_objConfig.u8VersionMajor && 3 == m_objConfig.u8VersionMinor) {
+		Pandar128PacketVersion13 *packet = (Pandar128PacketVersion13 *)pkt.data;
+		packet->head.u16Sob = 0xFFEE;
+		packet->head.u8VersionMajor = 1;
+		packet->head.u8VersionMinor = 3;
+		packet->head.u8DistUnit = 4;
+		packet->head.u8LaserNum = PANDAR128_LASER_NUM;
+		packet->head.u8BlockNum = PANDAR128_BLOCK_NUM;
+		packet->head.u8EchoNum = m_iReturnNum;
+		for (int b = 0; b < PANDAR128_BLOCK_NUM; b++) {
+			uint16_t azimuth = (m_u16Azimuth + b / m_iReturnNum * m_iAngleStep) % CIRCLE_ANGLE;
+			fillBlock((uint8_t *)&packet->blocks[b], azimuth, b % m_iReturnNum);
+		}
+		packet->tail.nShutdownFlag = shutdownFlag;
+		packet->tail.nMotorSpeed = m_objConfig.u16MotorSpeed;
+		packet->tail.nReturnMode = m_objConfig.u8ReturnMode;
+		packet->tail.nSeqNum = m_u32Seq;
+		uint32_t timestamp;
+		fillTime(packet->tail.nUTCTime, &timestamp, pkt.stamp);
+		packet->tail.nTimestamp = timestamp;
+	}
+	else {
+		Pandar128HeadVersion14 *header = (Pandar128HeadVersion14 *)pkt.data;
+		header->u16Sob = 0xFFEE;
+		header->u8VersionMajor = m_objConfig.u8VersionMajor;
+		header->u8VersionMinor = m_objConfig.u8VersionMinor;
+		header->u8LaserNum = m_objConfig.laserNum;
+		header->u8BlockNum = m_iBlockNum;
+		header->u8DistUnit = 4;
+		header->u8EchoNum = m_iReturnNum;
+		header->u8Flags = m_objConfig.u8Flags;
+		uint8_t *buf = pkt.data + PANDAR128_HEAD_SIZE;
+		for (int b = 0; b < m_iBlockNum; b++) {
+			uint16_t azimuth = (m_u16Azimuth + b / m_iReturnNum * m_iAngleStep) % CIRCLE_ANGLE;
+			buf = fillBlock(buf, azimuth, b % m_iReturnNum);
+		}
+		buf += PANDAR128_CRC_SIZE;
+		buf += (m_objConfig.u8Flags & GENERATOR_FLAG_FUNCTION_SAFETY) ? PANDAR128_FUNCTION_SAFETY_SIZE : 0;
+		// 1.4 and QT128 share the tail layout
+		Pandar128TailVersion14 *tail = (Pandar128TailVersion14 *)buf;
+		tail->nShutdownFlag = shutdownFlag;
+		tail->nReturnMode = m_objConfig.u8ReturnMode;
+		tail->nMotorSpeed = m_objConfig.u16MotorSpeed;
+		uint32_t timestamp;
+		fillTime(tail->nUTCTime, &timestamp, pkt.stamp);
+		tail->nTimestamp = timestamp;
+		if(m_objConfig.u8Flags & GENERATOR_FLAG_SEQ_NUM) {
+			tail->nSeqNum = m_u32Seq;
+		}
+	}
+	m_u32Seq++;
+	m_u64PacketIndex++;
+	m_u16Azimuth = (m_u16Azimuth + m_iBlockNum / m_iReturnNum * m_iAngleStep) % CIRCLE_ANGLE;
+}
+
+int PacketGenerator::writePcap(std::string filename, uint32_t frames, uint16_t destport, std::string sourceip) {
+	FILE *fp = fopen(filename.c_str(), "wb");
+	if(NULL == fp) {
+		printf("Open pcap file %s failed\n", filename.c_str());
+		return -1;
+	}
+	PcapFileHeader header;
+	header.u32Magic = PCAP_MAGIC;
+	header.u16VersionMajor = 2;
+	header.u16VersionMinor = 4;
+	header.i32ThisZone = 0;
+	header.u32Sigfigs = 0;
+	header.u32Snaplen = PCAP_SNAPLEN;
+	header.u32LinkType = PCAP_LINKTYPE_ETHERNET;
+	fwrite(&header, sizeof(header), 1, fp);
+	uint32_t sourceAddr = inet_addr(sourceip.c_str());
+	uint8_t netHeader[PACKET_RECORDER_NET_HEADER_SIZE];
+	PandarPacket pkt;
+	int count = frames * m_iPacketsPerFrame;
+	for (int i = 0; i < count; i++) {
+		nextPacket(pkt);
+		PcapRecordHeader record;
+		record.u32Sec = static_cast<uint32_t>(pkt.stamp);
+		record.u32Usec = static_cast<uint32_t>((pkt.stamp - record.u32Sec) * 1000000);
+		record.u32CapLen = pkt.size + PACKET_RECORDER_NET_HEADER_SIZE;
+		record.u32OrigLen = record.u32CapLen;
+		buildPcapNetHeader(netHeader, sourceAddr, destport, static_cast<uint16_t>(i), pkt.size);
+		fwrite(&record, sizeof(record), 1, fp);
+		fwrite(netHeader, sizeof(netHeader), 1, fp);
+		fwrite(pkt.data, pkt.size, 1, fp);
+	}
+	fclose(fp);
+	return count;
+}
+
+int PacketGenerator::sendUdp(std::string destip, uint16_t destport, uint32_t frames, bool realtime) {
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(destport);
+	addr.sin_addr.s_addr = inet_addr(destip.c_str());
+	PandarPacket pkt;
+	uint64_t count = static_cast<uint64_t>(frames) * m_iPacketsPerFrame;
+	uint64_t startTime = GetMicroTickCountU64();
+	uint64_t sent = 0;
+	for (uint64_t i = 0; 0 == frames || i < count; i++) {
+		nextPacket(pkt);
+		if(realtime) {
+			// sleep most of the gap, spin the last part for an even packet rate
+			uint64_t target = startTime + static_cast<uint64_t>(i * m_dPacketInterval * 1000000);
+			uint64_t now = GetMicroTickCountU64();
+			if(target > now + 2000) {
+				usleep(target - now - 1000);
+			}
+			while (GetMicroTickCountU64() < target) {}
+		}
+		if(sendto(fd, pkt.data, pkt.size, 0, (sockaddr *)&addr, sizeof(addr)) == static_cast<ssize_t>(pkt.size)) {
+			sent++;
+		}
+	}
+	close(fd);
+	return static_cast<int>(sent);
+}
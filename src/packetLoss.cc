@@ -0,0 +1,147 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   PacketLossCounter: sequence gap, reorder and duplicate accounting
+ */
+#include <string.h>
+#include "packetLoss.h"
+
+PacketLossCounter::PacketLossCounter() {
+	m_bStarted = false;
+	m_u32HighestSeq = 0;
+	m_u32LowestSeq = 0;
+	memset(m_arrSeen, 0, sizeof(m_arrSeen));
+	reset();
+}
+
+void PacketLossCounter::reset() {
+	m_u64Received.store(0, boost::memory_order_relaxed);
+	m_u64Lost.store(0, boost::memory_order_relaxed);
+	m_u64Gaps.store(0, boost::memory_order_relaxed);
+	m_u64Reordered.store(0, boost::memory_order_relaxed);
+	m_u64Duplicates.store(0, boost::memory_order_relaxed);
+	m_u64Stale.store(0, boost::memory_order_relaxed);
+	m_u64Restarts.store(0, boost::memory_order_relaxed);
+	for (int i = 0; i < PACKET_LOSS_BURST_BUCKETS; i++) {
+		m_arrBurst[i].store(0, boost::memory_order_relaxed);
+	}
+}
+
+bool PacketLossCounter::getSequenceNumber(const PandarPacket &pkt, uint32_t &seq) {
+	if(pkt.size < 100) {
+		return false;
+	}
+	int index = 0;
+	if(pkt.data[2] == UDP_VERSION_MAJOR_1 && pkt.data[3] == UDP_VERSION_MINOR_3) {
+		// the sequence number closes the 1.3 packet
+		index = pkt.size - PANDAR128_SEQ_NUM_SIZE;
+	}
+	else {
+		// same layout as Input::checkPacketSize
+		uint8_t laserNum = pkt.data[6];
+		uint8_t blockNum = pkt.data[7];
+		uint8_t flags = pkt.data[11];
+		if(pkt.data[2] == UDP_VERSION_MAJOR_1 && !(flags & 1)) {
+			return false;
+		}
+		index = PANDAR128_HEAD_SIZE +
+				((flags & 0x10) ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE) * laserNum * blockNum +
+				PANDAR128_AZIMUTH_SIZE * blockNum + PANDAR128_CRC_SIZE +
+				((flags & 4) ? PANDAR128_FUNCTION_SAFETY_SIZE : 0) +
+				PANDAR128_TAIL_RESERVED1_SIZE + PANDAR128_TAIL_RESERVED2_SIZE + PANDAR128_TAIL_RESERVED3_SIZE +
+				PANDAR128_AZIMUTH_FLAG_SIZE + PANDAR128_SHUTDOWN_FLAG_SIZE + PANDAR128_RETURN_MODE_SIZE +
+				PANDAR128_MOTOR_SPEED_SIZE + PANDAR128_UTC_SIZE + PANDAR128_TS_SIZE + PANDAR128_FACTORY_INFO;
+	}
+	if(index + PANDAR128_SEQ_NUM_SIZE > pkt.size) {
+		return false;
+	}
+	memcpy(&seq, &pkt.data[index], sizeof(seq));
+	return true;
+}
+
+void PacketLossCounter::restart(uint32_t seq) {
+	memset(m_arrSeen, 0, sizeof(m_arrSeen));
+	m_u32HighestSeq = seq;
+	m_u32LowestSeq = seq;
+	setSeen(seq, true);
+}
+
+void PacketLossCounter::push(const PandarPacket &pkt) {
+	uint32_t seq = 0;
+	if(!getSequenceNumber(pkt, seq)) {
+		return;
+	}
+	m_u64Received.fetch_add(1, boost::memory_order_relaxed);
+	if(!m_bStarted) {
+		m_bStarted = true;
+		restart(seq);
+		return;
+	}
+	int64_t diff = static_cast<int32_t>(seq - m_u32HighestSeq);
+	if(diff > PACKET_LOSS_MAX_GAP || diff <= -PACKET_LOSS_WINDOW) {
+		m_u64Restarts.fetch_add(1, boost::memory_order_relaxed);
+		restart(seq);
+		return;
+	}
+	if(diff <= 0) {
+		// nothing below the window start was counted lost, the bitmap knows nothing of it
+		if(static_cast<int32_t>(seq - m_u32LowestSeq) < 0) {
+			m_u64Stale.fetch_add(1, boost::memory_order_relaxed);
+			m_u64Received.fetch_sub(1, boost::memory_order_relaxed);
+		}
+		else if(isSeen(seq)) {
+			m_u64Duplicates.fetch_add(1, boost::memory_order_relaxed);
+			m_u64Received.fetch_sub(1, boost::memory_order_relaxed);
+		}
+		else {
+			setSeen(seq, true);
+			m_u64Reordered.fetch_add(1, boost::memory_order_relaxed);
+			m_u64Lost.fetch_sub(1, boost::memory_order_relaxed);
+		}
+		return;
+	}
+	if(diff > 1) {
+		uint64_t gap = diff - 1;
+		int bucket = gap == 1 ? 0 : 64 - __builtin_clzll(gap - 1);
+		m_arrBurst[bucket < PACKET_LOSS_BURST_BUCKETS ? bucket : PACKET_LOSS_BURST_BUCKETS - 1].fetch_add(1, boost::memory_order_relaxed);
+		m_u64Gaps.fetch_add(1, boost::memory_order_relaxed);
+		m_u64Lost.fetch_add(gap, boost::memory_order_relaxed);
+	}
+	// the skipped numbers leave the window unseen, older ones fall out of it
+	if(diff >= PACKET_LOSS_WINDOW) {
+		memset(m_arrSeen, 0, sizeof(m_arrSeen));
+	}
+	else {
+		for (uint32_t s = m_u32HighestSeq + 1; s != seq; s++) {
+			setSeen(s, false);
+		}
+	}
+	uint32_t windowStart = seq - (PACKET_LOSS_WINDOW - 1);
+	if(static_cast<int32_t>(windowStart - m_u32LowestSeq) > 0) {
+		m_u32LowestSeq = windowStart;
+	}
+	m_u32HighestSeq = seq;
+	setSeen(seq, true);
+}
+
+PacketLossStats PacketLossCounter::getStats() {
+	PacketLossStats stats;
+	stats.u64Received = m_u64Received.load(boost::memory_order_relaxed);
+	stats.u64Lost = m_u64Lost.load(boost::memory_order_relaxed);
+	stats.u64Gaps = m_u64Gaps.load(boost::memory_order_relaxed);
+	stats.u64Reordered = m_u64Reordered.load(boost::memory_order_relaxed);
+	stats.u64Duplicates = m_u64Duplicates.load(boost::memory_order_relaxed);
+	stats.u64Stale = m_u64Stale.load(boost::memory_order_relaxed);
+	stats.u64Restarts = m_u64Restarts.load(boost::memory_order_relaxed);
+	for (int i = 0; i < PACKET_LOSS_BURST_BUCKETS; i++) {
+		stats.arrBurst[i] = m_arrBurst[i].load(boost::memory_order_relaxed);
+	}
+	uint64_t expected = stats.u64Received + stats.u64Lost;
+	stats.dLossRate = expected > 0 ? static_cast<double>(stats.u64Lost) / expected : 0;
+	return stats;
+}
@@ -0,0 +1,424 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** \file
+ *
+ *  Raw packet recorder: pcap / pcapng writer with a dedicated I/O thread
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "packetRecorder.h"
+#include "platUtil.h"
+
+#define PCAPNG_BLOCK_SHB (0x0A0D0D0A)
+#define PCAPNG_BLOCK_IDB (0x00000001)
+#define PCAPNG_BLOCK_EPB (0x00000006)
+#define PCAPNG_BYTE_ORDER_MAGIC (0x1A2B3C4D)
+
+typedef struct __attribute__((__packed__)) PcapngSectionHeader_s {
+	uint32_t u32BlockType;
+	uint32_t u32BlockLen;
+	uint32_t u32ByteOrderMagic;
+	uint16_t u16VersionMajor;
+	uint16_t u16VersionMinor;
+	int64_t i64SectionLen;
+	uint32_t u32BlockLenTrailer;
+} PcapngSectionHeader;
+
+typedef struct __attribute__((__packed__)) PcapngInterfaceDesc_s {
+	uint32_t u32BlockType;
+	uint32_t u32BlockLen;
+	uint16_t u16LinkType;
+	uint16_t u16Reserved;
+	uint32_t u32Snaplen;
+	uint32_t u32BlockLenTrailer;
+} PcapngInterfaceDesc;
+
+typedef struct __attribute__((__packed__)) PcapngPacketHeader_s {
+	uint32_t u32BlockType;
+	uint32_t u32BlockLen;
+	uint32_t u32InterfaceId;
+	uint32_t u32TimestampHigh;
+	uint32_t u32TimestampLow;
+	uint32_t u32CapLen;
+	uint32_t u32OrigLen;
+} PcapngPacketHeader;
+
+PacketRecorder::PacketRecorder() {
+	m_u32QueueHead = 0;
+	m_u32QueueTail = 0;
+	m_pIoThread = NULL;
+	m_bRecording = false;
+	m_bStopRequest = false;
+	m_u64PushedPackets = 0;
+	m_u64WrittenPackets = 0;
+	m_u64WrittenBytes = 0;
+	m_u64DroppedPackets = 0;
+	m_u64FailedPackets = 0;
+	m_u32FileCount = 0;
+	m_iFd = -1;
+	m_bFileDirect = false;
+	m_pStaging = NULL;
+	m_u32StagingSize = 0;
+	m_u32StagingUsed = 0;
+	m_u32StagingPackets = 0;
+	m_u64FileBytes = 0;
+	m_u32FileOpenTick = 0;
+	m_u32LastFlushTick = 0;
+	m_u32SourceAddr = 0;
+	m_u16IpId = 0;
+}
+
+PacketRecorder::~PacketRecorder() {
+	stop();
+	if(NULL != m_pStaging) {
+		free(m_pStaging);
+		m_pStaging = NULL;
+	}
+}
+
+int PacketRecorder::start(const PacketRecorderConfig &config) {
+	if(NULL != m_pIoThread) {
+		printf("Packet recorder is already running\n");
+		return -1;
+	}
+	if(config.filePrefix.empty()) {
+		printf("Packet recorder needs a file prefix\n");
+		return -1;
+	}
+	m_objConfig = config;
+	if(m_objConfig.format != PACKET_RECORDER_FORMAT_PCAPNG) {
+		m_objConfig.format = PACKET_RECORDER_FORMAT_PCAP;
+	}
+	uint32_t chunk = (m_objConfig.u32WriteChunkSize + PACKET_RECORDER_IO_ALIGN - 1) / PACKET_RECORDER_IO_ALIGN * PACKET_RECORDER_IO_ALIGN;
+	if(chunk == 0) {
+		chunk = PACKET_RECORDER_WRITE_CHUNK_SIZE;
+	}
+	m_objConfig.u32WriteChunkSize = chunk;
+	// one extra page keeps room for the record that crosses the chunk boundary
+	if(m_u32StagingSize != chunk + PACKET_RECORDER_IO_ALIGN) {
+		if(NULL != m_pStaging) {
+			free(m_pStaging);
+			m_pStaging = NULL;
+		}
+		m_u32StagingSize = chunk + PACKET_RECORDER_IO_ALIGN;
+		if(0 != posix_memalign((void **)&m_pStaging, PACKET_RECORDER_IO_ALIGN, m_u32StagingSize)) {
+			printf("Packet recorder: no memory for the staging buffer\n");
+			m_pStaging = NULL;
+			m_u32StagingSize = 0;
+			return -1;
+		}
+	}
+	uint32_t queueSize = m_objConfig.u32QueueSize < 2 ? PACKET_RECORDER_QUEUE_SIZE : m_objConfig.u32QueueSize;
+	if(m_vecQueue.size() != queueSize) {
+		m_vecQueue.resize(queueSize);
+	}
+	m_u32QueueHead = 0;
+	m_u32QueueTail = 0;
+	m_u32StagingUsed = 0;
+	m_u32StagingPackets = 0;
+	m_u64PushedPackets = 0;
+	m_u64WrittenPackets = 0;
+	m_u64WrittenBytes = 0;
+	m_u64DroppedPackets = 0;
+	m_u64FailedPackets = 0;
+	m_u32FileCount = 0;
+	in_addr addr;
+	if(inet_pton(AF_INET, m_objConfig.sourceIpAddr.c_str(), &addr) <= 0) {
+		addr.s_addr = 0;
+	}
+	m_u32SourceAddr = addr.s_addr;
+	if(0 != openFile()) {
+		return -1;
+	}
+	m_bStopRequest = false;
+	m_bRecording.store(true, boost::memory_order_release);
+	m_pIoThread = new boost::thread(boost::bind(&PacketRecorder::ioThread, this));
+	return 0;
+}
+
+void PacketRecorder::stop() {
+	if(NULL == m_pIoThread) {
+		return;
+	}
+	m_bRecording.store(false, boost::memory_order_release);
+	m_bStopRequest = true;
+	m_pIoThread->join();
+	delete m_pIoThread;
+	m_pIoThread = NULL;
+	printf("Packet recorder stopped, written: %lu, dropped: %lu, failed: %lu\n",
+		   (unsigned long)m_u64WrittenPackets.load(), (unsigned long)m_u64DroppedPackets.load(),
+		   (unsigned long)m_u64FailedPackets.load());
+}
+
+PacketRecorderStats PacketRecorder::getStats() {
+	PacketRecorderStats stats;
+	stats.u64PushedPackets = m_u64PushedPackets.load(boost::memory_order_relaxed);
+	stats.u64WrittenPackets = m_u64WrittenPackets.load(boost::memory_order_relaxed);
+	stats.u64WrittenBytes = m_u64WrittenBytes.load(boost::memory_order_relaxed);
+	stats.u64DroppedPackets = m_u64DroppedPackets.load(boost::memory_order_relaxed);
+	stats.u64FailedPackets = m_u64FailedPackets.load(boost::memory_order_relaxed);
+	stats.u32FileCount = m_u32FileCount.load(boost::memory_order_relaxed);
+	stats.bRecording = m_bRecording.load(boost::memory_order_relaxed);
+	return stats;
+}
+
+void PacketRecorder::ioThread() {
+	SetThreadPriority(SCHED_OTHER, 0);
+	m_u32LastFlushTick = GetTickCount();
+	while (1) {
+		uint32_t head = m_u32QueueHead.load(boost::memory_order_relaxed);
+		uint32_t tail = m_u32QueueTail.load(boost::memory_order_acquire);
+		if(head == tail) {
+			if(m_bStopRequest) {
+				break;
+			}
+			uint32_t tick = GetTickCount();
+			if(tick - m_u32LastFlushTick >= PACKET_RECORDER_FLUSH_INTERVAL_MS) {
+				flush(false);
+				m_u32LastFlushTick = tick;
+			}
+			usleep(1000);
+			continue;
+		}
+		while (head != tail) {
+			appendPacket(m_vecQueue[head]);
+			head = head + 1 == m_vecQueue.size() ? 0 : head + 1;
+			m_u32QueueHead.store(head, boost::memory_order_release);
+		}
+	}
+	closeFile();
+}
+
+int PacketRecorder::openFile() {
+	char timeString[32];
+	time_t now = time(NULL);
+	struct tm tmNow;
+	localtime_r(&now, &tmNow);
+	strftime(timeString, sizeof(timeString), "%Y%m%d_%H%M%S", &tmNow);
+	std::string fileName = m_objConfig.filePrefix + "_" + timeString + "_" +
+						   std::to_string(m_u32FileCount.load()) + "." + m_objConfig.format;
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	m_bFileDirect = false;
+	m_iFd = -1;
+	if(m_objConfig.bDirectIO) {
+		m_iFd = open(fileName.c_str(), flags | O_DIRECT, 0644);
+		if(m_iFd < 0) {
+			printf("Packet recorder: O_DIRECT not supported for %s, use buffered writes\n", fileName.c_str());
+		}
+		else {
+			m_bFileDirect = true;
+		}
+	}
+	if(m_iFd < 0) {
+		m_iFd = open(fileName.c_str(), flags, 0644);
+	}
+	if(m_iFd < 0) {
+		printf("Packet recorder: open %s failed, %s\n", fileName.c_str(), strerror(errno));
+		return -1;
+	}
+	printf("Packet recorder: write to %s\n", fileName.c_str());
+	m_u32FileCount++;
+	m_u64FileBytes = 0;
+	m_u32FileOpenTick = GetTickCount();
+	if(m_objConfig.format == PACKET_RECORDER_FORMAT_PCAPNG) {
+		PcapngSectionHeader section;
+		section.u32BlockType = PCAPNG_BLOCK_SHB;
+		section.u32BlockLen = sizeof(PcapngSectionHeader);
+		section.u32ByteOrderMagic = PCAPNG_BYTE_ORDER_MAGIC;
+		section.u16VersionMajor = 1;
+		section.u16VersionMinor = 0;
+		section.i64SectionLen = -1;
+		section.u32BlockLenTrailer = sizeof(PcapngSectionHeader);
+		appendBytes(&section, sizeof(section));
+		PcapngInterfaceDesc interfaceDesc;
+		interfaceDesc.u32BlockType = PCAPNG_BLOCK_IDB;
+		interfaceDesc.u32BlockLen = sizeof(PcapngInterfaceDesc);
+		interfaceDesc.u16LinkType = PCAP_LINKTYPE_ETHERNET;
+		interfaceDesc.u16Reserved = 0;
+		interfaceDesc.u32Snaplen = PCAP_SNAPLEN;
+		interfaceDesc.u32BlockLenTrailer = sizeof(PcapngInterfaceDesc);
+		appendBytes(&interfaceDesc, sizeof(interfaceDesc));
+	}
+	else {
+		PcapFileHeader header;
+		header.u32Magic = PCAP_MAGIC;
+		header.u16VersionMajor = 2;
+		header.u16VersionMinor = 4;
+		header.i32ThisZone = 0;
+		header.u32Sigfigs = 0;
+		header.u32Snaplen = PCAP_SNAPLEN;
+		header.u32LinkType = PCAP_LINKTYPE_ETHERNET;
+		appendBytes(&header, sizeof(header));
+	}
+	return 0;
+}
+
+void PacketRecorder::closeFile() {
+	flush(true);
+	if(m_iFd >= 0) {
+		close(m_iFd);
+		m_iFd = -1;
+	}
+}
+
+void PacketRecorder::appendPacket(const RecordPacket &pkt) {
+	uint32_t capLen = pkt.size + PACKET_RECORDER_NET_HEADER_SIZE;
+	uint32_t padLen = 0;
+	uint32_t recordLen;
+	if(m_objConfig.format == PACKET_RECORDER_FORMAT_PCAPNG) {
+		padLen = (4 - capLen % 4) % 4;
+		recordLen = sizeof(PcapngPacketHeader) + capLen + padLen + sizeof(uint32_t);
+	}
+	else {
+		recordLen = sizeof(PcapRecordHeader) + capLen;
+	}
+	bool rotateBySize = m_objConfig.u64RotateSize > 0 &&
+						m_u64FileBytes + recordLen > m_objConfig.u64RotateSize && m_u64FileBytes > 0;
+	bool rotateByTime = m_objConfig.u32RotateSeconds > 0 &&
+						GetTickCount() - m_u32FileOpenTick >= m_objConfig.u32RotateSeconds * 1000;
+	if(rotateBySize || rotateByTime) {
+		closeFile();
+		openFile();
+	}
+	uint64_t stampUs = static_cast<uint64_t>(pkt.stamp * 1000000.0);
+	if(m_objConfig.format == PACKET_RECORDER_FORMAT_PCAPNG) {
+		PcapngPacketHeader header;
+		header.u32BlockType = PCAPNG_BLOCK_EPB;
+		header.u32BlockLen = recordLen;
+		header.u32InterfaceId = 0;
+		header.u32TimestampHigh = static_cast<uint32_t>(stampUs >> 32);
+		header.u32TimestampLow = static_cast<uint32_t>(stampUs & 0xffffffff);
+		header.u32CapLen = capLen;
+		header.u32OrigLen = capLen;
+		appendBytes(&header, sizeof(header));
+	}
+	else {
+		PcapRecordHeader header;
+		header.u32Sec = static_cast<uint32_t>(stampUs / 1000000);
+		header.u32Usec = static_cast<uint32_t>(stampUs % 1000000);
+		header.u32CapLen = capLen;
+		header.u32OrigLen = capLen;
+		appendBytes(&header, sizeof(header));
+	}
+	uint8_t netHeader[PACKET_RECORDER_NET_HEADER_SIZE];
+	buildNetHeader(netHeader, pkt.size);
+	appendBytes(netHeader, sizeof(netHeader));
+	appendBytes(pkt.data, pkt.size);
+	if(m_objConfig.format == PACKET_RECORDER_FORMAT_PCAPNG) {
+		uint32_t zero = 0;
+		appendBytes(&zero, padLen);
+		appendBytes(&recordLen, sizeof(recordLen));
+	}
+	m_u32StagingPackets++;
+}
+
+void PacketRecorder::appendBytes(const void *data, uint32_t len) {
+	if(m_u32StagingUsed + len > m_u32StagingSize) {
+		flush(false);
+	}
+	memcpy(m_pStaging + m_u32StagingUsed, data, len);
+	m_u32StagingUsed += len;
+	m_u64FileBytes += len;
+	if(m_u32StagingUsed >= m_objConfig.u32WriteChunkSize) {
+		flush(false);
+	}
+}
+
+// all == false: O_DIRECT files keep the unaligned tail in the staging buffer
+void PacketRecorder::flush(bool all) {
+	if(0 == m_u32StagingUsed) {
+		return;
+	}
+	uint32_t len = m_u32StagingUsed;
+	if(m_bFileDirect) {
+		if(!all) {
+			len = m_u32StagingUsed / PACKET_RECORDER_IO_ALIGN * PACKET_RECORDER_IO_ALIGN;
+			if(0 == len) {
+				return;
+			}
+		}
+		else if(0 != len % PACKET_RECORDER_IO_ALIGN && m_iFd >= 0) {
+			// the last partial page of a file can't be written with O_DIRECT
+			fcntl(m_iFd, F_SETFL, fcntl(m_iFd, F_GETFL) & ~O_DIRECT);
+			m_bFileDirect = false;
+		}
+	}
+	int ret = m_iFd >= 0 ? sys_writen(m_iFd, m_pStaging, len) : -1;
+	if(ret == len) {
+		m_u64WrittenBytes.fetch_add(len, boost::memory_order_relaxed);
+		m_u64WrittenPackets.fetch_add(m_u32StagingPackets, boost::memory_order_relaxed);
+	}
+	else {
+		printf("Packet recorder: write failed, %s\n", strerror(errno));
+		m_u64FailedPackets.fetch_add(m_u32StagingPackets, boost::memory_order_relaxed);
+	}
+	m_u32StagingPackets = 0;
+	m_u32StagingUsed -= len;
+	if(m_u32StagingUsed > 0) {
+		memmove(m_pStaging, m_pStaging + len, m_u32StagingUsed);
+	}
+}
+
+void PacketRecorder::buildNetHeader(uint8_t *buf, uint32_t payloadSize) {
+	buildPcapNetHeader(buf, m_u32SourceAddr, m_objConfig.u16DestPort, m_u16IpId++, payloadSize);
+}
+
+void buildPcapNetHeader(uint8_t *buf, uint32_t sourceaddr, uint16_t destport, uint16_t ipid, uint32_t payloadSize) {
+	int index = 0;
+	// ethernet: broadcast destination, zero source, IPv4
+	memset(buf, 0xff, 6);
+	memset(buf + 6, 0, 6);
+	buf[12] = 0x08;
+	buf[13] = 0x00;
+	index = 14;
+	// IPv4 header without options
+	uint16_t totalLen = 20 + 8 + payloadSize;
+	uint8_t *ip = buf + index;
+	ip[0] = 0x45;
+	ip[1] = 0;
+	ip[2] = totalLen >> 8;
+	ip[3] = totalLen & 0xff;
+	ip[4] = ipid >> 8;
+	ip[5] = ipid & 0xff;
+	ip[6] = 0x40;
+	ip[7] = 0;
+	ip[8] = 64;
+	ip[9] = IPPROTO_UDP;
+	ip[10] = 0;
+	ip[11] = 0;
+	memcpy(ip + 12, &sourceaddr, 4);
+	memset(ip + 16, 0xff, 4);
+	uint32_t sum = 0;
+	for (int i = 0; i < 20; i += 2) {
+		sum += (ip[i] << 8) | ip[i + 1];
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+	sum = ~sum & 0xffff;
+	ip[10] = sum >> 8;
+	ip[11] = sum & 0xff;
+	index += 20;
+	// UDP header, checksum not computed
+	uint8_t *udp = buf + index;
+	uint16_t udpLen = 8 + payloadSize;
+	udp[0] = RECORDER_UDP_SOURCE_PORT >> 8;
+	udp[1] = RECORDER_UDP_SOURCE_PORT & 0xff;
+	udp[2] = destport >> 8;
+	udp[3] = destport & 0xff;
+	udp[4] = udpLen >> 8;
+	udp[5] = udpLen & 0xff;
+	udp[6] = 0;
+	udp[7] = 0;
+}
@@ -24,6 +24,8 @@ PandarSwiftDriver::PandarSwiftDriver(std::string deviceipaddr, uint16_t lidarpor
                         	boost::function<void(PandarPacketsArray*)> rawcallback, \
 						    PandarSwiftSDK *pandarSwiftSDK, std::string publishmode, std::string datatype) {
 	m_sFrameId = frameid;
+	m_sDeviceIpAddr = deviceipaddr;
+	m_u16LidarPort = lidarport;
 	m_funcRawCallback = rawcallback;
 	m_pPandarSwiftSDK = pandarSwiftSDK;
 	m_sPublishmodel = publishmode;
@@ -33,6 +35,11 @@ PandarSwiftDriver::PandarSwiftDriver(std::string deviceipaddr, uint16_t lidarpor
 	m_iPktPopIndex = 1;
 	m_bGetScanArraySizeFlag = false;
     m_iPandarScanArraySize = PANDAR128_READ_PACKET_SIZE;
+	m_spPacketRecorder.reset(new PacketRecorder());
+	// other data types are pushed into the SDK from outside, don't hold the port
+	if(LIDAR_DATA_TYPE != datatype) {
+		return;
+	}
 	// open Pandar input device or file
 	if(pcapfile != "") {  // have PCAP file
 		// read data from packet capture file
@@ -73,6 +80,7 @@ bool PandarSwiftDriver::poll(void) {
 	uint64_t endTime = 0;
 	timespec time;
 	memset(&time, 0, sizeof(time));
+	TraceScope trace("receive", m_iPandarScanArraySize);
 	for (int i = 0; i < m_iPandarScanArraySize; ++i) {
 		int rc = m_spInput->getPacket(&m_arrPandarPackets[m_iPktPushIndex][i]);
 		if(rc == 2) {
@@ -83,6 +91,7 @@ bool PandarSwiftDriver::poll(void) {
 			}
 		}
 		if(rc > 0) return false;  // end of file reached?
+		m_spPacketRecorder->push(m_arrPandarPackets[m_iPktPushIndex][i]);
 		if(m_sPublishmodel == "both_point_raw" || m_sPublishmodel == "point") {
 			m_pPandarSwiftSDK->pushLiDARData(m_arrPandarPackets[m_iPktPushIndex][i]);
 		}
@@ -109,8 +118,30 @@ void PandarSwiftDriver::publishRawData() {
 }
 
 void PandarSwiftDriver::setUdpVersion(uint8_t major, uint8_t minor) {
-	m_spInput->setUdpVersion(major, minor);
+	if(m_spInput) {
+		m_spInput->setUdpVersion(major, minor);
+	}
+}
+
+int PandarSwiftDriver::startRecord(const PacketRecorderConfig &config) {
+	PacketRecorderConfig recordConfig = config;
+	if(recordConfig.sourceIpAddr.empty()) {
+		recordConfig.sourceIpAddr = m_sDeviceIpAddr;
+	}
+	if(0 == recordConfig.u16DestPort) {
+		recordConfig.u16DestPort = m_u16LidarPort;
+	}
+	return m_spPacketRecorder->start(recordConfig);
 }
+
+void PandarSwiftDriver::stopRecord() {
+	m_spPacketRecorder->stop();
+}
+
+PacketRecorderStats PandarSwiftDriver::getRecorderStats() {
+	return m_spPacketRecorder->getStats();
+}
+
 int PandarSwiftDriver::getPandarScanArraySize(boost::shared_ptr<Input> input_){
   for (int i = 0; i < 256; ++i) {
     PandarPacket packet;
@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   PandarSwiftFusion: merge the time aligned frames of several lidars
+ */
+#include <math.h>
+#include "pandarSwiftFusion.h"
+
+PandarSwiftFusion::PandarSwiftFusion(boost::function<void(boost::shared_ptr<PFusedPointCloud>, double)> fusedcallback, \
+						std::string frameid, double synctolerance, int receivethreadnum)
+	: m_objManager(receivethreadnum) {
+	m_funcFusedCallback = fusedcallback;
+	m_sFrameId = frameid;
+	m_dSyncTolerance = synctolerance;
+	m_dSensorTimeout = FUSION_SENSOR_TIMEOUT;
+	m_dReferenceTime = 0;
+	m_u64PublishedFrames = 0;
+	m_u64DroppedFrames = 0;
+	m_u64PartialFrames = 0;
+}
+
+PandarSwiftFusion::~PandarSwiftFusion() {
+	stop();
+}
+
+int PandarSwiftFusion::addSensor(PandarSensorConfig config, const float *extrinsic) {
+	int id = m_objManager.getSensorNum();
+	config.pclcallback = boost::bind(&PandarSwiftFusion::onSensorFrame, this, id, _1, _2);
+	{
+		boost::mutex::scoped_lock lock(m_mtxSlots);
+		m_vecSlots.push_back(FusionSlot{boost::shared_ptr<PPointCloud>(), 0, 0, false});
+	}
+	if(m_objManager.addSensor(config) != id) {
+		boost::mutex::scoped_lock lock(m_mtxSlots);
+		m_vecSlots.pop_back();
+		return -1;
+	}
+	m_objManager.getSensor(id)->setExtrinsic(extrinsic);
+	return id;
+}
+
+void PandarSwiftFusion::setSensorTimeout(double timeout, \
+						boost::function<void(boost::shared_ptr<PFusedPointCloud>, double, const std::vector<int> &)> partialcallback) {
+	m_dSensorTimeout = timeout > 0 ? timeout : 0;
+	m_funcPartialCallback = partialcallback;
+}
+
+void PandarSwiftFusion::setPoseInterpolator(boost::shared_ptr<PoseInterpolator> interpolator) {
+	for (int i = 0; i < m_objManager.getSensorNum(); i++) {
+		m_objManager.getSensor(i)->setPoseInterpolator(interpolator, boost::bind(&PandarSwiftFusion::getDeskewReference, this, _1));
+	}
+}
+
+// the first frame of a cycle sets the reference, the frames of the other sensors that start
+// within the sync tolerance of it are deskewed to the same time
+double PandarSwiftFusion::getDeskewReference(double frametime) {
+	boost::mutex::scoped_lock lock(m_mtxSlots);
+	if(0 == m_dReferenceTime || fabs(frametime - m_dReferenceTime) > m_dSyncTolerance) {
+		m_dReferenceTime = frametime;
+	}
+	return m_dReferenceTime;
+}
+
+int PandarSwiftFusion::start() {
+	return m_objManager.start();
+}
+
+void PandarSwiftFusion::stop() {
+	m_objManager.stop();
+}
+
+PandarFusionStats PandarSwiftFusion::getStats() {
+	boost::mutex::scoped_lock lock(m_mtxSlots);
+	PandarFusionStats stats;
+	stats.u64PublishedFrames = m_u64PublishedFrames;
+	stats.u64DroppedFrames = m_u64DroppedFrames;
+	stats.u64PartialFrames = m_u64PartialFrames;
+	return stats;
+}
+
+void PandarSwiftFusion::onSensorFrame(int id, boost::shared_ptr<PPointCloud> cld, double timestamp) {
+	std::vector<boost::shared_ptr<PPointCloud> > parts;
+	std::vector<int> partIds;
+	std::vector<int> missing;
+	double fusedTimestamp = 0;
+	{
+		boost::mutex::scoped_lock lock(m_mtxSlots);
+		if(m_vecSlots[id].ready) {
+			m_u64DroppedFrames++;
+		}
+		m_vecSlots[id].cloud = cld;
+		m_vecSlots[id].timestamp = timestamp;
+		m_vecSlots[id].lastTimestamp = timestamp;
+		m_vecSlots[id].ready = true;
+		// frames too old to be aligned with the newest one are dropped
+		double newest = timestamp;
+		for (int i = 0; i < m_vecSlots.size(); i++) {
+			if(0 == m_vecSlots[i].lastTimestamp) {
+				m_vecSlots[i].lastTimestamp = timestamp;  // a sensor not heard from yet times out from the first frame
+			}
+			if(m_vecSlots[i].ready && m_vecSlots[i].timestamp > newest) {
+				newest = m_vecSlots[i].timestamp;
+			}
+		}
+		bool complete = true;
+		for (int i = 0; i < m_vecSlots.size(); i++) {
+			if(m_vecSlots[i].ready && newest - m_vecSlots[i].timestamp > m_dSyncTolerance) {
+				m_vecSlots[i].ready = false;
+				m_vecSlots[i].cloud.reset();
+				m_u64DroppedFrames++;
+			}
+			if(!m_vecSlots[i].ready && m_dSensorTimeout > 0 && newest - m_vecSlots[i].lastTimestamp > m_dSensorTimeout) {
+				missing.push_back(i);
+				continue;
+			}
+			complete = complete && m_vecSlots[i].ready;
+		}
+		if(!complete) {
+			return;
+		}
+		fusedTimestamp = newest;
+		for (int i = 0; i < m_vecSlots.size(); i++) {
+			if(!m_vecSlots[i].ready) {
+				continue;
+			}
+			parts.push_back(m_vecSlots[i].cloud);
+			partIds.push_back(i);
+			if(m_vecSlots[i].timestamp < fusedTimestamp) {
+				fusedTimestamp = m_vecSlots[i].timestamp;
+			}
+			m_vecSlots[i].ready = false;
+			m_vecSlots[i].cloud.reset();
+		}
+		m_u64PublishedFrames++;
+		m_u64PartialFrames += !missing.empty();
+	}
+
+	// one pass over the organized frames, the empty slots are left out
+	size_t total = 0;
+	for (int i = 0; i < parts.size(); i++) {
+		total += parts[i]->points.size();
+	}
+	boost::shared_ptr<PFusedPointCloud> fused(new PFusedPointCloud);
+	fused->points.reserve(total);
+	for (int i = 0; i < parts.size(); i++) {
+		const PPointCloud &part = *parts[i];
+		for (size_t j = 0; j < part.points.size(); j++) {
+			const PPoint &src = part.points[j];
+			if(0 == src.ring) {
+				continue;
+			}
+			PFusedPoint point;
+			point.x = src.x;
+			point.y = src.y;
+			point.z = src.z;
+			point.intensity = src.intensity;
+			point.timestamp = src.timestamp;
+			point.ring = src.ring;
+			point.sensor_id = partIds[i];
+			fused->points.push_back(point);
+		}
+	}
+	fused->header.frame_id = m_sFrameId;
+	fused->width = fused->points.size();
+	fused->height = 1;
+	if(!missing.empty() && NULL != m_funcPartialCallback) {
+		m_funcPartialCallback(fused, fusedTimestamp, missing);
+	}
+	else if(NULL != m_funcFusedCallback) {
+		m_funcFusedCallback(fused, fusedTimestamp);
+	}
+}
@@ -0,0 +1,240 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   PandarSwiftManager: several sensors on a shared pool of receive threads
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "pandarSwiftManager.h"
+#include "platUtil.h"
+
+static inline uint64_t routeKey(uint32_t sourceaddr, uint16_t port) {
+	return (static_cast<uint64_t>(sourceaddr) << 16) | port;
+}
+
+PandarSwiftManager::PandarSwiftManager(int receivethreadnum) {
+	m_iReceiveThreadNum = receivethreadnum > 0 ? receivethreadnum : 1;
+	m_bStarted = false;
+}
+
+PandarSwiftManager::~PandarSwiftManager() {
+	stop();
+}
+
+int PandarSwiftManager::addSensor(const PandarSensorConfig &config) {
+	if(m_bStarted) {
+		printf("Add sensor before start the manager\n");
+		return -1;
+	}
+	uint32_t sourceaddr = 0;
+	if(!config.deviceipaddr.empty()) {
+		in_addr addr;
+		if(inet_pton(AF_INET, config.deviceipaddr.c_str(), &addr) <= 0) {
+			printf("Invalid device ip address: %s\n", config.deviceipaddr.c_str());
+			return -1;
+		}
+		sourceaddr = addr.s_addr;
+	}
+	uint64_t key = routeKey(sourceaddr, config.lidarport);
+	if(m_mapLidarRoute.find(key) != m_mapLidarRoute.end()) {
+		printf("Sensor %s:%d is already added\n", config.deviceipaddr.c_str(), config.lidarport);
+		return -1;
+	}
+	int id = m_vecSensors.size();
+	boost::shared_ptr<PandarSwiftSDK> sensor(new PandarSwiftSDK(config.deviceipaddr, config.lidarport, config.gpsport, config.frameid, \
+								config.correctionfile, config.firtimeflie, std::string(""), \
+								config.pclcallback, NULL, config.gpscallback, \
+								config.certFile, config.privateKeyFile, config.caFile, \
+								config.startangle, config.timezone, std::string("point"), config.coordinateCorrectionFlag, MANAGER_DATA_TYPE));
+	m_vecSensors.push_back(sensor);
+	m_vecSensorConfigs.push_back(config);
+	m_mapLidarRoute[key] = id;
+	if(0 != config.gpsport) {
+		m_mapGpsRoute[routeKey(sourceaddr, config.gpsport)] = id;
+	}
+	printf("Manager add sensor %d: %s:%d\n", id, config.deviceipaddr.c_str(), config.lidarport);
+	return id;
+}
+
+int PandarSwiftManager::openSocket(uint16_t port) {
+	int fd = socket(PF_INET, SOCK_DGRAM, 0);
+	if(fd == -1) {
+		perror("socket");
+		return -1;
+	}
+	sockaddr_in myAddress;
+	memset(&myAddress, 0, sizeof(myAddress));
+	myAddress.sin_family = AF_INET;
+	myAddress.sin_port = htons(port);
+	myAddress.sin_addr.s_addr = INADDR_ANY;
+	if(bind(fd, (sockaddr *)&myAddress, sizeof(sockaddr)) == -1) {
+		perror("bind error");
+		close(fd);
+		return -1;
+	}
+	if(fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+		perror("non-block");
+		close(fd);
+		return -1;
+	}
+	int nRecvBuf = MANAGER_SOCKET_RECV_BUF;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char*)&nRecvBuf, sizeof(int));
+	return fd;
+}
+
+int PandarSwiftManager::start() {
+	if(m_bStarted) {
+		return 0;
+	}
+	std::vector<uint16_t> ports;
+	for (int i = 0; i < m_vecSensorConfigs.size(); i++) {
+		ports.push_back(m_vecSensorConfigs[i].lidarport);
+		if(0 != m_vecSensorConfigs[i].gpsport) {
+			ports.push_back(m_vecSensorConfigs[i].gpsport);
+		}
+	}
+	std::sort(ports.begin(), ports.end());
+	ports.erase(std::unique(ports.begin(), ports.end()), ports.end());
+	for (int i = 0; i < ports.size(); i++) {
+		int fd = openSocket(ports[i]);
+		if(fd < 0) {
+			continue;
+		}
+		printf("Manager opening UDP socket: %d\n", ports[i]);
+		m_vecSockets.push_back(ManagerSocket{fd, ports[i]});
+	}
+	if(m_vecSockets.empty()) {
+		printf("Manager has no socket to receive\n");
+		return -1;
+	}
+	int threadNum = std::min<int>(m_iReceiveThreadNum, m_vecSockets.size());
+	m_vecThreadSockets.assign(threadNum, std::vector<ManagerSocket>());
+	for (int i = 0; i < m_vecSockets.size(); i++) {
+		m_vecThreadSockets[i % threadNum].push_back(m_vecSockets[i]);
+	}
+	m_bStarted = true;
+	for (int i = 0; i < threadNum; i++) {
+		m_vecReceiveThreads.push_back(new boost::thread(boost::bind(&PandarSwiftManager::receiveThread, this, i)));
+	}
+	return 0;
+}
+
+void PandarSwiftManager::stop() {
+	for (int i = 0; i < m_vecReceiveThreads.size(); i++) {
+		m_vecReceiveThreads[i]->interrupt();
+		m_vecReceiveThreads[i]->join();
+		delete m_vecReceiveThreads[i];
+	}
+	m_vecReceiveThreads.clear();
+	for (int i = 0; i < m_vecSockets.size(); i++) {
+		close(m_vecSockets[i].fd);
+	}
+	m_vecSockets.clear();
+	m_vecThreadSockets.clear();
+	for (int i = 0; i < m_vecSensors.size(); i++) {
+		m_vecSensors[i]->stop();
+	}
+	m_bStarted = false;
+}
+
+boost::shared_ptr<PandarSwiftSDK> PandarSwiftManager::getSensor(int id) {
+	if(id < 0 || id >= m_vecSensors.size()) {
+		return boost::shared_ptr<PandarSwiftSDK>();
+	}
+	return m_vecSensors[id];
+}
+
+int PandarSwiftManager::getSensorNum() {
+	return m_vecSensors.size();
+}
+
+void PandarSwiftManager::receiveThread(int index) {
+	SetThreadPriority(SCHED_RR, 99);
+	std::vector<ManagerSocket> &sockets = m_vecThreadSockets[index];
+	std::vector<pollfd> fds(sockets.size());
+	for (int i = 0; i < sockets.size(); i++) {
+		fds[i].fd = sockets[i].fd;
+		fds[i].events = POLLIN;
+	}
+	std::vector<PandarPacket> packets(MANAGER_RECEIVE_BATCH_SIZE);
+	mmsghdr msgs[MANAGER_RECEIVE_BATCH_SIZE];
+	iovec iovecs[MANAGER_RECEIVE_BATCH_SIZE];
+	sockaddr_in senders[MANAGER_RECEIVE_BATCH_SIZE];
+	static const int POLL_TIMEOUT = 1000;  // one second (in msec)
+	while (1) {
+		boost::this_thread::interruption_point();
+		int retval = poll(fds.data(), fds.size(), POLL_TIMEOUT);
+		if(retval < 0) {
+			if(errno != EINTR) printf("poll() error: %s\n", strerror(errno));
+			continue;
+		}
+		if(retval == 0) {
+			printf("Manager poll() timeout\n");
+			continue;
+		}
+		for (int s = 0; s < fds.size(); s++) {
+			if(!(fds[s].revents & POLLIN)) {
+				continue;
+			}
+			for (int i = 0; i < MANAGER_RECEIVE_BATCH_SIZE; i++) {
+				iovecs[i].iov_base = &packets[i].data[0];
+				iovecs[i].iov_len = ETHERNET_MTU;
+				memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+				msgs[i].msg_hdr.msg_name = &senders[i];
+				msgs[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+			int count = recvmmsg(fds[s].fd, msgs, MANAGER_RECEIVE_BATCH_SIZE, MSG_DONTWAIT, NULL);
+			if(count <= 0) {
+				continue;
+			}
+			TraceScope trace("receive", count);
+			double stamp = getNowTimeSec();
+			for (int i = 0; i < count; i++) {
+				packets[i].size = msgs[i].msg_len;
+				packets[i].stamp = stamp;
+				dispatchPacket(sockets[s].port, senders[i].sin_addr.s_addr, packets[i]);
+			}
+		}
+	}
+}
+
+int PandarSwiftManager::findSensor(uint16_t port, uint32_t sourceaddr) {
+	std::map<uint64_t, int>::iterator iter = m_mapLidarRoute.find(routeKey(sourceaddr, port));
+	if(iter == m_mapLidarRoute.end()) {
+		iter = m_mapLidarRoute.find(routeKey(0, port));
+	}
+	return iter == m_mapLidarRoute.end() ? -1 : iter->second;
+}
+
+void PandarSwiftManager::dispatchPacket(uint16_t port, uint32_t sourceaddr, PandarPacket &pkt) {
+	if(pkt.size == GPS_PACKET_SIZE) {
+		std::map<uint64_t, int>::iterator iter = m_mapGpsRoute.find(routeKey(sourceaddr, port));
+		if(iter == m_mapGpsRoute.end()) {
+			iter = m_mapGpsRoute.find(routeKey(0, port));
+		}
+		PandarGPS gps;
+		if(iter != m_mapGpsRoute.end() && parseGPS(&gps, &pkt.data[0], GPS_PACKET_SIZE) == 0) {
+			m_vecSensors[iter->second]->processGps(&gps);
+		}
+		return;
+	}
+	if(pkt.size < 100 || (pkt.data[0] != 0xEE && pkt.data[1] != 0xFF)) {
+		return;
+	}
+	int id = findSensor(port, sourceaddr);
+	if(id < 0) {
+		return;
+	}
+	m_vecSensors[id]->pushLiDARData(pkt);
+}
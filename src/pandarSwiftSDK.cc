@@ -9,6 +9,7 @@
  *   This class PandarSwiftSDKs raw Pandar128 3D LIDAR packets to PointCloud2.
  */
 #include "pandarSwiftSDK.h"
+#include "pandarSwiftShared.h"
 #include <pcl/io/pcd_io.h>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
@@ -21,9 +22,50 @@
 #include "platUtil.h"
 // #define FIRETIME_CORRECTION_CHECK 
 
+// One decode executor for every PandarSwiftSDK in the process, sensors share its workers.
 static tf::Executor executor;
+
+// Records every decode task on its worker's timeline while tracing is enabled.
+class DecodeTraceObserver : public tf::ExecutorObserverInterface {
+ public:
+	void set_up(unsigned num_workers) override {
+		m_vecBegin.assign(num_workers, 0);
+	}
+	void on_entry(unsigned worker_id, tf::TaskView task_view) override {
+		if(TraceRecorder::instance().isEnabled()) {
+			m_vecBegin[worker_id] = GetMicroTickCountU64();
+		}
+	}
+	void on_exit(unsigned worker_id, tf::TaskView task_view) override {
+		if(TraceRecorder::instance().isEnabled() && 0 != m_vecBegin[worker_id]) {
+			TraceRecorder::instance().record("decode", m_vecBegin[worker_id], GetMicroTickCountU64(), worker_id);
+			m_vecBegin[worker_id] = 0;
+		}
+	}
+
+ private:
+	std::vector<uint64_t> m_vecBegin;
+};
+static DecodeTraceObserver *decodeTraceObserver = executor.make_observer<DecodeTraceObserver>();
+
+tf::Executor &sharedExecutor() {
+	return executor;
+}
 float degreeToRadian(float degree) { return degree * M_PI / 180.0f; }
 
+AllAngleTable::AllAngleTable() {
+	for (int j = 0; j < CIRCLE; j++) {
+		float angle = static_cast<float>(j) / 100.0f;
+		cosAllAngle[j] = cosf(degreeToRadian(angle));
+		sinAllAngle[j] = sinf(degreeToRadian(angle));
+	}
+}
+
+const AllAngleTable &allAngleTable() {
+	static const AllAngleTable table;
+	return table;
+}
+
 static const float elevAngle[] = {
     14.436f,  13.535f,  13.08f,   12.624f,  12.163f,  11.702f,  11.237f,
     10.771f,  10.301f,  9.83f,    9.355f,   8.88f,    8.401f,   7.921f,
@@ -71,7 +113,8 @@ PandarSwiftSDK::PandarSwiftSDK(std::string deviceipaddr, uint16_t lidarport, uin
 							boost::function<void(PandarPacketsArray*)> rawcallback, \
 							boost::function<void(double)> gpscallback, \
 							std::string certFile, std::string privateKeyFile, std::string caFile, \
-							int startangle, int timezone, std::string publishmode, bool coordinateCorrectionFlag, std::string datatype) {
+							int startangle, int timezone, std::string publishmode, bool coordinateCorrectionFlag, std::string datatype, \
+							std::string calibrationcachedir) {
 	m_sSdkVersion = "PandarSwiftSDK_1.2.15";
 	printf("\n--------PandarSwift SDK version: %s--------\n",m_sSdkVersion.c_str());
 	m_sDeviceIpAddr = deviceipaddr;
@@ -85,6 +128,7 @@ PandarSwiftSDK::PandarSwiftSDK(std::string deviceipaddr, uint16_t lidarport, uin
 	m_iReturnMode = 0;
 	m_iMotorSpeed = 0;
 	m_iLaserNum = 0;
+	m_pfnDecodeKernel = &PandarSwiftSDK::calcPointXYZIT;
 	m_iTimeZoneSecond = timezone * 3600;  // time zone
 	m_iPublishPointsIndex = 0;
 	m_u8UdpVersionMajor = 0;
@@ -97,26 +141,59 @@ PandarSwiftSDK::PandarSwiftSDK(std::string deviceipaddr, uint16_t lidarport, uin
 	m_funcPclCallback = pclcallback;
 	m_funcGpsCallback = gpscallback;
 	m_bCoordinateCorrectionFlag = coordinateCorrectionFlag;
+	m_bExtrinsicFlag = false;
+	applyPointFilter(PointFilterConfig());
+	m_bVoxelFlag = false;
+	m_VoxelOutArray[0].reset(new PPointCloud);
+	m_VoxelOutArray[1].reset(new PPointCloud);
+	m_bGroundFlag = false;
+	m_GroundLabelArray[0].reset(new std::vector<uint8_t>);
+	m_GroundLabelArray[1].reset(new std::vector<uint8_t>);
+	m_bDualReturnFlag = false;
+	m_bDualReturnDedupe = false;
+	m_DualReturnArray[0].reset(new DualReturnFrame);
+	m_DualReturnArray[1].reset(new DualReturnFrame);
+	m_bBackgroundFlag = false;
+	m_bRelearnBackground = false;
+	m_BackgroundSummaryArray[0].reset(new BackgroundSummary);
+	m_BackgroundSummaryArray[1].reset(new BackgroundSummary);
+	m_bNewFrame = true;
+	m_dDeskewRefTime = 0;
+	m_bConfigPending = false;
+	m_bPoseInterpolatorPending = false;
+	m_bPointFilterPending = false;
+	m_bVoxelPending = false;
+	m_bGroundPending = false;
+	m_bBackgroundPending = false;
+	m_bDualReturnPending = false;
+	m_objPublishOutputs.voxel = false;
+	m_objPublishOutputs.ground = false;
+	m_objPublishOutputs.background = false;
+	m_objPublishOutputs.dualReturn = false;
+	resetStats();
+	m_u32PacketLossPeriod = 1000;
+	m_u32LastPacketLossTick = GetTickCount();
+	m_objLastPacketLoss = m_objPacketLoss.getStats();
+	m_pTcpCommandClient = NULL;
+	m_calibrationThread = NULL;
+	m_u32CalibrationChecksum = 0;
+	m_objCalibrationCache.setDirectory(calibrationcachedir);
 	m_spPandarDriver.reset(new PandarSwiftDriver(deviceipaddr, lidarport, gpsport, frameid, pcapfile, rawcallback, this, publishmode, datatype));
 	TcpCommandSetSsl(certFile.c_str(), privateKeyFile.c_str(), caFile.c_str());
 	printf("frame id: %s\n", m_sFrameId.c_str());
 	printf("lidar firetime file: %s\n", m_sLidarFiretimeFile.c_str());
 	printf("lidar correction file: %s\n", m_sLidarCorrectionFile.c_str());
 	SetEnvironmentVariableTZ();
+	m_spCalibration.reset(new CalibrationTable);
 	for (int i = 0; i < PANDAR128_LASER_NUM; i++) {
-		m_fElevAngle[i] = elevAngle[i];
-		m_fHorizatalAzimuth[i] = azimuthOffset[i];
+		m_spCalibration->elevAngle[i] = elevAngle[i];
+		m_spCalibration->horizatalAzimuth[i] = azimuthOffset[i];
 	}
 	loadCorrectionFile();
 	loadOffsetFile(m_sLidarFiretimeFile);
 	pthread_mutex_init(&m_RedundantPointLock, NULL);
-	memset(m_fCosAllAngle, 0, sizeof(m_fCosAllAngle));
-	memset(m_fSinAllAngle, 0, sizeof(m_fSinAllAngle));
-	for (int j = 0; j < CIRCLE; j++) {
-		float angle = static_cast<float>(j) / 100.0f;
-		m_fCosAllAngle[j] = cosf(degreeToRadian(angle));
-		m_fSinAllAngle[j] = sinf(degreeToRadian(angle));
-	}
+	m_fCosAllAngle = allAngleTable().cosAllAngle;
+	m_fSinAllAngle = allAngleTable().sinAllAngle;
 	m_driverReadThread = NULL;
 	m_processLiDARDataThread = NULL;
 	m_publishPointsThread = NULL;
@@ -136,9 +213,21 @@ PandarSwiftSDK::PandarSwiftSDK(std::string deviceipaddr, uint16_t lidarport, uin
 void PandarSwiftSDK::loadCorrectionFile() {
 	bool loadCorrectionFileSuccess = false;
 	int ret;
-	if(m_sPcapFile.empty()) { //connect to lidar,load correction file frome lidar
-		m_pTcpCommandClient =TcpCommandClientNew(m_sDeviceIpAddr.c_str(), PANDARSDK_TCP_COMMAND_PORT);
-		if(NULL != m_pTcpCommandClient) {
+	if(m_sPcapFile.empty() && m_objCalibrationCache.isEnabled()) {
+		// start from the last correction of this device, the lidar is asked in the background
+		std::string correctionString;
+		if(0 == m_objCalibrationCache.load(m_sDeviceIpAddr, m_sCalibrationSerial, m_u32CalibrationChecksum, correctionString) &&
+				0 == loadCorrectionString(correctionString)) {
+			loadCorrectionFileSuccess = true;
+			printf("Load correction of %s from the calibration cache\n", m_sCalibrationSerial.c_str());
+		}
+		else {
+			m_sCalibrationSerial = "";
+		}
+		m_calibrationThread = new boost::thread(boost::bind(&PandarSwiftSDK::revalidateCalibration, this));
+	}
+	else if(m_sPcapFile.empty()) { //connect to lidar,load correction file frome lidar
+		if(NULL != getTcpCommandClient()) {
 			char *buffer = NULL;
 			uint32_t len = 0;
 			std::string correntionString;
@@ -174,7 +263,8 @@ void PandarSwiftSDK::loadCorrectionFile() {
 			char *buffer = new char[length];
 			fin.read(buffer, length);
 			fin.close();
-			strlidarCalibration = buffer;
+			strlidarCalibration.assign(buffer, length);  // the file is not '\0' terminated
+			delete[] buffer;
 			ret = loadCorrectionString(strlidarCalibration);
 			if(ret != 0) {
 				printf("Parse local Correction file Error\n");
@@ -191,17 +281,235 @@ void PandarSwiftSDK::loadCorrectionFile() {
 	}
 }
 
+void *PandarSwiftSDK::getTcpCommandClient() {
+	boost::mutex::scoped_lock lock(m_mutexTcpCommandClient);
+	if(NULL == m_pTcpCommandClient) {
+		m_pTcpCommandClient = TcpCommandClientNew(m_sDeviceIpAddr.c_str(), PANDARSDK_TCP_COMMAND_PORT);
+	}
+	return m_pTcpCommandClient;
+}
+
+int PandarSwiftSDK::startSharedMemoryOutput(std::string name, int slotnum, uint32_t maxpoints) {
+	if(0 == maxpoints) {
+		maxpoints = CIRCLE_ANGLE / LIDAR_ANGLE_SIZE_10 * PANDAR128_LASER_NUM * LIDAR_RETURN_BLOCK_SIZE_2;
+	}
+	return m_objShmWriter.open(name, slotnum, maxpoints, m_sFrameId);
+}
+
+int PandarSwiftSDK::startStatusPoller(uint32_t periodms, boost::function<void(const LidarStatus &)> statuscallback) {
+	if(!m_sPcapFile.empty() || NULL == getTcpCommandClient()) {
+		return -1;
+	}
+	return m_objStatusPoller.start(m_pTcpCommandClient, periodms, statuscallback);
+}
+
+bool PandarSwiftSDK::getLidarStatus(LidarStatus &status) {
+	return m_objStatusPoller.getStatus(status);
+}
+
+int PandarSwiftSDK::fetchLidarCalibration(std::string &serial, std::string &correctionstring) {
+	if(NULL == getTcpCommandClient()) {
+		return -1;
+	}
+	char *buffer = NULL;
+	uint32_t len = 0;
+	serial = "";
+	if(0 == TcpCommandGetInventoryInfo(m_pTcpCommandClient, &buffer, &len) && buffer) {
+		serial = std::string(buffer, strnlen(buffer, std::min(len, (uint32_t)PTC_INVENTORY_SERIAL_SIZE)));
+		serial.erase(serial.find_last_not_of(' ') + 1);
+	}
+	free(buffer);
+	if(serial.empty()) {  // no inventory info, key the cache by the address
+		serial = m_sDeviceIpAddr;
+	}
+	buffer = NULL;
+	if(0 != TcpCommandGetLidarCalibration(m_pTcpCommandClient, &buffer, &len) || NULL == buffer) {
+		free(buffer);
+		return -1;
+	}
+	correctionstring = std::string(buffer);
+	free(buffer);
+	return 0;
+}
+
+void PandarSwiftSDK::revalidateCalibration() {
+	std::string serial;
+	std::string correctionString;
+	if(0 != fetchLidarCalibration(serial, correctionString)) {
+		printf("Get lidar calibration filed, keep the %s correction\n", m_sCalibrationSerial.empty() ? "local" : "cached");
+		return;
+	}
+	uint32_t checksum = CalibrationCache::getChecksum(correctionString);
+	if(serial == m_sCalibrationSerial && checksum == m_u32CalibrationChecksum) {
+		printf("Calibration cache of %s is up to date\n", serial.c_str());
+		return;
+	}
+	float pitchList[PANDAR128_LASER_NUM];
+	float azimuthList[PANDAR128_LASER_NUM];
+	int laserNum = 0;
+	if(0 != parseCorrectionString(correctionString, pitchList, azimuthList, laserNum)) {
+		printf("Parse Lidar Correction Error\n");
+		return;
+	}
+	boost::shared_ptr<CalibrationTable> calibration(new CalibrationTable(*boost::atomic_load(&m_spCalibration)));
+	memcpy(calibration->elevAngle, pitchList, laserNum * sizeof(float));
+	memcpy(calibration->horizatalAzimuth, azimuthList, laserNum * sizeof(float));
+	publishCalibration(calibration);
+	m_objCalibrationCache.store(m_sDeviceIpAddr, serial, correctionString);
+	printf("Correction of %s changed, used from the next frame\n", serial.c_str());
+}
+
+void PandarSwiftSDK::publishCalibration(boost::shared_ptr<CalibrationTable> calibration) {
+	// a table published twice before the next frame replaces the first one
+	boost::atomic_store(&m_spPendingCalibration, calibration);
+}
+
+void PandarSwiftSDK::applyPendingCalibration() {
+	boost::shared_ptr<CalibrationTable> calibration = boost::atomic_exchange(&m_spPendingCalibration, boost::shared_ptr<CalibrationTable>());
+	if(NULL == calibration) {
+		return;
+	}
+	// between two frames no decode task is running, the workers see one table per frame
+	boost::atomic_store(&m_spCalibration, calibration);
+	printf("Calibration tables replaced\n");
+}
+
+void PandarSwiftSDK::applyPendingConfig() {
+	if(!m_bConfigPending.exchange(false, boost::memory_order_acquire)) {
+		return;
+	}
+	// no decode task is running, the next frame is the first one with the new settings
+	boost::mutex::scoped_lock lock(m_mutexPendingConfig);
+	if(m_bPoseInterpolatorPending) {
+		m_spPoseInterpolator = m_spPendingPoseInterpolator;
+		m_funcDeskewReference = m_funcPendingDeskewReference;
+		m_spPendingPoseInterpolator.reset();
+		m_funcPendingDeskewReference = NULL;
+		m_bPoseInterpolatorPending = false;
+	}
+	if(m_bPointFilterPending) {
+		applyPointFilter(m_objPendingPointFilter);
+		m_bPointFilterPending = false;
+	}
+	if(m_bVoxelPending) {
+		m_bVoxelFlag = false;
+		if(m_objPendingVoxelConfig.leafSize > 0) {
+			// one partial map per decode worker, plus one for a caller outside the executor
+			m_objVoxelGrid.setup(m_objPendingVoxelConfig, executor.num_workers() + 1);
+			m_bVoxelFlag = true;
+		}
+		m_funcVoxelCallback = m_funcPendingVoxelCallback;
+		m_funcPendingVoxelCallback = NULL;
+		m_bVoxelPending = false;
+	}
+	if(m_bGroundPending) {
+		m_bGroundFlag = m_objPendingGroundConfig.enable;
+		if(m_bGroundFlag) {
+			m_objGroundSegmentation.setConfig(m_objPendingGroundConfig);
+		}
+		m_funcGroundCallback = m_funcPendingGroundCallback;
+		m_funcPendingGroundCallback = NULL;
+		m_bGroundPending = false;
+	}
+	if(m_bBackgroundPending) {
+		m_bBackgroundFlag = m_objPendingBackgroundConfig.enable;
+		if(m_bBackgroundFlag) {
+			// cells for the finest azimuth resolution, the model restarts when the resolution changes
+			m_objBackgroundModel.setup(m_objPendingBackgroundConfig, CIRCLE_ANGLE / LIDAR_ANGLE_SIZE_10 * PANDAR128_LASER_NUM);
+		}
+		m_funcBackgroundCallback = m_funcPendingBackgroundCallback;
+		m_funcPendingBackgroundCallback = NULL;
+		m_bBackgroundPending = false;
+	}
+	if(m_bDualReturnPending) {
+		m_bDualReturnFlag = m_objPendingDualReturnConfig.enable;
+		m_bDualReturnDedupe = m_bDualReturnFlag && m_objPendingDualReturnConfig.dedupe;
+		if(m_bDualReturnFlag) {
+			m_objDualReturnSplitter.setConfig(m_objPendingDualReturnConfig);
+			m_objDualReturnSplitter.reset(CIRCLE_ANGLE / LIDAR_ANGLE_SIZE_10 * PANDAR128_LASER_NUM);
+		}
+		m_funcDualReturnCallback = m_funcPendingDualReturnCallback;
+		m_funcPendingDualReturnCallback = NULL;
+		m_bDualReturnPending = false;
+	}
+}
+
+void PandarSwiftSDK::setPublishOutputs() {
+	m_objPublishOutputs.voxel = m_bVoxelFlag;
+	m_objPublishOutputs.voxelCallback = m_funcVoxelCallback;
+	m_objPublishOutputs.ground = m_bGroundFlag;
+	m_objPublishOutputs.groundCallback = m_funcGroundCallback;
+	m_objPublishOutputs.background = m_bBackgroundFlag;
+	m_objPublishOutputs.backgroundCallback = m_funcBackgroundCallback;
+	m_objPublishOutputs.dualReturn = m_bDualReturnFlag;
+	m_objPublishOutputs.dualReturnCallback = m_funcDualReturnCallback;
+}
+
+int PandarSwiftSDK::reloadCalibration(std::string correctionfile, std::string firetimefile) {
+	std::string correctionString;
+	if(correctionfile.empty()) {
+		std::string serial;
+		if(!m_sPcapFile.empty() || 0 != fetchLidarCalibration(serial, correctionString)) {
+			printf("Get lidar calibration filed\n");
+			return -1;
+		}
+	}
+	else {
+		std::ifstream fin(correctionfile.c_str());
+		if(!fin.is_open()) {
+			printf("Open correction file %s failed\n", correctionfile.c_str());
+			return -1;
+		}
+		std::stringstream ss;
+		ss << fin.rdbuf();
+		correctionString = ss.str();
+	}
+	float pitchList[PANDAR128_LASER_NUM];
+	float azimuthList[PANDAR128_LASER_NUM];
+	int laserNum = 0;
+	if(0 != parseCorrectionString(correctionString, pitchList, azimuthList, laserNum)) {
+		printf("Parse Lidar Correction Error\n");
+		return -1;
+	}
+	boost::shared_ptr<CalibrationTable> calibration(new CalibrationTable(*boost::atomic_load(&m_spCalibration)));
+	memcpy(calibration->elevAngle, pitchList, laserNum * sizeof(float));
+	memcpy(calibration->horizatalAzimuth, azimuthList, laserNum * sizeof(float));
+	if(!firetimefile.empty()) {
+		if(!std::ifstream(firetimefile.c_str()).is_open()) {
+			printf("Open firetime file %s failed\n", firetimefile.c_str());
+			return -1;
+		}
+		calibration->laserOffset = LasersTSOffset();
+		calibration->laserOffset.setFilePath(firetimefile);
+	}
+	publishCalibration(calibration);
+	return 0;
+}
+
 int PandarSwiftSDK::loadCorrectionString(std::string correction_content) {
+	float pitchList[PANDAR128_LASER_NUM];
+	float azimuthList[PANDAR128_LASER_NUM];
+	int lineCounter = 0;
+	if(0 != parseCorrectionString(correction_content, pitchList, azimuthList, lineCounter)) {
+		return -1;
+	}
+	// the constructor fills the first table before any thread can read it
+	for (int i = 0; i < lineCounter; ++i) {
+		m_spCalibration->elevAngle[i] = pitchList[i];
+		m_spCalibration->horizatalAzimuth[i] = azimuthList[i];
+	}
+	return 0;
+}
+
+int PandarSwiftSDK::parseCorrectionString(std::string correction_content, float *pitchList, float *azimuthList, int &lineCounter) {
     std::istringstream ifs(correction_content);
 	std::string line;
 	if(std::getline(ifs, line)) {  // first line "Laser id,Elevation,Azimuth"
 		printf("Parse Lidar Correction...\n");
 	}
-	float pitchList[PANDAR128_LASER_NUM];
-	float azimuthList[PANDAR128_LASER_NUM];
-	int lineCounter = 0;
+	lineCounter = 0;
 	while (std::getline(ifs, line)) {
-		if(line.length() < strlen("1,1,1")) {
+		if(line.length() < strlen("1,1,1") || lineCounter >= PANDAR128_LASER_NUM) {
 			return -1;
 		} 
 		else {
@@ -224,10 +532,6 @@ int PandarSwiftSDK::loadCorrectionString(std::string correction_content) {
 		pitchList[lineId - 1] = elev;
 		azimuthList[lineId - 1] = azimuth;
 	}
-	for (int i = 0; i < lineCounter; ++i) {
-		m_fElevAngle[i] = pitchList[i];
-		m_fHorizatalAzimuth[i] = azimuthList[i];
-	}
 	return 0;
 }
 
@@ -249,7 +553,21 @@ void PandarSwiftSDK::publishRawDataThread() {
 
 void PandarSwiftSDK::pushLiDARData(PandarPacket packet) {
 	//  printf("PandarSwiftSDK::pushLiDARData");
-	m_PacketsBuffer.push_back(packet);
+	if(packet.stamp > 0) {
+		double receiveTime = getNowTimeSec() - packet.stamp;
+		m_objReceiveLatency.record(receiveTime > 0 ? static_cast<uint64_t>(receiveTime * 1000000) : 0);
+	}
+	m_objPacketLoss.push(packet);
+	bool overflowed = m_PacketsBuffer.m_lastOverflowed;
+	if(0 == m_PacketsBuffer.push_back(packet)) {
+		m_u64DroppedPackets.fetch_add(1, boost::memory_order_relaxed);
+		if(!overflowed) {
+			m_u64BufferOverflows.fetch_add(1, boost::memory_order_relaxed);
+		}
+	}
+	else {
+		m_u64Packets.fetch_add(1, boost::memory_order_relaxed);
+	}
 	// printf("%d, %d\n",pkt.blocks[0].fAzimuth,pkt.blocks[1].fAzimuth);
 }
 
@@ -281,9 +599,353 @@ void PandarSwiftSDK::stop() {
 		delete m_publishRawDataThread;
 		m_publishRawDataThread = NULL;
 	}
+	if (m_calibrationThread) {
+		m_calibrationThread->join();
+		delete m_calibrationThread;
+		m_calibrationThread = NULL;
+	}
+	m_objStatusPoller.stop();
+	m_objShmWriter.close();
+	m_objFrameWriter.stop();
+	if (NULL != m_pTcpCommandClient) {
+		TcpCommandClientDestroy(m_pTcpCommandClient);
+		m_pTcpCommandClient = NULL;
+	}
+	m_spPandarDriver->stopRecord();
 	return;
 }
 
+int PandarSwiftSDK::startRecord(const PacketRecorderConfig &config) {
+	return m_spPandarDriver->startRecord(config);
+}
+
+void PandarSwiftSDK::stopRecord() {
+	m_spPandarDriver->stopRecord();
+}
+
+PacketRecorderStats PandarSwiftSDK::getRecorderStats() {
+	return m_spPandarDriver->getRecorderStats();
+}
+
+int PandarSwiftSDK::startFrameWriter(const FrameWriterConfig &config) {
+	return m_objFrameWriter.start(config);
+}
+
+void PandarSwiftSDK::stopFrameWriter() {
+	m_objFrameWriter.stop();
+}
+
+FrameWriterStats PandarSwiftSDK::getFrameWriterStats() {
+	return m_objFrameWriter.getStats();
+}
+
+void PandarSwiftSDK::setExtrinsic(const float *matrix) {
+	if(NULL == matrix) {
+		m_bExtrinsicFlag = false;
+		return;
+	}
+	memcpy(m_fExtrinsic, matrix, sizeof(m_fExtrinsic));
+	m_bExtrinsicFlag = true;
+}
+
+void PandarSwiftSDK::setPointFilter(const PointFilterConfig &config) {
+	boost::mutex::scoped_lock lock(m_mutexPendingConfig);
+	m_objPendingPointFilter = config;
+	m_bPointFilterPending = true;
+	m_bConfigPending.store(true, boost::memory_order_release);
+}
+
+// the decode kernels read the tables without locking, called while none is running
+void PandarSwiftSDK::applyPointFilter(const PointFilterConfig &config) {
+	m_fMinRange = config.minRange;
+	m_fMaxRange = config.maxRange > 0 ? config.maxRange : FLT_MAX;
+	m_u8MinIntensity = config.minIntensity;
+	m_bitRingKeep = config.ringMask;
+	m_vecAzimuthKeep.assign(CIRCLE, config.azimuthSectors.empty() ? 1 : 0);
+	for (int i = 0; i < config.azimuthSectors.size(); i++) {
+		if(config.azimuthSectors[i].second - config.azimuthSectors[i].first >= 360) {
+			m_vecAzimuthKeep.assign(CIRCLE, 1);
+			break;
+		}
+		int start = static_cast<int>(config.azimuthSectors[i].first * 100 + 0.5);
+		int end = static_cast<int>(config.azimuthSectors[i].second * 100 + 0.5);
+		start = ((start % CIRCLE) + CIRCLE) % CIRCLE;
+		end = ((end % CIRCLE) + CIRCLE) % CIRCLE;
+		for (int idx = start; idx != end; idx = (idx + 1) % CIRCLE) {
+			m_vecAzimuthKeep[idx] = 1;
+		}
+	}
+	m_bFilterFlag = m_fMinRange > 0 || config.maxRange > 0 || m_u8MinIntensity > 0 || !m_bitRingKeep.all() || !config.azimuthSectors.empty();
+	memcpy(m_fCropBoxMin, config.cropBoxMin, sizeof(m_fCropBoxMin));
+	memcpy(m_fCropBoxMax, config.cropBoxMax, sizeof(m_fCropBoxMax));
+	m_bCropBoxNegative = config.cropBoxNegative;
+	m_bCropBoxFlag = config.cropBoxEnable;
+}
+
+void PandarSwiftSDK::setVoxelGrid(const VoxelGridConfig &config, boost::function<void(boost::shared_ptr<PPointCloud>, double)> voxelcallback) {
+	boost::mutex::scoped_lock lock(m_mutexPendingConfig);
+	m_objPendingVoxelConfig = config;
+	m_funcPendingVoxelCallback = voxelcallback;
+	m_bVoxelPending = true;
+	m_bConfigPending.store(true, boost::memory_order_release);
+}
+
+void PandarSwiftSDK::setGroundSegmentation(const GroundSegmentationConfig &config, \
+								boost::function<void(boost::shared_ptr<PPointCloud>, boost::shared_ptr<std::vector<uint8_t> >, double)> groundcallback) {
+	boost::mutex::scoped_lock lock(m_mutexPendingConfig);
+	m_objPendingGroundConfig = config;
+	m_funcPendingGroundCallback = groundcallback;
+	m_bGroundPending = true;
+	m_bConfigPending.store(true, boost::memory_order_release);
+}
+
+void PandarSwiftSDK::setDualReturnOutput(const DualReturnConfig &config, \
+								boost::function<void(boost::shared_ptr<DualReturnFrame>, double)> returncallback) {
+	boost::mutex::scoped_lock lock(m_mutexPendingConfig);
+	m_objPendingDualReturnConfig = config;
+	m_funcPendingDualReturnCallback = returncallback;
+	m_bDualReturnPending = true;
+	m_bConfigPending.store(true, boost::memory_order_release);
+}
+
+void PandarSwiftSDK::setBackgroundSubtraction(const BackgroundConfig &config, \
+								boost::function<void(boost::shared_ptr<BackgroundSummary>, double)> summarycallback) {
+	boost::mutex::scoped_lock lock(m_mutexPendingConfig);
+	m_objPendingBackgroundConfig = config;
+	m_funcPendingBackgroundCallback = summarycallback;
+	m_bBackgroundPending = true;
+	m_bConfigPending.store(true, boost::memory_order_release);
+}
+
+void PandarSwiftSDK::relearnBackground() {
+	m_bRelearnBackground = true;
+}
+
+PandarSwiftStats PandarSwiftSDK::getStats() {
+	PandarSwiftStats stats;
+	stats.u64Packets = m_u64Packets.load(boost::memory_order_relaxed);
+	stats.u64DroppedPackets = m_u64DroppedPackets.load(boost::memory_order_relaxed);
+	stats.u64BufferOverflows = m_u64BufferOverflows.load(boost::memory_order_relaxed);
+	stats.u64RedundantPoints = m_u64RedundantPoints.load(boost::memory_order_relaxed);
+	stats.u64Frames = m_u64Frames.load(boost::memory_order_relaxed);
+	stats.receive = m_objReceiveLatency.getSnapshot();
+	stats.bufferWait = m_objBufferWaitLatency.getSnapshot();
+	stats.decode = m_objDecodeLatency.getSnapshot();
+	stats.frameAssembly = m_objFrameAssemblyLatency.getSnapshot();
+	stats.callback = m_objCallbackLatency.getSnapshot();
+	return stats;
+}
+
+void PandarSwiftSDK::enableTrace(bool enabled) {
+	TraceRecorder::instance().enable(enabled);
+}
+
+int PandarSwiftSDK::dumpTrace(std::string filename, double windowsec) {
+	return TraceRecorder::instance().dump(filename, windowsec);
+}
+
+void PandarSwiftSDK::resetStats() {
+	m_u64Packets.store(0, boost::memory_order_relaxed);
+	m_u64DroppedPackets.store(0, boost::memory_order_relaxed);
+	m_u64BufferOverflows.store(0, boost::memory_order_relaxed);
+	m_u64RedundantPoints.store(0, boost::memory_order_relaxed);
+	m_u64Frames.store(0, boost::memory_order_relaxed);
+	m_objReceiveLatency.reset();
+	m_objBufferWaitLatency.reset();
+	m_objDecodeLatency.reset();
+	m_objFrameAssemblyLatency.reset();
+	m_objCallbackLatency.reset();
+}
+
+PacketLossStats PandarSwiftSDK::getPacketLossStats() {
+	return m_objPacketLoss.getStats();
+}
+
+void PandarSwiftSDK::setPacketLossCallback(boost::function<void(const PacketLossStats &)> losscallback, uint32_t periodms) {
+	m_funcPacketLossCallback = losscallback;
+	m_u32PacketLossPeriod = periodms > 0 ? periodms : 1000;
+}
+
+void PandarSwiftSDK::reportPacketLoss() {
+	uint32_t tick = GetTickCount();
+	if(tick - m_u32LastPacketLossTick < m_u32PacketLossPeriod) {
+		return;
+	}
+	m_u32LastPacketLossTick = tick;
+	PacketLossStats stats = m_objPacketLoss.getStats();
+	if(NULL != m_funcPacketLossCallback) {
+		m_funcPacketLossCallback(stats);
+	}
+	else if(stats.u64Lost > m_objLastPacketLoss.u64Lost) {
+		uint64_t lost = stats.u64Lost - m_objLastPacketLoss.u64Lost;
+		uint64_t received = stats.u64Received - m_objLastPacketLoss.u64Received;
+		printf("dropped: %lu, %lu, percent, %f\n", lost, lost + received, float(lost) / float(lost + received) * 100.0);
+	}
+	m_objLastPacketLoss = stats;
+}
+
+void PandarSwiftSDK::segmentGround(int cursor) {
+	PPointCloud &cloud = *m_OutMsgArray[cursor];
+	std::vector<uint8_t> &labels = *m_GroundLabelArray[cursor];
+	int columnNum = m_objGroundSegmentation.prepare(cloud.points.size() / m_iLaserNum, m_iLaserNum, m_spCalibration->elevAngle, labels);
+	int step = (columnNum + GROUND_SECTOR_NUM - 1) / GROUND_SECTOR_NUM;
+	if(step <= 0) {
+		return;
+	}
+	tf::Taskflow taskFlow;
+	taskFlow.parallel_for(0, columnNum, step, [this, &cloud, &labels, step, columnNum](int begin) {
+		m_objGroundSegmentation.segmentColumns(cloud, begin, std::min(begin + step, columnNum), labels);
+	});
+	executor.run(taskFlow).wait();
+}
+
+void PandarSwiftSDK::splitReturns(int cursor) {
+	PPointCloud &cloud = *m_OutMsgArray[cursor];
+	DualReturnFrame &frame = *m_DualReturnArray[cursor];
+	frame.u8ReturnMode = m_iReturnMode;
+	if(LIDAR_RETURN_BLOCK_SIZE_1 == m_iReturnBlockSize) {
+		frame.planes[1] = ReturnPlane();
+	}
+	uint32_t duplicates[RETURN_PLANE_NUM] = {0};
+	tf::Taskflow taskFlow;
+	taskFlow.parallel_for(0, m_iReturnBlockSize, 1, [this, &cloud, &frame, &duplicates](int block) {
+		duplicates[block] = m_objDualReturnSplitter.split(cloud, m_iLaserNum, m_iReturnBlockSize, block, m_iReturnMode, frame.planes[block]);
+	});
+	executor.run(taskFlow).wait();
+	frame.u32Duplicates = 0;
+	for (int block = 0; block < m_iReturnBlockSize; block++) {
+		frame.u32Duplicates += duplicates[block];
+	}
+	m_objDualReturnSplitter.reset(CIRCLE_ANGLE / m_iAngleSize * m_iLaserNum);
+}
+
+int PandarSwiftSDK::getDecodeThreadNum() {
+	return executor.num_workers();
+}
+
+void PandarSwiftSDK::benchmarkDecode(PandarPacket &pkt, bool dispatch) {
+	if(dispatch) {
+		calcPointXYZIT(pkt, 0);
+		return;
+	}
+	(this->*m_pfnDecodeKernel)(pkt, 0);
+}
+
+void PandarSwiftSDK::benchmarkClearFrame() {
+	PPointCloud &cloud = *m_OutMsgArray[0];
+	std::fill(cloud.points.begin(), cloud.points.end(), PPoint());
+	m_RedundantPointBuffer.clear();
+}
+
+void PandarSwiftSDK::benchmarkLoadPackets(const std::vector<PandarPacket> &packets) {
+	m_PacketsBuffer.m_iterPush = m_PacketsBuffer.m_buffers.begin();
+	for (int i = 0; i < packets.size() && i < m_PacketsBuffer.m_buffers.size(); i++) {
+		m_PacketsBuffer.recordAzimuths(packets[i]);
+		*(m_PacketsBuffer.m_iterPush++) = packets[i];
+	}
+}
+
+int PandarSwiftSDK::benchmarkFindFrameEnd(int begin, int size) {
+	m_PacketsBuffer.m_iterTaskBegin = m_PacketsBuffer.m_buffers.begin() + begin;
+	m_PacketsBuffer.m_iterTaskEnd = m_PacketsBuffer.m_iterTaskBegin + size;
+	if(!isNeedPublish()) {
+		return 0;
+	}
+	moveTaskEndToStartAngle();
+	return m_PacketsBuffer.getTaskEnd() - m_PacketsBuffer.getTaskBegin();
+}
+
+void PandarSwiftSDK::benchmarkDecodeTask(int begin, int size) {
+	m_PacketsBuffer.m_iterTaskBegin = m_PacketsBuffer.m_buffers.begin() + begin;
+	m_PacketsBuffer.m_iterTaskEnd = m_PacketsBuffer.m_iterTaskBegin + size;
+	doTaskFlow(0);
+}
+
+int PandarSwiftSDK::getVoxelPartition() {
+	std::optional<unsigned> worker = executor.this_worker_id();
+	return worker ? *worker : executor.num_workers();
+}
+
+void PandarSwiftSDK::setPoseInterpolator(boost::shared_ptr<PoseInterpolator> interpolator, boost::function<double(double)> reference) {
+	boost::mutex::scoped_lock lock(m_mutexPendingConfig);
+	m_spPendingPoseInterpolator = interpolator;
+	m_funcPendingDeskewReference = reference;
+	m_bPoseInterpolatorPending = true;
+	m_bConfigPending.store(true, boost::memory_order_release);
+}
+
+bool PandarSwiftSDK::getBlockTransform(double blocktime, float *matrix) {
+	float motion[12];
+	if(NULL != m_spPoseInterpolator && m_spPoseInterpolator->getRelativeTransform(blocktime, m_dDeskewRefTime, motion)) {
+		if(!m_bExtrinsicFlag) {
+			memcpy(matrix, motion, sizeof(motion));
+			return true;
+		}
+		// motion * extrinsic, the poses are given in the extrinsic frame
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 4; j++) {
+				matrix[i * 4 + j] = motion[i * 4] * m_fExtrinsic[j] + motion[i * 4 + 1] * m_fExtrinsic[4 + j] + motion[i * 4 + 2] * m_fExtrinsic[8 + j];
+			}
+			matrix[i * 4 + 3] += motion[i * 4 + 3];
+		}
+		return true;
+	}
+	if(m_bExtrinsicFlag) {
+		memcpy(matrix, m_fExtrinsic, sizeof(m_fExtrinsic));
+		return true;
+	}
+	return false;
+}
+
+// mktime is by far the slowest step of a packet, the UTC field changes once a second
+static double utcToUnixSecond(const uint8_t *utc) {
+	static thread_local uint8_t lastUtc[PANDAR128_UTC_SIZE] = {0};
+	static thread_local double lastSecond = 0;
+	if(0 != lastSecond && 0 == memcmp(lastUtc, utc, PANDAR128_UTC_SIZE)) {
+		return lastSecond;
+	}
+	struct tm t = {0};
+	t.tm_year = utc[0];
+	t.tm_mon = utc[1] - 1;
+	t.tm_mday = utc[2];
+	t.tm_hour = utc[3];
+	t.tm_min = utc[4];
+	t.tm_sec = utc[5];
+	t.tm_isdst = 0;
+	memcpy(lastUtc, utc, PANDAR128_UTC_SIZE);
+	lastSecond = static_cast<double>(mktime(&t));
+	return lastSecond;
+}
+
+double PandarSwiftSDK::getPacketTimestamp(PandarPacket &pkt) {
+	const uint8_t *utc = NULL;
+	uint32_t timestamp = 0;
+	if(1 == pkt.data[2] && 3 == pkt.data[3]) {
+		Pandar128PacketVersion13 *packet = (Pandar128PacketVersion13*)(&pkt.data[0]);
+		utc = packet->tail.nUTCTime;
+		timestamp = packet->tail.nTimestamp;
+	}
+	else {
+		auto header = (Pandar128HeadVersion14*)(&pkt.data[0]);
+		int tailIndex = PANDAR128_HEAD_SIZE + 
+					(header->hasConfidence() ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE * header->u8LaserNum * header->u8BlockNum : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE * header->u8LaserNum * header->u8BlockNum) + 
+					PANDAR128_AZIMUTH_SIZE * header->u8BlockNum + 
+					PANDAR128_CRC_SIZE + 
+					(header->hasFunctionSafety()? PANDAR128_FUNCTION_SAFETY_SIZE : 0);
+		if(3 == pkt.data[2]) {
+			auto tail = (PandarQT128Tail*)(&pkt.data[0] + tailIndex);
+			utc = tail->nUTCTime;
+			timestamp = tail->nTimestamp;
+		}
+		else {
+			auto tail = (Pandar128TailVersion14*)(&pkt.data[0] + tailIndex);
+			utc = tail->nUTCTime;
+			timestamp = tail->nTimestamp;
+		}
+	}
+	return utcToUnixSecond(utc) + m_iTimeZoneSecond + static_cast<double>(timestamp) / 1000000.0;
+}
+
 int PandarSwiftSDK::parseData(Pandar128PacketVersion13 &packet, const uint8_t *recvbuf, const int len) {
 	int index = 0;
 	if(recvbuf[0] != 0xEE && recvbuf[1] != 0xFF && recvbuf[2] != 1 ) {    
@@ -334,9 +996,8 @@ int PandarSwiftSDK::processLiDARData() {
 	struct timespec ts;
 	int ret = 0;
 	int cursor = 0;
-	// uint32_t startTick = GetTickCount();
-	// uint32_t endTick;
 	init();
+	applyPendingConfig();
 	while (1) {
 		boost::this_thread::interruption_point();
 		if(!m_PacketsBuffer.hasEnoughPackets()) {
@@ -347,84 +1008,123 @@ int PandarSwiftSDK::processLiDARData() {
 		
 		if(0 == checkLiadaMode()) {
 			// printf("checkLiadaMode now!!");
-			m_OutMsgArray[cursor]->clear();
-			m_OutMsgArray[cursor]->resize(CIRCLE_ANGLE / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize);
+			resetOutCloud(cursor);
 			m_PacketsBuffer.creatNewTask();
+			selectDecodeKernel();
+			m_bNewFrame = true;
+			m_objVoxelGrid.clear();
+			if(m_bDualReturnFlag) {
+				m_objDualReturnSplitter.reset(CIRCLE_ANGLE / m_iAngleSize * m_iLaserNum);
+			}
+			if(m_bBackgroundFlag) {
+				m_objBackgroundModel.reset();
+			}
 			continue;
 		}
         checkClockwise();
 		// printf("begin: %d, end: %d\n",m_PacketsBuffer.getTaskBegin()->blocks[0].fAzimuth, (m_PacketsBuffer.getTaskEnd() - 1)->blocks[1].fAzimuth);
-		// uint32_t ifstart = GetTickCount();
 		if(isNeedPublish()) {   // Judging whether pass the  start angle
-			// uint32_t startTick1 = GetTickCount();
+			uint64_t assembleStart = GetMicroTickCountU64();
 			moveTaskEndToStartAngle();
 			doTaskFlow(cursor);
-			// uint32_t startTick2 = GetTickCount();
-			// printf("move and taskflow time:%d\n", startTick2 - startTick1);
+			m_bNewFrame = true;
+			if(NULL != m_spPoseInterpolator) {
+				m_dTimestamp = m_dDeskewRefTime;  // the time the points are deskewed to
+			}
+			if(m_bVoxelFlag) {
+				m_VoxelOutArray[cursor]->header.frame_id = m_sFrameId;
+				m_objVoxelGrid.merge(*m_VoxelOutArray[cursor]);
+			}
+			if(m_bGroundFlag) {
+				segmentGround(cursor);
+			}
+			if(m_bDualReturnFlag) {
+				splitReturns(cursor);
+			}
+			if(m_bBackgroundFlag) {
+				m_objBackgroundModel.endFrame(*m_BackgroundSummaryArray[cursor]);
+				if(m_bRelearnBackground.exchange(false)) {
+					m_objBackgroundModel.reset();
+				}
+			}
 			if(m_bPublishPointsFlag == false) {
+				setPublishOutputs();
 				m_bPublishPointsFlag = true;
 				m_iPublishPointsIndex = cursor;
 				cursor = (cursor + 1) % 2;
 			} 
 			else
 				printf("publishPoints not done yet, new publish is comming\n");
-			m_OutMsgArray[cursor]->clear();
-			m_OutMsgArray[cursor]->resize(CIRCLE_ANGLE / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize );
+			resetOutCloud(cursor);
 			if(m_RedundantPointBuffer.size() > 0 && m_RedundantPointBuffer.size() < 1000){
 				for(int i = 0; i < m_RedundantPointBuffer.size(); i++){
 				m_OutMsgArray[cursor]->points[m_RedundantPointBuffer[i].index] = m_RedundantPointBuffer[i].point;
 				}
 			}
+			m_u64RedundantPoints.fetch_add(m_RedundantPointBuffer.size(), boost::memory_order_relaxed);
 			m_RedundantPointBuffer.clear();
-			// uint32_t endTick2 = GetTickCount();
-			// if(endTick2 - startTick2 > 2) {
-				// printf("m_OutMsgArray time:%d\n", endTick2 - startTick2);
-			// }
 			m_OutMsgArray[cursor]->header.frame_id = m_sFrameId;
 			m_OutMsgArray[cursor]->height = 1;
-			// endTick = GetTickCount();
-			// printf("total time: %d\n", endTick - startTick);
-			// startTick = endTick;
+			m_u64Frames.fetch_add(1, boost::memory_order_relaxed);
+			m_objFrameAssemblyLatency.record(GetMicroTickCountU64() - assembleStart);
+			applyPendingCalibration();
+			applyPendingConfig();
 			continue;
 		}
-		// uint32_t taskflow1 = GetTickCount();
-			// printf("if compare time: %d\n", ifTick - startTick);
 		doTaskFlow(cursor);
-		// uint32_t taskflow2 = GetTickCount();
-			// printf("taskflow time: %d\n", taskflow2 - taskflow1);
+	}
+}
 
+// a cloud a consumer still holds is left to it, the next frame is decoded into a new one;
+// the voxel cloud, ground labels, return planes and background summary are handed out alike
+void PandarSwiftSDK::resetOutCloud(int cursor) {
+	if(m_VoxelOutArray[cursor].use_count() > 1) {
+		m_VoxelOutArray[cursor].reset(new PPointCloud);
+	}
+	if(m_GroundLabelArray[cursor].use_count() > 1) {
+		m_GroundLabelArray[cursor].reset(new std::vector<uint8_t>);
+	}
+	if(m_DualReturnArray[cursor].use_count() > 1) {
+		m_DualReturnArray[cursor].reset(new DualReturnFrame);
 	}
+	if(m_BackgroundSummaryArray[cursor].use_count() > 1) {
+		m_BackgroundSummaryArray[cursor].reset(new BackgroundSummary);
+	}
+	int size = CIRCLE_ANGLE / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize;
+	if(m_OutMsgArray[cursor].use_count() > 1) {
+		m_OutMsgArray[cursor].reset(new PPointCloud(size, 1));
+		m_OutMsgArray[cursor]->header.frame_id = m_sFrameId;
+		return;
+	}
+	m_OutMsgArray[cursor]->clear();
+	m_OutMsgArray[cursor]->resize(size);
 }
 
 void PandarSwiftSDK::moveTaskEndToStartAngle() {
-	// uint32_t startTick = GetTickCount();
-	if(m_bClockwise == true){
-		for(PktArray::iterator iter = m_PacketsBuffer.m_iterTaskBegin; iter < m_PacketsBuffer.m_iterTaskEnd; iter++) {
-			if ((*(uint16_t*)(&(iter->data[0]) + m_iFirstAzimuthIndex) > *(uint16_t*)(&((iter + 1)->data[0]) + m_iFirstAzimuthIndex)) &&
-				(m_iLidarRotationStartAngle <= *(uint16_t*)(&((iter + 1)->data[0]) + m_iFirstAzimuthIndex)) ||
-				((*(uint16_t*)(&(iter->data[0]) + m_iFirstAzimuthIndex) < m_iLidarRotationStartAngle) &&
-				(m_iLidarRotationStartAngle <= *(uint16_t*)(&((iter + 1)->data[0]) + m_iFirstAzimuthIndex)))) {
-				// printf("move iter to : %d\n", (iter + 1)->blocks[0].fAzimuth);
-				m_PacketsBuffer.moveTaskEnd(iter + 1);
-				break;
-			}
-		}
+	TraceScope trace("moveTaskEndToStartAngle");
+	// the angle turned since the first packet of the task grows along the task in either
+	// rotation direction, the frame ends before the first packet at or past the start angle
+	PktArray::iterator begin = m_PacketsBuffer.getTaskBegin();
+	int size = m_PacketsBuffer.getTaskEnd() - begin;
+	uint16_t beginAzimuth = m_PacketsBuffer.getFirstAzimuth(begin);
+	int startAngle = getRotatedAngle(beginAzimuth, m_iLidarRotationStartAngle);
+	if(0 == startAngle) {
+		return;  // the task begins on the start angle, its crossing is behind
 	}
-	else{
-		for(PktArray::iterator iter = m_PacketsBuffer.m_iterTaskBegin; iter < m_PacketsBuffer.m_iterTaskEnd; iter++) {
-			if ((*(uint16_t*)(&(iter->data[0]) + m_iFirstAzimuthIndex) < *(uint16_t*)(&((iter + 1)->data[0]) + m_iFirstAzimuthIndex)) &&
-				((((CIRCLE_ANGLE - m_iLidarRotationStartAngle > CIRCLE_ANGLE / 2)) &&(m_iLidarRotationStartAngle <= *(uint16_t*)(&((iter + 1)->data[0]) + m_iFirstAzimuthIndex))) ||
-				(((CIRCLE_ANGLE - m_iLidarRotationStartAngle < CIRCLE_ANGLE / 2)) &&(m_iLidarRotationStartAngle >= *(uint16_t*)(&((iter)->data[0]) + m_iFirstAzimuthIndex)))) ||
-				((*(uint16_t*)(&(iter->data[0]) + m_iFirstAzimuthIndex) > m_iLidarRotationStartAngle) &&
-				(m_iLidarRotationStartAngle >= *(uint16_t*)(&((iter + 1)->data[0]) + m_iFirstAzimuthIndex)))) {
-				// printf("move iter to : %d\n", (iter + 1)->blocks[0].fAzimuth);
-				m_PacketsBuffer.moveTaskEnd(iter + 1);
-				break;
-			}
+	int low = 1;
+	int high = size;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if(getRotatedAngle(beginAzimuth, m_PacketsBuffer.getFirstAzimuth(begin + mid)) >= startAngle) {
+			high = mid;
+		}
+		else {
+			low = mid + 1;
 		}
 	}
-	// uint32_t endTick = GetTickCount();
-	// printf("moveTaskEndToStartAngle time: %d\n", endTick - startTick);
+	if(low < size) {
+		m_PacketsBuffer.moveTaskEnd(begin + low);
+	}
 }
 
 void PandarSwiftSDK::publishPointsThread() {
@@ -433,50 +1133,79 @@ void PandarSwiftSDK::publishPointsThread() {
 		boost::this_thread::interruption_point();
 		usleep(1000);
 		if(m_bPublishPointsFlag) {
-			// uint32_t start = GetTickCount();
+			TraceScope trace("publish", m_iPublishPointsIndex);
+			uint64_t callbackStart = GetMicroTickCountU64();
+			const PublishOutputs &outputs = m_objPublishOutputs;
+			bool consumed = NULL != m_funcPclCallback || m_objShmWriter.isOpen() || m_objFrameWriter.isWriting();
+			if(outputs.background && NULL != outputs.backgroundCallback) {
+				outputs.backgroundCallback(m_BackgroundSummaryArray[m_iPublishPointsIndex], m_dTimestamp);
+				consumed = true;
+			}
+			if(outputs.dualReturn && NULL != outputs.dualReturnCallback) {
+				outputs.dualReturnCallback(m_DualReturnArray[m_iPublishPointsIndex], m_dTimestamp);
+				consumed = true;
+			}
+			if(outputs.ground && NULL != outputs.groundCallback) {
+				outputs.groundCallback(m_OutMsgArray[m_iPublishPointsIndex], m_GroundLabelArray[m_iPublishPointsIndex], m_dTimestamp);
+				consumed = true;
+			}
+			if(outputs.voxel && NULL != outputs.voxelCallback) {
+				outputs.voxelCallback(m_VoxelOutArray[m_iPublishPointsIndex], m_dTimestamp);
+				consumed = true;
+			}
+			// without a voxel callback the reduced cloud replaces the full frame
+			boost::shared_ptr<PPointCloud> cloud = outputs.voxel && NULL == outputs.voxelCallback ? m_VoxelOutArray[m_iPublishPointsIndex] : m_OutMsgArray[m_iPublishPointsIndex];
+			if(m_objShmWriter.isOpen() && 0 != m_objShmWriter.publish(*cloud, m_dTimestamp)) {
+				printf("frame of %zu points exceeds the shared memory slot\n", cloud->points.size());
+			}
+			if(cloud == m_OutMsgArray[m_iPublishPointsIndex]) {
+				m_objFrameWriter.push(cloud, m_dTimestamp, m_iLaserNum, m_iReturnBlockSize);
+			}
+			else {
+				m_objFrameWriter.push(cloud, m_dTimestamp);
+			}
 			if(NULL != m_funcPclCallback) {
-				m_funcPclCallback(m_OutMsgArray[m_iPublishPointsIndex], m_dTimestamp);
+				m_funcPclCallback(cloud, m_dTimestamp);
+			}
+			if(consumed) {
 				m_dTimestamp = 0;
 				m_bPublishPointsFlag = false;
 			}
-			// uint32_t end = GetTickCount();
-  			// if(end - start > 150) printf("publishPoints time:%d\n", end - start);
+			m_objCallbackLatency.record(GetMicroTickCountU64() - callbackStart);
 		}
+		reportPacketLoss();
 	}
 }
 
 void PandarSwiftSDK::doTaskFlow(int cursor) {
-  tf::Taskflow taskFlow;
-  switch (m_u8UdpVersionMajor)
-  {
-    case 1:
-    {
-      taskFlow.parallel_for(m_PacketsBuffer.getTaskBegin(),
-                            m_PacketsBuffer.getTaskEnd(),
-                            [this, &cursor](auto &taskpkt) {
-                              calcPointXYZIT(taskpkt,cursor);
-                            });
-    }
-    break;
-    case 3:
-    {
-      taskFlow.parallel_for(m_PacketsBuffer.getTaskBegin(),
-                            m_PacketsBuffer.getTaskEnd(),
-                            [this, &cursor](auto &taskpkt) {
-                              calcQT128PointXYZIT(taskpkt,cursor);
-                            });
-    }
-    break;
-    default: 
-    break;             
+  if(m_bNewFrame && NULL != m_spPoseInterpolator) {
+    // the frame is published with this timestamp instead of its earliest point
+    double frameTime = getPacketTimestamp(*m_PacketsBuffer.getTaskBegin());
+    m_dDeskewRefTime = NULL != m_funcDeskewReference ? m_funcDeskewReference(frameTime) : frameTime;
+    m_bNewFrame = false;
   }
+  double waitTime = getNowTimeSec() - m_PacketsBuffer.getTaskBegin()->stamp;
+  if(m_PacketsBuffer.getTaskBegin()->stamp > 0 && waitTime > 0) {
+    m_objBufferWaitLatency.record(static_cast<uint64_t>(waitTime * 1000000));
+  }
+  TraceScope trace("doTaskFlow", m_PacketsBuffer.getTaskEnd() - m_PacketsBuffer.getTaskBegin());
+  uint64_t decodeStart = GetMicroTickCountU64();
+  tf::Taskflow taskFlow;
+  DecodeKernel kernel = m_pfnDecodeKernel;
+  taskFlow.parallel_for(m_PacketsBuffer.getTaskBegin(),
+                        m_PacketsBuffer.getTaskEnd(),
+                        [this, kernel, &cursor](auto &taskpkt) {
+                          (this->*kernel)(taskpkt, cursor);
+                        });
   executor.run(taskFlow).wait();
+  m_objDecodeLatency.record(GetMicroTickCountU64() - decodeStart);
   m_PacketsBuffer.creatNewTask();
 
 }
 
 void PandarSwiftSDK::init() {
 	while (1) {
+		boost::this_thread::interruption_point();
 		if(!m_PacketsBuffer.hasEnoughPackets()) {
 			usleep(1000);
 			continue;
@@ -572,13 +1301,14 @@ void PandarSwiftSDK::init() {
 		boost::shared_ptr<PPointCloud> outMag1(new PPointCloud(CIRCLE_ANGLE / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize, 1));
 		m_OutMsgArray[0] = outMag0;
 		m_OutMsgArray[1] = outMag1;
+		selectDecodeKernel();
 		break;
 	}
 }
 
 void PandarSwiftSDK::checkClockwise(){
-  uint16_t frontAzimuth = *(uint16_t*)(&(m_PacketsBuffer.m_iterTaskBegin->data[0]) + m_iFirstAzimuthIndex);
-  uint16_t backAzimuth = *(uint16_t*)(&((m_PacketsBuffer.m_iterTaskBegin + 1)->data[0]) + m_iFirstAzimuthIndex);
+  uint16_t frontAzimuth = m_PacketsBuffer.getFirstAzimuth(m_PacketsBuffer.m_iterTaskBegin);
+  uint16_t backAzimuth = m_PacketsBuffer.getFirstAzimuth(m_PacketsBuffer.m_iterTaskBegin + 1);
   if(((frontAzimuth < backAzimuth) && ((backAzimuth - frontAzimuth) <  m_iAngleSize * 10)) 
      ||
     ((frontAzimuth > backAzimuth) && (frontAzimuth - backAzimuth) > m_iAngleSize * 10))
@@ -690,6 +1420,7 @@ int PandarSwiftSDK::checkLiadaMode() {
 			CIRCLE_ANGLE * 100 / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize, 1));
 		m_OutMsgArray[0] = outMag0;
 		m_OutMsgArray[1] = outMag1;
+		selectDecodeKernel();
 		return 1;
 	} 
 	else{
@@ -771,253 +1502,276 @@ void PandarSwiftSDK::changeReturnBlockSize() {
 }
 
 void PandarSwiftSDK::calcPointXYZIT(PandarPacket &pkt, int cursor) {
-	if (pkt.data[3] == 3){
-		Pandar128PacketVersion13 packet;
-		memcpy(&packet, &pkt.data[0], sizeof(Pandar128PacketVersion13));
-		struct tm t = {0};
-		t.tm_year = packet.tail.nUTCTime[0];
-		t.tm_mon = packet.tail.nUTCTime[1] - 1;
-		t.tm_mday = packet.tail.nUTCTime[2];
-		t.tm_hour = packet.tail.nUTCTime[3];
-		t.tm_min = packet.tail.nUTCTime[4];
-		t.tm_sec = packet.tail.nUTCTime[5];
-		t.tm_isdst = 0;
-		double unix_second = static_cast<double>(mktime(&t) + m_iTimeZoneSecond);
-		for (int blockid = 0; blockid < packet.head.u8BlockNum; blockid++) {
-			Pandar128Block &block = packet.blocks[blockid];
-			int mode = packet.tail.nShutdownFlag & 0x03;
-			int state = 0;
-			if(0 == blockid)
-				state = (packet.tail.nShutdownFlag & 0xC0) >> 6;
-			if(1 == blockid)
-				state = (packet.tail.nShutdownFlag & 0x30) >> 4;
-			for (int i = 0; i < packet.head.u8LaserNum; i++) {
-				/* for all the units in a block */
-				Pandar128Unit &unit = block.units[i];
-				PPoint point;
-				float distance =static_cast<float>(unit.u16Distance) * PANDAR128_DISTANCE_UNIT;
-				/* filter distance */
-				// if(distance < 0.1) {
-				// 	continue;
-				// }
-				float azimuth = m_fHorizatalAzimuth[i] + (block.fAzimuth / 100.0f);
-				float originAzimuth = azimuth;
-				float pitch = m_fElevAngle[i];
-				float originPitch = pitch;
-				float offset = m_objLaserOffset.getTSOffset(i, mode, state, distance, m_u8UdpVersionMajor);
-				azimuth += m_objLaserOffset.getAngleOffset(offset, packet.tail.nMotorSpeed, m_u8UdpVersionMajor);
-#ifdef FIRETIME_CORRECTION_CHECK 
-        printf("Laser ID = %d, speed = %d, origin azimuth = %f, azimuth = %f, delt = %f\n", i + 1, packet.tail.nMotorSpeed, originAzimuth, azimuth, azimuth - originAzimuth);  
-#endif 
-				if(m_bCoordinateCorrectionFlag){
-					pitch += m_objLaserOffset.getPitchOffset(m_sFrameId, pitch, distance);
-				}
-				int pitchIdx = static_cast<int>(pitch * 100 + 0.5);
-				if (pitchIdx  >= CIRCLE) {
-					pitchIdx  -= CIRCLE;
-				} else if (pitchIdx  < 0) {
-					pitchIdx  += CIRCLE;
-				}
-				float xyDistance = distance * m_fCosAllAngle[pitchIdx];
-				if(m_bCoordinateCorrectionFlag){
-					azimuth += m_objLaserOffset.getAzimuthOffset(m_sFrameId, originAzimuth, block.fAzimuth / 100.0f, xyDistance);
-				}
-				int azimuthIdx = static_cast<int>(azimuth * 100 + 0.5);
-				if(azimuthIdx >= CIRCLE) {
-					azimuthIdx -= CIRCLE;
-				} 
-				else if(azimuthIdx < 0) {
-					azimuthIdx += CIRCLE;
-				}
-				point.x = xyDistance * m_fSinAllAngle[azimuthIdx];
-				point.y = xyDistance * m_fCosAllAngle[azimuthIdx];
-				point.z = distance * m_fSinAllAngle[pitchIdx];
-				point.intensity = unit.u8Intensity;
-				point.timestamp = unix_second + (static_cast<double>(packet.tail.nTimestamp)) / 1000000.0;
-				point.timestamp = point.timestamp + m_objLaserOffset.getBlockTS(blockid, packet.tail.nReturnMode, mode, packet.head.u8LaserNum) / 1000000000.0 + offset / 1000000000.0;
-				if(0 == m_dTimestamp) {
-					m_dTimestamp = point.timestamp;
-				}
-				else if(m_dTimestamp > point.timestamp) {
-					m_dTimestamp = point.timestamp;
-				}
-				point.ring = i + 1;
-				int point_index;
-				if(LIDAR_RETURN_BLOCK_SIZE_2 == m_iReturnBlockSize) {
-					point_index = (block.fAzimuth) / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize + m_iLaserNum * blockid + i;
-					// printf("block 2 index:[%d]",index);
-				} 
-				else {
-					point_index = (block.fAzimuth) / m_iAngleSize * m_iLaserNum + i;
-				}
-				if(m_OutMsgArray[cursor]->points[point_index].ring == 0){
-					m_OutMsgArray[cursor]->points[point_index] = point;
-				}
-				else{
-					pthread_mutex_lock(&m_RedundantPointLock);
-					m_RedundantPointBuffer.push_back(RedundantPoint{point_index, point});
-					pthread_mutex_unlock(&m_RedundantPointLock);
-				}
+	DecodeKernel kernel = getDecodeKernel(pkt.data);
+	if(NULL != kernel) {
+		(this->*kernel)(pkt, cursor);
+	}
+}
+
+template <int Minor, int LaserNum, bool Confidence>
+PandarSwiftSDK::DecodeKernel PandarSwiftSDK::getPandar128Kernel(bool dualreturn, bool correction) {
+	if(dualreturn) {
+		return correction ? &PandarSwiftSDK::calcPandar128Points<Minor, LaserNum, Confidence, true, true> :
+							&PandarSwiftSDK::calcPandar128Points<Minor, LaserNum, Confidence, true, false>;
+	}
+	return correction ? &PandarSwiftSDK::calcPandar128Points<Minor, LaserNum, Confidence, false, true> :
+						&PandarSwiftSDK::calcPandar128Points<Minor, LaserNum, Confidence, false, false>;
+}
+
+template <int LaserNum, bool Confidence>
+PandarSwiftSDK::DecodeKernel PandarSwiftSDK::getQT128Kernel(bool dualreturn) {
+	return dualreturn ? &PandarSwiftSDK::calcQT128Points<LaserNum, Confidence, true> :
+						&PandarSwiftSDK::calcQT128Points<LaserNum, Confidence, false>;
+}
+
+PandarSwiftSDK::DecodeKernel PandarSwiftSDK::getDecodeKernel(const uint8_t *data) {
+	bool fullLasers = PANDAR128_LASER_NUM == data[PANDAR_LASER_NUMBER_INDEX];
+	bool confidence = reinterpret_cast<const Pandar128HeadVersion14 *>(data)->hasConfidence();
+	bool dualReturn = LIDAR_RETURN_BLOCK_SIZE_2 == m_iReturnBlockSize;
+	switch (data[PANDAR_MAJOR_VERSION_INDEX])
+	{
+		case 1:
+		if(3 == data[PANDAR_MAJOR_VERSION_INDEX + 1]) {
+			// 1.3 has no confidence byte
+			return fullLasers ? getPandar128Kernel<3, PANDAR128_LASER_NUM, false>(dualReturn, m_bCoordinateCorrectionFlag) :
+								getPandar128Kernel<3, 0, false>(dualReturn, m_bCoordinateCorrectionFlag);
+		}
+		if(4 == data[PANDAR_MAJOR_VERSION_INDEX + 1]) {
+			if(fullLasers) {
+				return confidence ? getPandar128Kernel<4, PANDAR128_LASER_NUM, true>(dualReturn, m_bCoordinateCorrectionFlag) :
+									getPandar128Kernel<4, PANDAR128_LASER_NUM, false>(dualReturn, m_bCoordinateCorrectionFlag);
 			}
+			return confidence ? getPandar128Kernel<4, 0, true>(dualReturn, m_bCoordinateCorrectionFlag) :
+								getPandar128Kernel<4, 0, false>(dualReturn, m_bCoordinateCorrectionFlag);
 		}
+		break;
+		case 3:
+		if(fullLasers) {
+			return confidence ? getQT128Kernel<PANDAR128_LASER_NUM, true>(dualReturn) : getQT128Kernel<PANDAR128_LASER_NUM, false>(dualReturn);
+		}
+		return confidence ? getQT128Kernel<0, true>(dualReturn) : getQT128Kernel<0, false>(dualReturn);
+		default:
+		break;
 	}
-	else if(pkt.data[3] == 4){
-		auto header = (Pandar128HeadVersion14*)(&pkt.data[0]);
-		auto tail = (Pandar128TailVersion14*)(&pkt.data[0] + PANDAR128_HEAD_SIZE + 
-					(header->hasConfidence() ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE * header->u8LaserNum * header->u8BlockNum : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE * header->u8LaserNum * header->u8BlockNum) + 
-					PANDAR128_AZIMUTH_SIZE * header->u8BlockNum + 
-					PANDAR128_CRC_SIZE + 
+	return NULL;
+}
+
+void PandarSwiftSDK::selectDecodeKernel() {
+	m_pfnDecodeKernel = getDecodeKernel((m_PacketsBuffer.getTaskEnd() - 1)->data);
+	if(NULL == m_pfnDecodeKernel) {
+		m_pfnDecodeKernel = &PandarSwiftSDK::calcPointXYZIT;
+	}
+}
+
+/**
+ * One packet of UDP 1.3 / 1.4. Everything the stream keeps for a mode is a
+ * template argument; LaserNum 0 reads the laser count from the packet. A
+ * packet that does not match the kernel goes through calcPointXYZIT.
+ */
+template <int Minor, int LaserNum, bool Confidence, bool DualReturn, bool CoordinateCorrection>
+void PandarSwiftSDK::calcPandar128Points(PandarPacket &pkt, int cursor) {
+	auto header = (Pandar128HeadVersion14*)(&pkt.data[0]);
+	if(1 != header->u8VersionMajor || Minor != header->u8VersionMinor || (0 != LaserNum && LaserNum != header->u8LaserNum) ||
+			(4 == Minor && Confidence != header->hasConfidence())) {
+		calcPointXYZIT(pkt, cursor);
+		return;
+	}
+	CalibrationTable &calibration = *m_spCalibration;
+	int voxelPartition = m_bVoxelFlag ? getVoxelPartition() : 0;
+	const int laserNum = 0 != LaserNum ? LaserNum : header->u8LaserNum;
+	const int unitSize = Confidence ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE;
+	const uint8_t *utc;
+	uint32_t timestamp;
+	uint8_t shutdownFlag;
+	uint8_t returnMode;
+	uint16_t motorSpeed;
+	if(3 == Minor) {
+		// 1.3 blocks always hold 128 units, the tail follows two of them
+		auto tail = (Pandar128TailVersion13*)(&pkt.data[0] + sizeof(Pandar128HeadVersion13) + sizeof(Pandar128Block) * PANDAR128_BLOCK_NUM);
+		utc = tail->nUTCTime;
+		timestamp = tail->nTimestamp;
+		shutdownFlag = tail->nShutdownFlag;
+		returnMode = tail->nReturnMode;
+		motorSpeed = tail->nMotorSpeed;
+	}
+	else {
+		auto tail = (Pandar128TailVersion14*)(&pkt.data[0] + PANDAR128_HEAD_SIZE +
+					unitSize * laserNum * header->u8BlockNum +
+					PANDAR128_AZIMUTH_SIZE * header->u8BlockNum +
+					PANDAR128_CRC_SIZE +
 					(header->hasFunctionSafety()? PANDAR128_FUNCTION_SAFETY_SIZE : 0));
-		struct tm t = {0};
-		t.tm_year = tail->nUTCTime[0];
-		t.tm_mon = tail->nUTCTime[1] - 1;
-		t.tm_mday = tail->nUTCTime[2];
-		t.tm_hour = tail->nUTCTime[3];
-		t.tm_min = tail->nUTCTime[4];
-		t.tm_sec = tail->nUTCTime[5];
-		t.tm_isdst = 0;
-		double unix_second = static_cast<double>(mktime(&t) + m_iTimeZoneSecond);
-		int index = 0;
-		index += PANDAR128_HEAD_SIZE;
-		for (int blockid = 0; blockid < header->u8BlockNum; blockid++) {
-			uint16_t u16Azimuth = *(uint16_t*)(&pkt.data[0] + index);
-			index += PANDAR128_AZIMUTH_SIZE;
-			int mode = tail->nShutdownFlag & 0x03;
-			int state = 0;
-			if(0 == blockid)
-				state = (tail->nShutdownFlag & 0xC0) >> 6;
-			if(1 == blockid)
-				state = (tail->nShutdownFlag & 0x30) >> 4;
-			for (int i = 0; i < header->u8LaserNum; i++) {
-				/* for all the units in a block */
-				uint16_t u16Distance = *(uint16_t*)(&pkt.data[0] + index);
-				index += DISTANCE_SIZE;
-				uint8_t u8Intensity = *(uint8_t*)(&pkt.data[0] + index);
-				index += INTENSITY_SIZE;
-				index += header->hasConfidence() ? CONFIDENCE_SIZE : 0;
-				PPoint point;
-				float distance =static_cast<float>(u16Distance) * PANDAR128_DISTANCE_UNIT;
-				/* filter distance */
-				// if(distance < 0.1) {
-				// 	continue;
-				// }
-				float azimuth = m_fHorizatalAzimuth[i] + (u16Azimuth / 100.0f);
-				float originAzimuth = azimuth;
-				float pitch = m_fElevAngle[i];
-				float originPitch = pitch;
-				float offset = m_objLaserOffset.getTSOffset(i, mode, state, distance, m_u8UdpVersionMajor);
-				azimuth += m_objLaserOffset.getAngleOffset(offset, tail->nMotorSpeed, m_u8UdpVersionMajor);
-#ifdef FIRETIME_CORRECTION_CHECK 
-        printf("Laser ID = %d, speed = %d, origin azimuth = %f, azimuth = %f, delt = %f\n", i + 1, tail->nMotorSpeed, originAzimuth, azimuth, azimuth - originAzimuth);  
+		utc = tail->nUTCTime;
+		timestamp = tail->nTimestamp;
+		shutdownFlag = tail->nShutdownFlag;
+		returnMode = tail->nReturnMode;
+		motorSpeed = tail->nMotorSpeed;
+	}
+	const int blockStride = 3 == Minor ? PANDAR128_BLOCK_SIZE : PANDAR128_AZIMUTH_SIZE + unitSize * laserNum;
+	double packetTime = utcToUnixSecond(utc) + m_iTimeZoneSecond + static_cast<double>(timestamp) / 1000000.0;
+	int mode = shutdownFlag & 0x03;
+	double minTimestamp = 0;
+	bool firstKept[PANDAR128_LASER_NUM];  // units of the first return stored in the cloud
+	for (int blockid = 0; blockid < header->u8BlockNum; blockid++) {
+		const uint8_t *block = &pkt.data[0] + PANDAR128_HEAD_SIZE + blockid * blockStride;
+		uint16_t u16Azimuth = *(uint16_t*)block;
+		const uint8_t *unit = block + PANDAR128_AZIMUTH_SIZE;
+		int state = 0;
+		if(0 == blockid)
+			state = (shutdownFlag & 0xC0) >> 6;
+		if(1 == blockid)
+			state = (shutdownFlag & 0x30) >> 4;
+		double blockTime = packetTime + calibration.laserOffset.getBlockTS(blockid, returnMode, mode, laserNum) / 1000000000.0;
+		float blockMatrix[12];
+		bool blockTransform = getBlockTransform(blockTime, blockMatrix);
+		int blockIndex = DualReturn ? u16Azimuth / m_iAngleSize * m_iLaserNum * LIDAR_RETURN_BLOCK_SIZE_2 + m_iLaserNum * (blockid % 2) :
+									u16Azimuth / m_iAngleSize * m_iLaserNum;
+		float blockAzimuth = u16Azimuth / 100.0f;
+		if(DualReturn && !(blockid & 1)) {
+			memset(firstKept, 0, sizeof(firstKept));
+		}
+		for (int i = 0; i < laserNum; i++, unit += unitSize) {
+			/* for all the units in a block */
+			uint16_t u16Distance = *(uint16_t*)unit;
+			uint8_t u8Intensity = unit[DISTANCE_SIZE];
+			PPoint point;
+			float distance =static_cast<float>(u16Distance) * PANDAR128_DISTANCE_UNIT;
+			/* filter distance, intensity and ring */
+			if(isPointRejected(distance, u8Intensity, i)) {
+				continue;
+			}
+			if(DualReturn && (blockid & 1) && m_bDualReturnDedupe && 0 != u16Distance && firstKept[i] &&
+					u16Distance == *(const uint16_t*)(unit - blockStride)) {
+				m_objDualReturnSplitter.markDuplicate(u16Azimuth / m_iAngleSize * m_iLaserNum + i);
+				continue;
+			}
+			if(m_bBackgroundFlag && isBackgroundPoint(u16Azimuth, i, distance, !(DualReturn && (blockid & 1)))) {
+				continue;
+			}
+			float azimuth = calibration.horizatalAzimuth[i] + blockAzimuth;
+			float originAzimuth = azimuth;
+			float pitch = calibration.elevAngle[i];
+			float offset = calibration.laserOffset.getTSOffset(i, mode, state, distance, 1);
+			azimuth += calibration.laserOffset.getAngleOffset(offset, motorSpeed, 1);
+#ifdef FIRETIME_CORRECTION_CHECK
+        printf("Laser ID = %d, speed = %d, origin azimuth = %f, azimuth = %f, delt = %f\n", i + 1, motorSpeed, originAzimuth, azimuth, azimuth - originAzimuth);
 #endif
-				if(m_bCoordinateCorrectionFlag){
-					pitch += m_objLaserOffset.getPitchOffset(m_sFrameId, pitch, distance);
-				}
-				int pitchIdx = static_cast<int>(pitch * 100 + 0.5);
-				if (pitchIdx  >= CIRCLE) {
-					pitchIdx  -= CIRCLE;
-				} else if (pitchIdx  < 0) {
-					pitchIdx  += CIRCLE;
-				}
-				float xyDistance = distance * m_fCosAllAngle[pitchIdx];
-				if(m_bCoordinateCorrectionFlag){
-					azimuth += m_objLaserOffset.getAzimuthOffset(m_sFrameId, originAzimuth, u16Azimuth / 100.0f, xyDistance);
-				}
-				int azimuthIdx = static_cast<int>(azimuth * 100 + 0.5);
-				if(azimuthIdx >= CIRCLE) {
-					azimuthIdx -= CIRCLE;
-				} 
-				else if(azimuthIdx < 0) {
-					azimuthIdx += CIRCLE;
-				}
-				point.x = xyDistance * m_fSinAllAngle[azimuthIdx];
-				point.y = xyDistance * m_fCosAllAngle[azimuthIdx];
-				point.z = distance * m_fSinAllAngle[pitchIdx];
-				point.intensity = u8Intensity;
-				point.timestamp = unix_second + (static_cast<double>(tail->nTimestamp)) / 1000000.0;
-				point.timestamp = point.timestamp + m_objLaserOffset.getBlockTS(blockid, tail->nReturnMode, mode, header->u8LaserNum) / 1000000000.0 + offset / 1000000000.0;
-				if(0 == m_dTimestamp) {
-					m_dTimestamp = point.timestamp;
-				}
-				else if(m_dTimestamp > point.timestamp) {
-					m_dTimestamp = point.timestamp;
-				}
-				point.ring = i + 1;
-				int point_index;
-				if(LIDAR_RETURN_BLOCK_SIZE_2 == m_iReturnBlockSize) {
-					point_index = (u16Azimuth) / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize + m_iLaserNum * (blockid % 2) + i;
-					// printf("block 2 index:[%d]",index);
-				} 
-				else {
-					point_index = (u16Azimuth) / m_iAngleSize * m_iLaserNum + i;
-				}
-				if(m_OutMsgArray[cursor]->points[point_index].ring == 0){
-					m_OutMsgArray[cursor]->points[point_index] = point;
-				}
-				else{
-					pthread_mutex_lock(&m_RedundantPointLock);
-					m_RedundantPointBuffer.push_back(RedundantPoint{point_index, point});
-					pthread_mutex_unlock(&m_RedundantPointLock);
-				}
+			if(CoordinateCorrection){
+				pitch += calibration.laserOffset.getPitchOffset(m_sFrameId, pitch, distance);
+			}
+			int pitchIdx = static_cast<int>(pitch * 100 + 0.5);
+			if (pitchIdx  >= CIRCLE) {
+				pitchIdx  -= CIRCLE;
+			} else if (pitchIdx  < 0) {
+				pitchIdx  += CIRCLE;
+			}
+			float xyDistance = distance * m_fCosAllAngle[pitchIdx];
+			if(CoordinateCorrection){
+				azimuth += calibration.laserOffset.getAzimuthOffset(m_sFrameId, originAzimuth, blockAzimuth, xyDistance);
+			}
+			int azimuthIdx = static_cast<int>(azimuth * 100 + 0.5);
+			if(azimuthIdx >= CIRCLE) {
+				azimuthIdx -= CIRCLE;
+			}
+			else if(azimuthIdx < 0) {
+				azimuthIdx += CIRCLE;
+			}
+			if(m_bFilterFlag && !m_vecAzimuthKeep[azimuthIdx]) {
+				continue;
+			}
+			point.x = xyDistance * m_fSinAllAngle[azimuthIdx];
+			point.y = xyDistance * m_fCosAllAngle[azimuthIdx];
+			point.z = distance * m_fSinAllAngle[pitchIdx];
+			if(blockTransform) {
+				transformPoint(point, blockMatrix);
+			}
+			if(m_bCropBoxFlag && isPointCropped(point)) {
+				continue;
+			}
+			point.intensity = u8Intensity;
+			point.timestamp = blockTime + offset / 1000000000.0;
+			if(0 == minTimestamp || minTimestamp > point.timestamp) {
+				minTimestamp = point.timestamp;
+			}
+			point.ring = i + 1;
+			if(m_bVoxelFlag && 0 != u16Distance) {  // no return, nothing to keep in a voxel
+				m_objVoxelGrid.insert(voxelPartition, point);
+			}
+			storePoint(cursor, blockIndex + i, point);
+			if(DualReturn && !(blockid & 1)) {
+				firstKept[i] = true;
 			}
 		}
 	}
+	updateFrameTimestamp(minTimestamp);
 }
 
-void PandarSwiftSDK::calcQT128PointXYZIT(PandarPacket &pkt, int cursor) {
-
+/**
+ * One packet of UDP 3.x (QT128), specialized as calcPandar128Points. The
+ * QT128 has no coordinate correction and stamps all blocks with the packet time.
+ */
+template <int LaserNum, bool Confidence, bool DualReturn>
+void PandarSwiftSDK::calcQT128Points(PandarPacket &pkt, int cursor) {
 	auto header = (PandarQT128Head*)(&pkt.data[0]);
-	auto tail = (PandarQT128Tail*)(&pkt.data[0] + PANDAR128_HEAD_SIZE + 
-				(header->hasConfidence() ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE * header->u8LaserNum * header->u8BlockNum : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE * header->u8LaserNum * header->u8BlockNum) + 
-				PANDAR128_AZIMUTH_SIZE * header->u8BlockNum + 
-				PANDAR128_CRC_SIZE + 
+	if (pkt.data[0] != 0xEE && pkt.data[1] != 0xFF) {
+		return;
+	}
+	if(3 != header->u8VersionMajor || (0 != LaserNum && LaserNum != header->u8LaserNum) || Confidence != header->hasConfidence()) {
+		calcPointXYZIT(pkt, cursor);
+		return;
+	}
+	CalibrationTable &calibration = *m_spCalibration;
+	int voxelPartition = m_bVoxelFlag ? getVoxelPartition() : 0;
+	const int laserNum = 0 != LaserNum ? LaserNum : header->u8LaserNum;
+	const int unitSize = Confidence ? PANDAR128_UNIT_WITH_CONFIDENCE_SIZE : PANDAR128_UNIT_WITHOUT_CONFIDENCE_SIZE;
+	auto tail = (PandarQT128Tail*)(&pkt.data[0] + PANDAR128_HEAD_SIZE +
+				unitSize * laserNum * header->u8BlockNum +
+				PANDAR128_AZIMUTH_SIZE * header->u8BlockNum +
+				PANDAR128_CRC_SIZE +
 				(header->hasFunctionSafety()? PANDAR128_FUNCTION_SAFETY_SIZE : 0));
-  if (pkt.data[0] != 0xEE && pkt.data[1] != 0xFF) {    
-    return ;
-  }
-
-	struct tm t = {0};
-	t.tm_year = tail->nUTCTime[0];
-	t.tm_mon = tail->nUTCTime[1] - 1;
-	t.tm_mday = tail->nUTCTime[2];
-	t.tm_hour = tail->nUTCTime[3];
-	t.tm_min = tail->nUTCTime[4];
-	t.tm_sec = tail->nUTCTime[5];
-	t.tm_isdst = 0;
-	double unix_second = static_cast<double>(mktime(&t) + m_iTimeZoneSecond);
-	int index = 0;
-	index += PANDAR128_HEAD_SIZE;
+	double packetTime = utcToUnixSecond(tail->nUTCTime) + m_iTimeZoneSecond + static_cast<double>(tail->nTimestamp) / 1000000.0;
+	const float offsetSign = m_bClockwise ? 1.0f : -1.0f;
+	uint16_t motorSpeed = tail->nMotorSpeed;
+	float blockMatrix[12];
+	bool blockTransform = getBlockTransform(packetTime, blockMatrix);
+	const int blockStride = PANDAR128_AZIMUTH_SIZE + unitSize * laserNum;
+	double minTimestamp = 0;
+	bool firstKept[PANDAR128_LASER_NUM];  // units of the first return stored in the cloud
 	for (int blockid = 0; blockid < header->u8BlockNum; blockid++) {
+		const uint8_t *block = &pkt.data[0] + PANDAR128_HEAD_SIZE + blockid * blockStride;
 		bool firetimeCorrectionMode = (blockid % 2 == 0) ? (tail->nReserved2[2] & 1) : (tail->nReserved2[2] & 2);
-		uint16_t u16Azimuth = *(uint16_t*)(&pkt.data[0] + index);
-		index += PANDAR128_AZIMUTH_SIZE;
-		int mode = tail->nShutdownFlag & 0x03;
-		int state = 0;
-		if(0 == blockid)
-			state = (tail->nShutdownFlag & 0xC0) >> 6;
-		if(1 == blockid)
-			state = (tail->nShutdownFlag & 0x30) >> 4;
-		for (int i = 0; i < header->u8LaserNum; i++) {
+		uint16_t u16Azimuth = *(uint16_t*)block;
+		const uint8_t *unit = block + PANDAR128_AZIMUTH_SIZE;
+		int blockIndex = DualReturn ? u16Azimuth / m_iAngleSize * m_iLaserNum * LIDAR_RETURN_BLOCK_SIZE_2 + m_iLaserNum * (blockid % 2) :
+									u16Azimuth / m_iAngleSize * m_iLaserNum;
+		float blockAzimuth = u16Azimuth / 100.0f;
+		if(DualReturn && !(blockid & 1)) {
+			memset(firstKept, 0, sizeof(firstKept));
+		}
+		for (int i = 0; i < laserNum; i++, unit += unitSize) {
 			/* for all the units in a block */
-			uint16_t u16Distance = *(uint16_t*)(&pkt.data[0] + index);
-			index += DISTANCE_SIZE;
-			uint8_t u8Intensity = *(uint8_t*)(&pkt.data[0] + index);
-			index += INTENSITY_SIZE;
-			index += header->hasConfidence() ? CONFIDENCE_SIZE : 0;
+			uint16_t u16Distance = *(uint16_t*)unit;
+			uint8_t u8Intensity = unit[DISTANCE_SIZE];
 			PPoint point;
 			float distance =static_cast<float>(u16Distance) * PANDAR128_DISTANCE_UNIT;
-			/* filter distance */
-			// if(distance < 0.1) {
-			// 	continue;
-			// }
-			float azimuth = m_fHorizatalAzimuth[i] + (u16Azimuth / 100.0f);
+			/* filter distance, intensity and ring */
+			if(isPointRejected(distance, u8Intensity, i)) {
+				continue;
+			}
+			if(DualReturn && (blockid & 1) && m_bDualReturnDedupe && 0 != u16Distance && firstKept[i] &&
+					u16Distance == *(const uint16_t*)(unit - blockStride)) {
+				m_objDualReturnSplitter.markDuplicate(u16Azimuth / m_iAngleSize * m_iLaserNum + i);
+				continue;
+			}
+			if(m_bBackgroundFlag && isBackgroundPoint(u16Azimuth, i, distance, !(DualReturn && (blockid & 1)))) {
+				continue;
+			}
+			float azimuth = calibration.horizatalAzimuth[i] + blockAzimuth;
 			float originAzimuth = azimuth;
-			float pitch = m_fElevAngle[i];
-			float originPitch = pitch;
-			float offset = m_bClockwise ? m_objLaserOffset.getTSOffset(i, firetimeCorrectionMode, state, distance, m_u8UdpVersionMajor) : - m_objLaserOffset.getTSOffset(i, firetimeCorrectionMode, state, distance, m_u8UdpVersionMajor);
-			azimuth += m_objLaserOffset.getAngleOffset(offset, tail->nMotorSpeed, m_u8UdpVersionMajor);
-#ifdef FIRETIME_CORRECTION_CHECK 
-        printf("Laser ID = %d, speed = %d, correction mode = %d, block id = %d, origin azimuth = %f, azimuth = %f, delt = %f\n", i + 1, tail->nMotorSpeed, firetimeCorrectionMode, blockid, originAzimuth, azimuth, azimuth - originAzimuth);   
+			float pitch = calibration.elevAngle[i];
+			float offset = offsetSign * calibration.laserOffset.getTSOffset(i, firetimeCorrectionMode, 0, distance, 3);
+			azimuth += calibration.laserOffset.getAngleOffset(offset, motorSpeed, 3);
+#ifdef FIRETIME_CORRECTION_CHECK
+        printf("Laser ID = %d, speed = %d, correction mode = %d, block id = %d, origin azimuth = %f, azimuth = %f, delt = %f\n", i + 1, motorSpeed, firetimeCorrectionMode, blockid, originAzimuth, azimuth, azimuth - originAzimuth);
 #endif
 			int pitchIdx = static_cast<int>(pitch * 100 + 0.5);
 			if (pitchIdx  >= CIRCLE) {
@@ -1029,45 +1783,40 @@ void PandarSwiftSDK::calcQT128PointXYZIT(PandarPacket &pkt, int cursor) {
 			int azimuthIdx = static_cast<int>(azimuth * 100 + 0.5);
 			if(azimuthIdx >= CIRCLE) {
 				azimuthIdx -= CIRCLE;
-			} 
+			}
 			else if(azimuthIdx < 0) {
 				azimuthIdx += CIRCLE;
 			}
+			if(m_bFilterFlag && !m_vecAzimuthKeep[azimuthIdx]) {
+				continue;
+			}
 			point.x = xyDistance * m_fSinAllAngle[azimuthIdx];
 			point.y = xyDistance * m_fCosAllAngle[azimuthIdx];
 			point.z = distance * m_fSinAllAngle[pitchIdx];
-			point.intensity = u8Intensity;
-			point.timestamp = unix_second + (static_cast<double>(tail->nTimestamp)) / 1000000.0;
-			if(0 == m_dTimestamp) {
-				m_dTimestamp = point.timestamp;
+			if(blockTransform) {
+				transformPoint(point, blockMatrix);
 			}
-			else if(m_dTimestamp > point.timestamp) {
-				m_dTimestamp = point.timestamp;
+			if(m_bCropBoxFlag && isPointCropped(point)) {
+				continue;
 			}
+			point.intensity = u8Intensity;
+			point.timestamp = packetTime;
+			minTimestamp = packetTime;
 			point.ring = i + 1;
-			int point_index;
-			if(LIDAR_RETURN_BLOCK_SIZE_2 == m_iReturnBlockSize) {
-				point_index = (u16Azimuth) / m_iAngleSize * m_iLaserNum * m_iReturnBlockSize + m_iLaserNum * (blockid % 2) + i;
-				// printf("block 2 index:[%d]",index);
-			} 
-			else {
-				point_index = (u16Azimuth) / m_iAngleSize * m_iLaserNum + i;
+			if(m_bVoxelFlag && 0 != u16Distance) {  // no return, nothing to keep in a voxel
+				m_objVoxelGrid.insert(voxelPartition, point);
 			}
-			if(m_OutMsgArray[cursor]->points[point_index].ring == 0){
-				m_OutMsgArray[cursor]->points[point_index] = point;
-			}
-			else{
-				pthread_mutex_lock(&m_RedundantPointLock);
-				m_RedundantPointBuffer.push_back(RedundantPoint{point_index, point});
-				pthread_mutex_unlock(&m_RedundantPointLock);
+			storePoint(cursor, blockIndex + i, point);
+			if(DualReturn && !(blockid & 1)) {
+				firstKept[i] = true;
 			}
 		}
 	}
-	
+	updateFrameTimestamp(minTimestamp);
 }
 
 void PandarSwiftSDK::loadOffsetFile(std::string file) {
-	m_objLaserOffset.setFilePath(file);
+	m_spCalibration->laserOffset.setFilePath(file);
 }
 
 void PandarSwiftSDK::processGps(PandarGPS *gpsMsg) {
@@ -1113,8 +1862,8 @@ void PandarSwiftSDK::SetEnvironmentVariableTZ(){
 }
 
 bool PandarSwiftSDK::isNeedPublish(){
-  uint16_t beginAzimuth = *(uint16_t*)(&(m_PacketsBuffer.getTaskBegin()->data[0]) + m_iFirstAzimuthIndex);
-  uint16_t endAzimuth = *(uint16_t*)(&((m_PacketsBuffer.getTaskEnd() - 1)->data[0]) + m_iLastAzimuthIndex);
+  uint16_t beginAzimuth = m_PacketsBuffer.getFirstAzimuth(m_PacketsBuffer.getTaskBegin());
+  uint16_t endAzimuth = m_PacketsBuffer.getLastAzimuth(m_PacketsBuffer.getTaskEnd() - 1);
   if(((m_bClockwise == true) &&
 	((beginAzimuth > endAzimuth) && (((CIRCLE_ANGLE - m_iLidarRotationStartAngle > CIRCLE_ANGLE / 2) && (m_iLidarRotationStartAngle <= endAzimuth)) || 
     ((CIRCLE_ANGLE - m_iLidarRotationStartAngle < CIRCLE_ANGLE / 2) && (m_iLidarRotationStartAngle > beginAzimuth))) ||
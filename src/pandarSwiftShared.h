@@ -0,0 +1,35 @@
+/* -*- mode: C++ -*- */
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+
+    Tables and the executor the SDK's translation units share, not part of
+    the public API.
+*/
+
+#ifndef _PANDAR_SWIFT_SHARED_H_
+#define _PANDAR_SWIFT_SHARED_H_ 1
+
+#include "pandarSwiftSDK.h"
+
+// cos/sin of every 0.01 degree, read-only after creation and shared by all instances
+struct AllAngleTable {
+  float cosAllAngle[CIRCLE];
+  float sinAllAngle[CIRCLE];
+  AllAngleTable();
+};
+// the decoders and FrameDecoder build xyz from the same table
+const AllAngleTable &allAngleTable();
+
+namespace tf {
+class Executor;
+}
+// the decode executor shared by all instances, FrameDecoder runs on it too
+tf::Executor &sharedExecutor();
+
+#endif  // _PANDAR_SWIFT_SHARED_H_
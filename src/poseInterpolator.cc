@@ -0,0 +1,148 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   PoseInterpolator: constant twist or interpolated poses for deskewing
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "poseInterpolator.h"
+
+static void quaternionToRotation(float qw, float qx, float qy, float qz, float *r) {
+	r[0] = 1 - 2 * (qy * qy + qz * qz);
+	r[1] = 2 * (qx * qy - qw * qz);
+	r[2] = 2 * (qx * qz + qw * qy);
+	r[3] = 2 * (qx * qy + qw * qz);
+	r[4] = 1 - 2 * (qx * qx + qz * qz);
+	r[5] = 2 * (qy * qz - qw * qx);
+	r[6] = 2 * (qx * qz - qw * qy);
+	r[7] = 2 * (qy * qz + qw * qx);
+	r[8] = 1 - 2 * (qx * qx + qy * qy);
+}
+
+static bool comparePoseTime(const PandarPose &pose, double time) {
+	return pose.timestamp < time;
+}
+
+PoseInterpolator::PoseInterpolator(int capacity) {
+	m_iCapacity = capacity > 2 ? capacity : 2;
+	m_bTwistMode = false;
+	memset(m_fLinear, 0, sizeof(m_fLinear));
+	memset(m_fAngular, 0, sizeof(m_fAngular));
+}
+
+void PoseInterpolator::setTwist(float vx, float vy, float vz, float wx, float wy, float wz) {
+	boost::unique_lock<boost::shared_mutex> lock(m_mtxPoses);
+	m_fLinear[0] = vx;
+	m_fLinear[1] = vy;
+	m_fLinear[2] = vz;
+	m_fAngular[0] = wx;
+	m_fAngular[1] = wy;
+	m_fAngular[2] = wz;
+	m_bTwistMode = true;
+}
+
+void PoseInterpolator::addPose(const PandarPose &pose) {
+	boost::unique_lock<boost::shared_mutex> lock(m_mtxPoses);
+	m_bTwistMode = false;
+	if(!m_dequePoses.empty() && pose.timestamp <= m_dequePoses.back().timestamp) {
+		printf("Pose timestamp is not increasing: %f\n", pose.timestamp);
+		return;
+	}
+	m_dequePoses.push_back(pose);
+	if(m_dequePoses.size() > m_iCapacity) {
+		m_dequePoses.pop_front();
+	}
+}
+
+bool PoseInterpolator::interpolate(double time, float *rotation, float *translation) {
+	if(m_dequePoses.size() < 2 || time < m_dequePoses.front().timestamp || time > m_dequePoses.back().timestamp) {
+		return false;
+	}
+	std::deque<PandarPose>::iterator next = std::lower_bound(m_dequePoses.begin(), m_dequePoses.end(), time, comparePoseTime);
+	if(next == m_dequePoses.begin()) {
+		next++;
+	}
+	const PandarPose &p0 = *(next - 1);
+	const PandarPose &p1 = *next;
+	float t = static_cast<float>((time - p0.timestamp) / (p1.timestamp - p0.timestamp));
+	translation[0] = p0.x + (p1.x - p0.x) * t;
+	translation[1] = p0.y + (p1.y - p0.y) * t;
+	translation[2] = p0.z + (p1.z - p0.z) * t;
+	// slerp, falling back to nlerp for close orientations
+	float dot = p0.qw * p1.qw + p0.qx * p1.qx + p0.qy * p1.qy + p0.qz * p1.qz;
+	float sign = dot < 0 ? -1.0f : 1.0f;
+	dot *= sign;
+	float w0 = 1 - t, w1 = t * sign;
+	if(dot < 0.9995f) {
+		float theta = acosf(dot);
+		float sinTheta = sinf(theta);
+		w0 = sinf((1 - t) * theta) / sinTheta;
+		w1 = sign * sinf(t * theta) / sinTheta;
+	}
+	float qw = w0 * p0.qw + w1 * p1.qw;
+	float qx = w0 * p0.qx + w1 * p1.qx;
+	float qy = w0 * p0.qy + w1 * p1.qy;
+	float qz = w0 * p0.qz + w1 * p1.qz;
+	float norm = sqrtf(qw * qw + qx * qx + qy * qy + qz * qz);
+	quaternionToRotation(qw / norm, qx / norm, qy / norm, qz / norm, rotation);
+	return true;
+}
+
+bool PoseInterpolator::getRelativeTransform(double time, double reftime, float *matrix) {
+	boost::shared_lock<boost::shared_mutex> lock(m_mtxPoses);
+	if(m_bTwistMode) {
+		// exponential map of the body twist over dt
+		float dt = static_cast<float>(time - reftime);
+		float w[3] = {m_fAngular[0] * dt, m_fAngular[1] * dt, m_fAngular[2] * dt};
+		float v[3] = {m_fLinear[0] * dt, m_fLinear[1] * dt, m_fLinear[2] * dt};
+		float theta = sqrtf(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+		float a, b, c;
+		if(theta < 1e-6f) {
+			a = 1.0f;
+			b = 0.5f;
+			c = 1.0f / 6.0f;
+		}
+		else {
+			a = sinf(theta) / theta;
+			b = (1 - cosf(theta)) / (theta * theta);
+			c = (1 - a) / (theta * theta);
+		}
+		float k[9] = {0, -w[2], w[1], w[2], 0, -w[0], -w[1], w[0], 0};
+		float k2[9];
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				k2[i * 3 + j] = k[i * 3] * k[j] + k[i * 3 + 1] * k[3 + j] + k[i * 3 + 2] * k[6 + j];
+			}
+		}
+		for (int i = 0; i < 3; i++) {
+			float translation = 0;
+			for (int j = 0; j < 3; j++) {
+				float identity = i == j ? 1.0f : 0.0f;
+				matrix[i * 4 + j] = identity + a * k[i * 3 + j] + b * k2[i * 3 + j];
+				translation += (identity + b * k[i * 3 + j] + c * k2[i * 3 + j]) * v[j];
+			}
+			matrix[i * 4 + 3] = translation;
+		}
+		return true;
+	}
+	float r0[9], t0[3], r1[9], t1[3];
+	if(!interpolate(time, r1, t1) || !interpolate(reftime, r0, t0)) {
+		return false;
+	}
+	// inverse(T_ref) * T_time
+	float dt[3] = {t1[0] - t0[0], t1[1] - t0[1], t1[2] - t0[2]};
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			matrix[i * 4 + j] = r0[i] * r1[j] + r0[3 + i] * r1[3 + j] + r0[6 + i] * r1[6 + j];
+		}
+		matrix[i * 4 + 3] = r0[i] * dt[0] + r0[3 + i] * dt[1] + r0[6 + i] * dt[2];
+	}
+	return true;
+}
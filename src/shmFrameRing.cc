@@ -0,0 +1,218 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   ShmFrameWriter / ShmFrameReader: frame ring in POSIX shared memory, futex wake-up
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "shmFrameRing.h"
+#include "platUtil.h"
+
+static inline uint64_t alignUp(uint64_t size) {
+	return (size + SHM_RING_ALIGN - 1) / SHM_RING_ALIGN * SHM_RING_ALIGN;
+}
+
+// the ring is shared by processes, the futex must not be private
+static inline int futex(const uint32_t *addr, int op, uint32_t val, const struct timespec *timeout) {
+	return syscall(SYS_futex, const_cast<uint32_t *>(addr), op, val, timeout, NULL, 0);
+}
+
+static inline const ShmSlotHeader *getSlot(const ShmRingHeader *header, uint64_t sequence) {
+	return reinterpret_cast<const ShmSlotHeader *>(reinterpret_cast<const uint8_t *>(header) + sizeof(ShmRingHeader) +
+			(sequence - 1) % header->u32SlotNum * header->u64SlotStride);
+}
+
+ShmFrameWriter::ShmFrameWriter() {
+	m_pHeader = NULL;
+	m_u64Size = 0;
+	m_u64Sequence = 0;
+}
+
+ShmFrameWriter::~ShmFrameWriter() {
+	close();
+}
+
+int ShmFrameWriter::open(std::string name, int slotNum, uint32_t maxPoints, std::string frameId) {
+	if(isOpen() || slotNum < 2 || 0 == maxPoints) {
+		return -1;
+	}
+	uint64_t slotStride = alignUp(sizeof(ShmSlotHeader) + static_cast<uint64_t>(maxPoints) * sizeof(PointXYZIT));
+	size_t size = sizeof(ShmRingHeader) + slotNum * slotStride;
+	shm_unlink(name.c_str());  // readers of an earlier writer keep their mapping
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fd < 0) {
+		printf("shm_open %s failed: %s\n", name.c_str(), strerror(errno));
+		return -1;
+	}
+	if(0 != ftruncate(fd, size)) {
+		printf("ftruncate %s to %zu failed: %s\n", name.c_str(), size, strerror(errno));
+		::close(fd);
+		shm_unlink(name.c_str());
+		return -1;
+	}
+	void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(MAP_FAILED == addr) {
+		printf("mmap %s failed: %s\n", name.c_str(), strerror(errno));
+		shm_unlink(name.c_str());
+		return -1;
+	}
+	ShmRingHeader *header = static_cast<ShmRingHeader *>(addr);
+	header->u32Version = SHM_RING_VERSION;
+	header->u32SlotNum = slotNum;
+	header->u32MaxPoints = maxPoints;
+	header->u32PointSize = sizeof(PointXYZIT);
+	header->u64SlotStride = slotStride;
+	strncpy(header->frameId, frameId.c_str(), SHM_RING_FRAME_ID_SIZE - 1);
+	// a reader takes the ring once the magic is there
+	__atomic_store_n(&header->u32Magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+	m_sName = name;
+	m_pHeader = header;
+	m_u64Size = size;
+	m_u64Sequence = 0;
+	return 0;
+}
+
+void ShmFrameWriter::close() {
+	if(!isOpen()) {
+		return;
+	}
+	// a waiting reader returns, one about to wait sees the futex word changed
+	__atomic_store_n(&m_pHeader->u32Closed, 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&m_pHeader->u32Futex, 1, __ATOMIC_RELEASE);
+	futex(&m_pHeader->u32Futex, FUTEX_WAKE, INT_MAX, NULL);
+	munmap(m_pHeader, m_u64Size);
+	shm_unlink(m_sName.c_str());
+	m_pHeader = NULL;
+	m_u64Size = 0;
+}
+
+int ShmFrameWriter::publish(const pcl::PointCloud<PointXYZIT> &cloud, double timestamp) {
+	if(!isOpen() || cloud.points.size() > m_pHeader->u32MaxPoints) {
+		return -1;
+	}
+	uint64_t sequence = ++m_u64Sequence;
+	ShmSlotHeader *slot = const_cast<ShmSlotHeader *>(getSlot(m_pHeader, sequence));
+	__atomic_store_n(&slot->u64Sequence, 2 * sequence - 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->dTimestamp = timestamp;
+	slot->u32Width = cloud.width;
+	slot->u32Height = cloud.height;
+	slot->u32PointNum = cloud.points.size();
+	memcpy(reinterpret_cast<uint8_t *>(slot) + sizeof(ShmSlotHeader), cloud.points.data(), cloud.points.size() * sizeof(PointXYZIT));
+	__atomic_store_n(&slot->u64Sequence, 2 * sequence, __ATOMIC_RELEASE);
+	__atomic_store_n(&m_pHeader->u64Latest, sequence, __ATOMIC_RELEASE);
+	__atomic_store_n(&m_pHeader->u32Futex, static_cast<uint32_t>(sequence), __ATOMIC_RELEASE);
+	futex(&m_pHeader->u32Futex, FUTEX_WAKE, INT_MAX, NULL);
+	return 0;
+}
+
+ShmFrameReader::ShmFrameReader() {
+	m_pHeader = NULL;
+	m_u64Size = 0;
+}
+
+ShmFrameReader::~ShmFrameReader() {
+	close();
+}
+
+int ShmFrameReader::open(std::string name) {
+	if(NULL != m_pHeader) {
+		return -1;
+	}
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if(fd < 0) {
+		return -1;
+	}
+	struct stat st;
+	if(0 != fstat(fd, &st) || st.st_size < static_cast<off_t>(sizeof(ShmRingHeader))) {
+		::close(fd);
+		return -1;
+	}
+	void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(MAP_FAILED == addr) {
+		return -1;
+	}
+	const ShmRingHeader *header = static_cast<const ShmRingHeader *>(addr);
+	if(SHM_RING_MAGIC != __atomic_load_n(&header->u32Magic, __ATOMIC_ACQUIRE) || SHM_RING_VERSION != header->u32Version ||
+			sizeof(PointXYZIT) != header->u32PointSize || 0 == header->u32SlotNum ||
+			static_cast<uint64_t>(st.st_size) < sizeof(ShmRingHeader) + header->u32SlotNum * header->u64SlotStride) {
+		printf("%s is not a frame ring of this SDK\n", name.c_str());
+		munmap(addr, st.st_size);
+		return -1;
+	}
+	m_pHeader = header;
+	m_u64Size = st.st_size;
+	return 0;
+}
+
+void ShmFrameReader::close() {
+	if(NULL == m_pHeader) {
+		return;
+	}
+	munmap(const_cast<ShmRingHeader *>(m_pHeader), m_u64Size);
+	m_pHeader = NULL;
+	m_u64Size = 0;
+}
+
+int ShmFrameReader::waitFrame(uint64_t lastSequence, ShmFrame &frame, int timeoutms) {
+	if(NULL == m_pHeader) {
+		return -1;
+	}
+	uint64_t deadline = GetMicroTickCountU64() + static_cast<uint64_t>(timeoutms) * 1000;
+	while (1) {
+		uint32_t futexValue = __atomic_load_n(&m_pHeader->u32Futex, __ATOMIC_ACQUIRE);
+		uint64_t latest = __atomic_load_n(&m_pHeader->u64Latest, __ATOMIC_ACQUIRE);
+		if(latest > lastSequence) {
+			const ShmSlotHeader *slot = getSlot(m_pHeader, latest);
+			if(2 * latest == __atomic_load_n(&slot->u64Sequence, __ATOMIC_ACQUIRE)) {
+				frame.u64Sequence = latest;
+				frame.dTimestamp = slot->dTimestamp;
+				frame.u32Width = slot->u32Width;
+				frame.u32Height = slot->u32Height;
+				frame.u32PointNum = slot->u32PointNum;
+				frame.points = reinterpret_cast<const PointXYZIT *>(reinterpret_cast<const uint8_t *>(slot) + sizeof(ShmSlotHeader));
+				frame.slot = slot;
+				if(isValid(frame)) {
+					return 0;
+				}
+			}
+			sched_yield();  // the slot is being reused, a newer frame is coming
+			continue;
+		}
+		if(__atomic_load_n(&m_pHeader->u32Closed, __ATOMIC_ACQUIRE)) {
+			return -1;
+		}
+		uint64_t now = GetMicroTickCountU64();
+		if(now >= deadline) {
+			return -1;
+		}
+		struct timespec timeout;
+		timeout.tv_sec = (deadline - now) / 1000000;
+		timeout.tv_nsec = (deadline - now) % 1000000 * 1000;
+		futex(&m_pHeader->u32Futex, FUTEX_WAIT, futexValue, &timeout);
+	}
+}
+
+bool ShmFrameReader::isValid(const ShmFrame &frame) {
+	if(NULL == frame.slot) {
+		return false;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return 2 * frame.u64Sequence == __atomic_load_n(&frame.slot->u64Sequence, __ATOMIC_RELAXED);
+}
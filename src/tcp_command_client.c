@@ -18,6 +18,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <pthread.h>
 #include <setjmp.h>
 #include <signal.h>
@@ -37,9 +38,16 @@
 #include "util.h"
 #include "tcp_command_client.h"
 
+typedef struct TcpCommandRequest_s {
+  TC_Command cmd;
+  TcpCommandCallback callback;
+  void* userdata;
+  struct TcpCommandRequest_s* next;
+} TcpCommandRequest;
+
 typedef struct TcpCommandClient_s {
-  pthread_mutex_t lock;
-  pthread_t tid;
+  pthread_mutex_t lock;  // the connection, one command exchange at a time
+  pthread_t tid;         // async worker, started by the first TcpCommandSendAsync
 
   int exit;
 
@@ -47,6 +55,14 @@ typedef struct TcpCommandClient_s {
   unsigned short port;
 
   int fd;
+  SSL_CTX* ctx;
+  SSL* ssl;
+
+  pthread_mutex_t queue_lock;
+  pthread_cond_t queue_cond;
+  TcpCommandRequest* queue_head;
+  TcpCommandRequest* queue_tail;
+  int worker_started;
 } TcpCommandClient;
 
 char *certFile;
@@ -77,98 +93,6 @@ static int tcpCommandHeaderParser(unsigned char* buffer, int len,
   return 0;
 }
 
-static int tcpCommandReadCommand(int connfd, TC_Command* cmd) {
-  int ret = 0;
-  if (!cmd) {
-    return -1;
-  }
-  memset(cmd, 0, sizeof(TC_Command));
-  unsigned char buffer[1500];
-  ret = sys_readn(connfd, buffer, 2);
-  if (ret <= 0 || buffer[0] != 0x47 || buffer[1] != 0x74) {
-    printf("Server Read failed\n");
-    return -1;
-  }
-
-  ret = sys_readn(connfd, buffer + 2, 6);
-  if (ret != 6) {
-    printf("Server Read failed\n");
-    return -1;
-  }
-
-  print_mem(buffer, 8);
-
-  tcpCommandHeaderParser(buffer + 2, 6, &cmd->header);
-
-  if (cmd->header.len > 0) {
-    cmd->data = malloc(cmd->header.len);
-    if (!cmd->data) {
-      printf("malloc data error\n");
-      return -1;
-    }
-  }
-
-  ret = sys_readn(connfd, cmd->data, cmd->header.len);
-  if (ret != cmd->header.len) {
-    free(cmd->data);
-    printf("Server Read failed\n");
-    return -1;
-  }
-
-  // cmd->ret_size = cmd->header.len;
-
-  print_mem(cmd->data, cmd->header.len);
-
-  return 0;
-}
-
-static int tcpCommandReadCommandBySSL(SSL *ssl, TC_Command* cmd) {
-	int ret = 0;
-	if(!cmd) {
-		return -1;
-	}
-	memset(cmd , 0 , sizeof(TC_Command));
-	unsigned char buffer [1500];
-  printf("reading data....\n");
-	ret = sys_readn_by_ssl(ssl, buffer , 2);
-	if(ret <= 0 || buffer[0] != 0x47 || buffer [1] != 0x74) {
-    printf("ret: %d, buffer[0]: %x,buffer[1]: %x\n",ret, buffer[0], buffer[1]);
-		printf("Server Read failed by ssl!!!\n");
-		return -1;
-	}
-
-	ret = sys_readn_by_ssl(ssl, buffer + 2 , 6);
-	if(ret != 6) {
-		printf("Server Read failed by ssl\n");
-		return -1;
-	}
-	
-	// printf("read response header size = 8:\n");
-	print_mem(buffer , 8);
-	tcpCommandHeaderParser(buffer + 2 , 6 , &cmd->header);
-
-	if(cmd->header.len > 0) {
-		cmd->data = malloc(cmd->header.len + 1);
-		if(!cmd->data) {
-			printf("malloc data error\n");
-			return -1;
-		}
-		memset(cmd->data, 0, cmd->header.len + 1);
-	}
-
-	ret = sys_readn_by_ssl(ssl, cmd->data , cmd->header.len);
-	if(ret != cmd->header.len) {
-		free(cmd->data);
-		printf("Server Read failed by ssl\n");
-		return -1;
-	}
-	printf("read response data size = %d:\n", cmd->header.len);
-	print_mem(cmd->data , cmd->header.len);
-	cmd->ret_data = cmd->data;
-	cmd->ret_size = cmd->header.len;
-	return 0;
-}
-
 static int TcpCommand_buildHeader(char* buffer, TC_Command* cmd) {
   if (!buffer) {
     return -1;
@@ -186,180 +110,329 @@ static int TcpCommand_buildHeader(char* buffer, TC_Command* cmd) {
   return index;
 }
 
-static PTC_ErrCode tcpCommandClientSendCmdWithoutSecurity(TcpCommandClient* client,
-                                            TC_Command* cmd) {
-  if (!client && !cmd) {
-    printf("Bad Parameter\n");
-    return PTC_ERROR_BAD_PARAMETER;
+static void tcpCommandClientClose(TcpCommandClient* client) {
+  if (client->ssl) {
+    SSL_shutdown(client->ssl);
+    SSL_free(client->ssl);
+    client->ssl = NULL;
+  }
+  if (client->fd >= 0) {
+    close(client->fd);
+    client->fd = -1;
   }
+}
+
+// a connection the sensor closed while idle reads as end of file without blocking
+static int tcpCommandClientIsAlive(TcpCommandClient* client) {
+  char c;
+  int ret = recv(client->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return ret > 0 || (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+}
 
-  if (cmd->header.len != 0 && cmd->data == NULL) {
-    printf("Bad Parameter : payload is null\n");
+// called with client->lock held, an open connection is kept as it is
+static PTC_ErrCode tcpCommandClientOpen(TcpCommandClient* client) {
+  if (client->fd >= 0) {
+    return PTC_ERROR_NO_ERROR;
+  }
+  if (CERTIFY_MODE_ERROR == sslFlag) {
+    printf("No CA file found, please check CA file path!\n");
     return PTC_ERROR_BAD_PARAMETER;
   }
-  pthread_mutex_lock(&client->lock);
-
   int fd = tcp_open(client->ip, client->port);
   if (fd < 0) {
-    pthread_mutex_unlock(&client->lock);
-     printf("connect server failed\n");
+    printf("connect server failed\n");
     return PTC_ERROR_CONNECT_SERVER_FAILED;
   }
-  unsigned char buffer[128];
-  int size = TcpCommand_buildHeader(buffer, cmd);
-
-  print_mem(buffer, size);
-  int ret = write(fd, buffer, size);
-  if (ret != size) {
-    close(fd);
-    pthread_mutex_unlock(&client->lock);
-    printf("Write header error\n");
-    return PTC_ERROR_TRANSFER_FAILED;
-  }
-  if (cmd->header.len > 0 && cmd->data) {
-    print_mem(cmd->data, cmd->header.len);
-    ret = write(fd, cmd->data, cmd->header.len);
-    if (ret != cmd->header.len) {
-      printf("Write Payload error\n");
-      close(fd);
-      pthread_mutex_unlock(&client->lock);
-      return PTC_ERROR_TRANSFER_FAILED;
-    }
+  // the connection stays open between commands, keepalive finds a dead sensor
+  int on = 1;
+  int idle = PTC_KEEPALIVE_IDLE_SEC;
+  int interval = PTC_KEEPALIVE_INTERVAL_SEC;
+  int count = PTC_KEEPALIVE_COUNT;
+  struct timeval timeout = {PTC_IO_TIMEOUT_SEC, 0};
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  client->fd = fd;
+  if (CERTIFY_MODE_NONE == sslFlag) {
+    return PTC_ERROR_NO_ERROR;
   }
 
-  TC_Command feedBack;
-  ret = tcpCommandReadCommand(fd, &feedBack);
-  if (ret != 0) {
-    printf("Receive feed back failed!!!\n");
-    close(fd);
-    pthread_mutex_unlock(&client->lock);
-    return PTC_ERROR_TRANSFER_FAILED;
+  // one SSL_CTX per client, the handshake is paid once per connection
+  if (client->ctx == NULL) {
+    client->ctx = initial_client_ssl(certFile, privateKeyFile, caFile);
+    if (client->ctx == NULL) {
+      printf("%s:%d, create SSL_CTX failed\n", __func__, __LINE__);
+      tcpCommandClientClose(client);
+      return PTC_ERROR_CONNECT_SERVER_FAILED;
+    }
+  }
+  client->ssl = SSL_new(client->ctx);
+  if (client->ssl == NULL) {
+    printf("%s:%d, create ssl failed\n", __func__, __LINE__);
+    tcpCommandClientClose(client);
+    return PTC_ERROR_CONNECT_SERVER_FAILED;
+  }
+  SSL_set_fd(client->ssl, fd);
+  if (SSL_connect(client->ssl) <= 0) {
+    printf("%s:%d, connect ssl failed\n", __func__, __LINE__);
+    tcpCommandClientClose(client);
+    return PTC_ERROR_CONNECT_SERVER_FAILED;
+  }
+  if (SSL_get_verify_result(client->ssl) != X509_V_OK) {
+    printf("%s:%d, verify ssl failed\n", __func__, __LINE__);
+    tcpCommandClientClose(client);
+    return PTC_ERROR_CONNECT_SERVER_FAILED;
   }
-  // printf("feed back : %d %d %d \n", feedBack.header.len ,
-  // cmd->header.ret_code,
-  //        cmd->header.cmd);
-
-  cmd->ret_data = feedBack.data;
-  cmd->ret_size = feedBack.header.len;
-  cmd->header.ret_code = feedBack.header.ret_code;
-
-  close(fd);
-  pthread_mutex_unlock(&client->lock);
   return PTC_ERROR_NO_ERROR;
 }
 
-static PTC_ErrCode tcpCommandClientSendCmdWithSecurity(TcpCommandClient *client , TC_Command *cmd) {
-	if(!client || !cmd) {
-		printf("Bad Parameter\n");
-		return PTC_ERROR_BAD_PARAMETER;
-	}
+static int tcpCommandClientWrite(TcpCommandClient* client, const void* buffer, int len) {
+  // a connection the sensor closed raises SIGPIPE on write, take it back instead of dying
+  sigset_t pipeSet;
+  sigset_t oldSet;
+  sigemptyset(&pipeSet);
+  sigaddset(&pipeSet, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+  int ret;
+  if (client->ssl) {
+    ret = SSL_write(client->ssl, buffer, len);
+  } else {
+    ret = sys_writen(client->fd, buffer, len);
+  }
+  if (ret != len) {
+    struct timespec zero = {0, 0};
+    sigtimedwait(&pipeSet, NULL, &zero);
+  }
+  pthread_sigmask(SIG_SETMASK, &oldSet, NULL);
+  return ret == len ? 0 : -1;
+}
 
-	if(cmd->header.len != 0 && cmd->data == NULL) {
-		printf("Bad Parameter : payload is null\n");
-		return PTC_ERROR_BAD_PARAMETER;
-	}
-	pthread_mutex_lock(&client->lock);
-	int err_code = PTC_ERROR_NO_ERROR;
+static int tcpCommandClientRead(TcpCommandClient* client, void* buffer, int len) {
+  int ret = client->ssl ? sys_readn_by_ssl(client->ssl, buffer, len) : sys_readn(client->fd, buffer, len);
+  return ret == len ? 0 : -1;
+}
 
-	SSL_CTX* ctx = initial_client_ssl(certFile, privateKeyFile, caFile);
-	if(ctx == NULL) {
-    printf("%s:%d, create SSL_CTX failed\n", __func__, __LINE__);
-		// ERR_print_errors_fp(stderr);
-		return PTC_ERROR_CONNECT_SERVER_FAILED;
-	}
+static int tcpCommandReadCommand(TcpCommandClient* client, TC_Command* cmd) {
+  unsigned char buffer[8];
+  if (tcpCommandClientRead(client, buffer, 8) != 0 || buffer[0] != 0x47 || buffer[1] != 0x74) {
+    printf("Server Read failed\n");
+    return -1;
+  }
+  print_mem(buffer, 8);
 
-	int fd = tcp_open(client->ip , client->port);
-	if(fd < 0) {
-		printf("Connect to Server Failed!~!~\n");
-		err_code = PTC_ERROR_CONNECT_SERVER_FAILED;
-		goto end;
-	}
+  TcpCommandHeader header;
+  tcpCommandHeaderParser(buffer + 2, 6, &header);
+  if (header.cmd != cmd->header.cmd) {
+    printf("Feed back of command %d for command %d\n", header.cmd, cmd->header.cmd);
+    return -1;
+  }
 
-	SSL *ssl = SSL_new(ctx);
-	if (ssl == NULL) {
-		printf("%s:%d, create ssl failed\n", __func__, __LINE__);
-		err_code = PTC_ERROR_CONNECT_SERVER_FAILED;
-		goto end;
-	}
+  unsigned char* data = NULL;
+  if (header.len > 0) {
+    data = malloc(header.len + 1);
+    if (!data) {
+      printf("malloc data error\n");
+      return -1;
+    }
+    data[header.len] = '\0';
+    if (tcpCommandClientRead(client, data, header.len) != 0) {
+      free(data);
+      printf("Server Read failed\n");
+      return -1;
+    }
+    print_mem(data, header.len);
+  }
 
-	SSL_set_fd(ssl, fd);
-	if(SSL_connect(ssl) == 0) {
-		printf("%s:%d, connect ssl failed\n", __func__, __LINE__);
-		// ERR_print_errors_fp(stderr);
-		err_code = PTC_ERROR_CONNECT_SERVER_FAILED;
-		goto end;
-	}
+  cmd->ret_data = data;
+  cmd->ret_size = header.len;
+  cmd->header.ret_code = header.ret_code;
+  return 0;
+}
 
-	if(SSL_get_verify_result(ssl) != X509_V_OK) {
-		printf("%s:%d, verify ssl failed\n", __func__, __LINE__);
-		// ERR_print_errors_fp(stderr);
-		err_code = PTC_ERROR_CONNECT_SERVER_FAILED;
-		goto end;
-	}
+// all requests are written before the first feed back is read, the sensor answers in order;
+// returns the index of the first request without feed back, num if all have one. The requests
+// before it ran and hold their ret_data, sent counts the headers written, the sensor may act on
+// a request from then on
+static int tcpCommandClientExchange(TcpCommandClient* client, TC_Command** cmds, int num, int* sent, PTC_ErrCode* errorCode) {
+  for (int i = 0; i < num; i++) {
+    if (cmds[i]->header.len != 0 && cmds[i]->data == NULL) {
+      printf("Bad Parameter : payload is null\n");
+      *errorCode = PTC_ERROR_BAD_PARAMETER;
+      return 0;
+    }
+  }
+  *errorCode = PTC_ERROR_NO_ERROR;
+  int written = 0;
+  for (; written < num; written++) {
+    unsigned char buffer[128];
+    int size = TcpCommand_buildHeader(buffer, cmds[written]);
+    print_mem(buffer, size);
+    if (tcpCommandClientWrite(client, buffer, size) != 0) {
+      printf("Write header error\n");
+      *errorCode = PTC_ERROR_TRANSFER_FAILED;
+      break;
+    }
+    *sent = written + 1;
+    if (cmds[written]->header.len > 0 &&
+        tcpCommandClientWrite(client, cmds[written]->data, cmds[written]->header.len) != 0) {
+      printf("Write Payload error\n");
+      *errorCode = PTC_ERROR_TRANSFER_FAILED;
+      break;
+    }
+  }
+  // the requests written completely may have run, their feed back is still read
+  for (int i = 0; i < written; i++) {
+    if (tcpCommandReadCommand(client, cmds[i]) != 0) {
+      printf("Receive feed back failed!!!\n");
+      *errorCode = PTC_ERROR_TRANSFER_FAILED;
+      return i;
+    }
+  }
+  return written;
+}
 
-	unsigned char buffer[128];
-	int size = TcpCommand_buildHeader(buffer , cmd);
-	// printf("cmd header to tx, size = %d: \n",size);
-	print_mem(buffer , size);
-	int ret = SSL_write(ssl , buffer , size);
-	if(ret != size) {
-		printf("Write header error, ret=%d, size=%d\n", ret, size);
-		err_code = PTC_ERROR_TRANSFER_FAILED;
-		goto end;
-	}
+// returns the index of the first failed request like tcpCommandClientExchange, errorCode is its error
+static int tcpCommandClientTransact(TcpCommandClient* client, TC_Command** cmds, int num, PTC_ErrCode* errorCode) {
+  pthread_mutex_lock(&client->lock);
+  int done = 0;
+  *errorCode = PTC_ERROR_TRANSFER_FAILED;
+  if (client->fd >= 0 && !tcpCommandClientIsAlive(client)) {
+    tcpCommandClientClose(client);
+  }
+  // the sensor may still have closed the connection meanwhile, then the first write fails;
+  // retry once on a new one, but never after a request went out, a command must not run twice
+  for (int attempt = 0; attempt < 2 && *errorCode == PTC_ERROR_TRANSFER_FAILED; attempt++) {
+    int reused = client->fd >= 0;
+    int sent = 0;
+    *errorCode = tcpCommandClientOpen(client);
+    if (*errorCode != PTC_ERROR_NO_ERROR) {
+      break;
+    }
+    done = tcpCommandClientExchange(client, cmds, num, &sent, errorCode);
+    if (*errorCode != PTC_ERROR_NO_ERROR) {
+      tcpCommandClientClose(client);
+      if (!reused || sent) {
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock(&client->lock);
+  return done;
+}
 
-	if(cmd->header.len > 0 && cmd->data) {		
-		printf(" cmd data to tx size = %d: \n", cmd->header.len);
-		print_mem(cmd->data , cmd->header.len);
-		ret = SSL_write(ssl, cmd->data , cmd->header.len);
-		if(ret != cmd->header.len) {
-			printf("Write Payload error\n");
-			err_code = PTC_ERROR_TRANSFER_FAILED;
-			goto end;
-		}
-	}
+static PTC_ErrCode tcpCommandClient_SendCmd(TcpCommandClient *client, TC_Command *cmd) {
+  TC_Command* cmds[1] = {cmd};
+  PTC_ErrCode errorCode;
+  tcpCommandClientTransact(client, cmds, 1, &errorCode);
+  return errorCode;
+}
 
-	TC_Command feedBack;
-	ret = tcpCommandReadCommandBySSL(ssl, &feedBack);
-	if(ret != 0) {
-		printf("Receive feed back failed!!!\n");
-		err_code = PTC_ERROR_TRANSFER_FAILED;
-		goto end;
-	}
-	// printf("feed back : %d %d %d \n", cmd->ret_size , cmd->header.ret_code , cmd->header.cmd);
-
-	cmd->ret_data = feedBack.ret_data;
-	cmd->ret_size = feedBack.ret_size;
-	cmd->header.ret_code = feedBack.header.ret_code;
-	printf("certify finished,close ssl and fd now \n");
-
-	end:
-	if (ssl != NULL) SSL_shutdown(ssl);
-	if (fd > 0) close(fd);
-	if (ctx != NULL) {
-		SSL_CTX_free(ctx);
-		pthread_mutex_unlock(&client->lock);
-	}
-	return err_code;
+static void* tcpCommandClientWorker(void* arg) {
+  TcpCommandClient* client = (TcpCommandClient*)arg;
+  while (1) {
+    pthread_mutex_lock(&client->queue_lock);
+    while (!client->exit && client->queue_head == NULL) {
+      pthread_cond_wait(&client->queue_cond, &client->queue_lock);
+    }
+    TcpCommandRequest* request = client->queue_head;
+    client->queue_head = NULL;
+    client->queue_tail = NULL;
+    int exiting = client->exit;
+    pthread_mutex_unlock(&client->queue_lock);
+    if (request == NULL) {
+      break;
+    }
+
+    // every request queued meanwhile goes out pipelined on the one connection
+    while (request) {
+      TcpCommandRequest* batch[PTC_PIPELINE_DEPTH];
+      TC_Command* cmds[PTC_PIPELINE_DEPTH];
+      int num = 0;
+      while (request && num < PTC_PIPELINE_DEPTH) {
+        batch[num] = request;
+        cmds[num] = &request->cmd;
+        num++;
+        request = request->next;
+      }
+      // the requests before the first failed one got their feed back, it and the rest did not
+      PTC_ErrCode errorCode = PTC_ERROR_TRANSFER_FAILED;
+      int done = exiting ? 0 : tcpCommandClientTransact(client, cmds, num, &errorCode);
+      for (int i = 0; i < num; i++) {
+        TC_Command* cmd = &batch[i]->cmd;
+        if (batch[i]->callback) {
+          if (i < done) {
+            batch[i]->callback(batch[i]->userdata, PTC_ERROR_NO_ERROR, cmd->header.ret_code, cmd->ret_data, cmd->ret_size);
+          } else {
+            batch[i]->callback(batch[i]->userdata, errorCode, 0, NULL, 0);
+          }
+        }
+        if (i < done) {
+          free(cmd->ret_data);
+        }
+        free(cmd->data);
+        free(batch[i]);
+      }
+    }
+  }
+  return NULL;
 }
 
-static PTC_ErrCode tcpCommandClient_SendCmd(TcpCommandClient *client, TC_Command *cmd) {
-  if(CERTIFY_MODE_NONE == sslFlag) {
-    printf("Get data without certification now...\n");
-    return tcpCommandClientSendCmdWithoutSecurity(client, cmd);
+PTC_ErrCode TcpCommandSendAsync(const void* handle, unsigned char command,
+                                const unsigned char* payload, unsigned int len,
+                                TcpCommandCallback callback, void* userdata) {
+  if (!handle || (len > 0 && !payload)) {
+    printf("Bad Parameter!!!\n");
+    return PTC_ERROR_BAD_PARAMETER;
   }
-  if(CERTIFY_MODE_SINGLE == sslFlag) {
-    printf("Get data with single certification now...\n");
-    return tcpCommandClientSendCmdWithSecurity(client, cmd);
+  TcpCommandClient* client = (TcpCommandClient*)handle;
+
+  TcpCommandRequest* request = (TcpCommandRequest*)malloc(sizeof(TcpCommandRequest));
+  if (!request) {
+    return PTC_ERROR_NO_MEMORY;
   }
-  if(CERTIFY_MODE_DUAL == sslFlag) {
-    printf("Get data with dual certification now...\n");
-    return tcpCommandClientSendCmdWithSecurity(client, cmd);
+  memset(request, 0, sizeof(TcpCommandRequest));
+  request->cmd.header.cmd = command;
+  request->cmd.header.len = len;
+  if (len > 0) {
+    request->cmd.data = malloc(len);
+    if (!request->cmd.data) {
+      free(request);
+      return PTC_ERROR_NO_MEMORY;
+    }
+    memcpy(request->cmd.data, payload, len);
   }
-  if(CERTIFY_MODE_ERROR == sslFlag) {
-    printf("No CA file found, please check CA file path!\n");
+  request->callback = callback;
+  request->userdata = userdata;
+
+  pthread_mutex_lock(&client->queue_lock);
+  if (client->exit) {
+    pthread_mutex_unlock(&client->queue_lock);
+    free(request->cmd.data);
+    free(request);
     return PTC_ERROR_BAD_PARAMETER;
   }
+  if (!client->worker_started) {
+    if (pthread_create(&client->tid, NULL, tcpCommandClientWorker, client) != 0) {
+      pthread_mutex_unlock(&client->queue_lock);
+      free(request->cmd.data);
+      free(request);
+      return PTC_ERROR_NO_MEMORY;
+    }
+    client->worker_started = 1;
+  }
+  if (client->queue_tail) {
+    client->queue_tail->next = request;
+  } else {
+    client->queue_head = request;
+  }
+  client->queue_tail = request;
+  pthread_cond_signal(&client->queue_cond);
+  pthread_mutex_unlock(&client->queue_lock);
+  return PTC_ERROR_NO_ERROR;
 }
 
 void* TcpCommandClientNew(const char* ip, const unsigned short port) {
@@ -380,6 +453,8 @@ void* TcpCommandClientNew(const char* ip, const unsigned short port) {
   client->port = port;
 
   pthread_mutex_init(&client->lock, NULL);
+  pthread_mutex_init(&client->queue_lock, NULL);
+  pthread_cond_init(&client->queue_cond, NULL);
 
   printf("TCP Command Client Init Success!!!\n");
   return (void*)client;
@@ -475,6 +550,38 @@ PTC_ErrCode TcpCommandGetLidarCalibration(const void* handle, char** buffer,
   return cmd.header.ret_code;
 }
 
+PTC_ErrCode TcpCommandGetInventoryInfo(const void* handle, char** buffer,
+                                      unsigned int* len) {
+  if (!handle || !buffer || !len) {
+    printf("Bad Parameter!!!\n");
+    return PTC_ERROR_BAD_PARAMETER;
+  }
+  TcpCommandClient* client = (TcpCommandClient*)handle;
+
+  TC_Command cmd;
+  memset(&cmd, 0, sizeof(TC_Command));
+  cmd.header.cmd = PTC_COMMAND_GET_INVENTORY_INFO;
+  cmd.header.len = 0;
+  cmd.data = NULL;
+  PTC_ErrCode errorCode = tcpCommandClient_SendCmd(client, &cmd);
+  if (errorCode != PTC_ERROR_NO_ERROR) {
+    printf("The client failed to send a command by TCP\n");
+    return errorCode;
+  }
+
+  // binary payload, the serial number is its first 18 bytes
+  char* ret_data = (char*)malloc(cmd.ret_size + 1);
+  memcpy(ret_data, cmd.ret_data, cmd.ret_size);
+  ret_data[cmd.ret_size] = '\0';
+
+  free(cmd.ret_data);
+
+  *buffer = ret_data;
+  *len = cmd.ret_size;
+
+  return cmd.header.ret_code;
+}
+
 PTC_ErrCode TcpCommandResetCalibration(const void* handle) {
   if (!handle) {
     printf("Bad Parameter!!!\n");
@@ -501,7 +608,33 @@ PTC_ErrCode TcpCommandResetCalibration(const void* handle) {
   return cmd.header.ret_code;
 }
 
-void TcpCommandClientDestroy(const void* handle) {}
+void TcpCommandClientDestroy(const void* handle) {
+  if (!handle) {
+    return;
+  }
+  TcpCommandClient* client = (TcpCommandClient*)handle;
+
+  // queued async requests are answered with PTC_ERROR_TRANSFER_FAILED
+  pthread_mutex_lock(&client->queue_lock);
+  client->exit = 1;
+  int started = client->worker_started;
+  pthread_cond_signal(&client->queue_cond);
+  pthread_mutex_unlock(&client->queue_lock);
+  if (started) {
+    pthread_join(client->tid, NULL);
+  }
+
+  pthread_mutex_lock(&client->lock);
+  tcpCommandClientClose(client);
+  if (client->ctx) {
+    SSL_CTX_free(client->ctx);
+  }
+  pthread_mutex_unlock(&client->lock);
+  pthread_mutex_destroy(&client->lock);
+  pthread_mutex_destroy(&client->queue_lock);
+  pthread_cond_destroy(&client->queue_cond);
+  free(client);
+}
 
 void TcpCommandSetSsl(const char* cert, const char* private_key, const char* ca) {
   int len;
@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   TraceRecorder: per-thread span rings and Chrome trace export
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "traceRecorder.h"
+
+TraceRecorder &TraceRecorder::instance() {
+	static TraceRecorder recorder;
+	return recorder;
+}
+
+TraceRecorder::TraceRecorder() {
+	m_bEnabled = false;
+}
+
+void TraceRecorder::enable(bool enabled) {
+	m_bEnabled.store(enabled, boost::memory_order_relaxed);
+}
+
+TraceRecorder::TraceRing *TraceRecorder::getThreadRing() {
+	static thread_local TraceRing *ring = NULL;
+	if(NULL == ring) {
+		ring = new TraceRing;
+		ring->u32Tid = static_cast<uint32_t>(syscall(SYS_gettid));
+		ring->u64Head = 0;
+		boost::mutex::scoped_lock lock(m_mutexRings);
+		m_vecRings.push_back(ring);
+	}
+	return ring;
+}
+
+void TraceRecorder::record(const char *name, uint64_t beginus, uint64_t endus, uint32_t arg) {
+	TraceRing *ring = getThreadRing();
+	uint64_t head = ring->u64Head.load(boost::memory_order_relaxed);
+	TraceSpan &span = ring->arrSpans[head & (TRACE_RING_SIZE - 1)];
+	span.name = name;
+	span.u64BeginUs = beginus;
+	span.u64EndUs = endus;
+	span.u32Arg = arg;
+	ring->u64Head.store(head + 1, boost::memory_order_release);
+}
+
+int TraceRecorder::dump(std::string filename, double windowsec) {
+	FILE *fp = fopen(filename.c_str(), "w");
+	if(NULL == fp) {
+		printf("Open trace file %s failed\n", filename.c_str());
+		return -1;
+	}
+	std::vector<TraceRing *> rings;
+	{
+		boost::mutex::scoped_lock lock(m_mutexRings);
+		rings = m_vecRings;
+	}
+	uint64_t now = GetMicroTickCountU64();
+	uint64_t from = windowsec > 0 && now > windowsec * 1000000 ? now - static_cast<uint64_t>(windowsec * 1000000) : 0;
+	int pid = getpid();
+	int count = 0;
+	std::vector<TraceSpan> spans;
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (int r = 0; r < rings.size(); r++) {
+		uint64_t head = rings[r]->u64Head.load(boost::memory_order_acquire);
+		uint64_t tail = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+		spans.clear();
+		for (uint64_t i = tail; i < head; i++) {
+			spans.push_back(rings[r]->arrSpans[i & (TRACE_RING_SIZE - 1)]);
+		}
+		// the writer kept going while copying, drop the slots it may have overwritten
+		// and the one at newHead, which it may be filling right now
+		uint64_t newHead = rings[r]->u64Head.load(boost::memory_order_acquire);
+		uint64_t valid = newHead + 1 > TRACE_RING_SIZE ? newHead + 1 - TRACE_RING_SIZE : 0;
+		size_t skip = valid > tail ? valid - tail : 0;
+		for (size_t i = skip; i < spans.size(); i++) {
+			if(spans[i].u64EndUs < from) {
+				continue;
+			}
+			fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"pandar\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%lu,\"dur\":%lu,\"args\":{\"arg\":%u}}",
+					count > 0 ? "," : "", spans[i].name, pid, rings[r]->u32Tid, spans[i].u64BeginUs,
+					spans[i].u64EndUs - spans[i].u64BeginUs, spans[i].u32Arg);
+			count++;
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return count;
+}
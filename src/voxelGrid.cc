@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2020 Hesai Photonics Technology, Lingwen Fang
+ *  License: Modified BSD Software License Agreement
+ *
+ *  $Id$
+ */
+
+/** @file
+ *   VoxelGrid: per-worker hashed voxel maps merged at frame end
+ */
+#include <algorithm>
+#include "voxelGrid.h"
+
+VoxelGrid::VoxelGrid() {
+	m_fInverseLeaf = 0;
+	m_bCentroid = true;
+}
+
+void VoxelGrid::setup(const VoxelGridConfig &config, int partitions) {
+	m_fInverseLeaf = config.leafSize > 0 ? 1.0f / config.leafSize : 0;
+	m_bCentroid = config.mode != VOXEL_MODE_FIRST;
+	m_vecPartitions.clear();
+	m_vecPartitions.resize(partitions);
+}
+
+void VoxelGrid::grow(Partition &partition) {
+	int bits = std::max<int>(VOXEL_TABLE_MIN_BITS, 64 - partition.shift + 1);
+	std::vector<uint64_t> keys(static_cast<size_t>(1) << bits, VOXEL_EMPTY_KEY);
+	std::vector<VoxelCell> cells(keys.size());
+	std::vector<uint32_t> used;
+	used.reserve(keys.size() / 2);
+	size_t mask = keys.size() - 1;
+	for (size_t i = 0; i < partition.used.size(); i++) {
+		uint32_t from = partition.used[i];
+		size_t slot = (partition.keys[from] * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+		while (VOXEL_EMPTY_KEY != keys[slot]) {
+			slot = (slot + 1) & mask;
+		}
+		keys[slot] = partition.keys[from];
+		cells[slot] = partition.cells[from];
+		used.push_back(slot);
+	}
+	partition.keys.swap(keys);
+	partition.cells.swap(cells);
+	partition.used.swap(used);
+	partition.shift = 64 - bits;
+}
+
+void VoxelGrid::clearPartition(Partition &partition) {
+	for (size_t i = 0; i < partition.used.size(); i++) {
+		partition.keys[partition.used[i]] = VOXEL_EMPTY_KEY;
+	}
+	partition.used.clear();
+}
+
+void VoxelGrid::merge(pcl::PointCloud<PointXYZIT> &out) {
+	out.clear();
+	if(m_vecPartitions.empty()) {
+		return;
+	}
+	Partition &merged = m_vecPartitions[0];
+	for (int i = 1; i < m_vecPartitions.size(); i++) {
+		Partition &partial = m_vecPartitions[i];
+		for (size_t j = 0; j < partial.used.size(); j++) {
+			uint32_t from = partial.used[j];
+			const VoxelCell &other = partial.cells[from];
+			bool found;
+			VoxelCell &cell = takeCell(merged, partial.keys[from], found);
+			if(!found) {
+				cell = other;
+				continue;
+			}
+			if(m_bCentroid) {
+				cell.x += other.x;
+				cell.y += other.y;
+				cell.z += other.z;
+				cell.intensity += other.intensity;
+				cell.count += other.count;
+			}
+			if(other.timestamp < cell.timestamp) {
+				if(!m_bCentroid) {
+					cell.x = other.x;
+					cell.y = other.y;
+					cell.z = other.z;
+					cell.intensity = other.intensity;
+				}
+				cell.timestamp = other.timestamp;
+				cell.ring = other.ring;
+			}
+		}
+		clearPartition(partial);
+	}
+	out.points.reserve(merged.used.size());
+	for (size_t i = 0; i < merged.used.size(); i++) {
+		const VoxelCell &cell = merged.cells[merged.used[i]];
+		float scale = 1.0f / cell.count;
+		PointXYZIT point;
+		point.x = cell.x * scale;
+		point.y = cell.y * scale;
+		point.z = cell.z * scale;
+		point.intensity = cell.intensity * scale;
+		point.timestamp = cell.timestamp;
+		point.ring = cell.ring;
+		out.points.push_back(point);
+	}
+	clearPartition(merged);
+	out.width = out.points.size();
+	out.height = 1;
+}
+
+void VoxelGrid::clear() {
+	for (int i = 0; i < m_vecPartitions.size(); i++) {
+		clearPartition(m_vecPartitions[i]);
+	}
+}
@@ -3,6 +3,33 @@
 #include <pcl/io/pcd_io.h>
 #include <pcl/point_types.h>
 #include <iostream>
+#include <fstream>
+#include <deque>
+#include <stddef.h>
+#include <boost/thread/condition_variable.hpp>
+
+static_assert(sizeof(PandarSwiftPoint) == sizeof(PPoint) && offsetof(PandarSwiftPoint, intensity) == offsetof(PPoint, intensity) &&
+              offsetof(PandarSwiftPoint, timestamp) == offsetof(PPoint, timestamp) && offsetof(PandarSwiftPoint, ring) == offsetof(PPoint, ring),
+              "PandarSwiftPoint must match the layout of PPoint");
+
+typedef struct PandarSwiftHandle_s {
+    std::string deviceIpAddr;
+    int lidarPort;
+    int gpsPort;
+    std::string correctionFile;
+    std::string firetimeFile;
+    std::string pcapFile;
+    std::string certFile;
+    std::string privateKeyFile;
+    std::string caFile;
+    size_t queueSize;
+    boost::shared_ptr<PandarSwiftSDK> spSDK;
+    boost::mutex mutex;
+    boost::condition_variable frameReady;
+    std::deque<std::pair<boost::shared_ptr<PPointCloud>, double> > frames;  // a queued cloud is not reused by the SDK
+    std::deque<uint64_t> sequences;
+    uint64_t sequence;
+} PandarSwiftHandle;
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -14,26 +41,32 @@ bool running = true;
 int frameItem = 0;
 int saveFrameIndex = 10;
 boost::shared_ptr<PandarSwiftSDK> spPandarSwiftSDK;
+boost::thread csvWriteThread;
 
 void gpsCallback(double timestamp) {
     if(printFlag == 1)     
         printf("gps: %lf\n", timestamp);   
 }
 
+static void writeCsv(boost::shared_ptr<PPointCloud> cld) {
+    int Num = cld->points.size();
+    std::ofstream zos("./cloudpoints.csv");
+    for (int i = 0; i < Num; i++)
+    {
+        zos <<  cld->points[i].x << "," << cld->points[i].y << "," << cld->points[i].z << "," << cld->points[i].intensity << "," << cld->points[i].timestamp << "," << cld->points[i].ring << std::endl;
+    }
+}
+
 void lidarCallback(boost::shared_ptr<PPointCloud> cld, double timestamp) {
     if(printFlag == 1)       
         printf("timestamp: %lf,point_size: %ld\n", timestamp, cld->points.size());
     if(pcdFileWriteFlag == 1) {
         frameItem++;
         if(saveFrameIndex == frameItem) {
-            int Num = cld->points.size();                           
-            std::ofstream zos("./cloudpoints.csv");
-            for (int i = 0; i < Num; i++)                             
-            {
-                zos <<  cld->points[i].x << "," << cld->points[i].y << "," << cld->points[i].z << "," << cld->points[i].intensity << "," << cld->points[i].timestamp << "," << cld->points[i].ring << std::endl;
-            }
+            // written off the publish thread, the SDK does not reuse a cloud that is still held
+            csvWriteThread = boost::thread(writeCsv, cld);
         }
-    }         
+    }
 }
 
 
@@ -55,9 +88,102 @@ void RunPandarSwiftSDK(char* deviceipaddr, int lidarport, int gpsport, char* cor
   
     sleep(runTime);
     spPandarSwiftSDK->stop();
+    if(csvWriteThread.joinable()) {
+        csvWriteThread.join();
+    }
     return;
 }
 
+static void queueFrame(PandarSwiftHandle *handle, boost::shared_ptr<PPointCloud> cld, double timestamp) {
+    boost::mutex::scoped_lock lock(handle->mutex);
+    handle->frames.push_back(std::make_pair(cld, timestamp));
+    handle->sequences.push_back(++handle->sequence);
+    if(handle->frames.size() > handle->queueSize) {
+        handle->frames.pop_front();
+        handle->sequences.pop_front();
+    }
+    handle->frameReady.notify_one();
+}
+
+void* PandarSwiftSDKCreate(const char* deviceipaddr, int lidarport, int gpsport, const char* correctionfile, const char* firtimeflie,
+                            const char* pcapfile, const char* certFile, const char* privateKeyFile, const char* caFile, int queueSize) {
+    PandarSwiftHandle *handle = new PandarSwiftHandle;
+    handle->deviceIpAddr = NULL != deviceipaddr ? deviceipaddr : "";
+    handle->lidarPort = lidarport;
+    handle->gpsPort = gpsport;
+    handle->correctionFile = NULL != correctionfile ? correctionfile : "";
+    handle->firetimeFile = NULL != firtimeflie ? firtimeflie : "";
+    handle->pcapFile = NULL != pcapfile ? pcapfile : "";
+    handle->certFile = NULL != certFile ? certFile : "";
+    handle->privateKeyFile = NULL != privateKeyFile ? privateKeyFile : "";
+    handle->caFile = NULL != caFile ? caFile : "";
+    handle->queueSize = queueSize > 0 ? queueSize : 1;
+    handle->sequence = 0;
+    return handle;
+}
+
+int PandarSwiftSDKStart(void* handle) {
+    PandarSwiftHandle *h = static_cast<PandarSwiftHandle *>(handle);
+    if(NULL == h || NULL != h->spSDK) {
+        return -1;
+    }
+    h->spSDK.reset(new PandarSwiftSDK(h->deviceIpAddr, h->lidarPort, h->gpsPort, std::string("Pandar128"), \
+                                h->correctionFile, h->firetimeFile, h->pcapFile, \
+                                boost::bind(&queueFrame, h, _1, _2), NULL, NULL, \
+                                h->certFile, h->privateKeyFile, h->caFile, \
+                                0, 0, std::string("point"), false));
+    return 0;
+}
+
+void PandarSwiftSDKStop(void* handle) {
+    PandarSwiftHandle *h = static_cast<PandarSwiftHandle *>(handle);
+    if(NULL == h || NULL == h->spSDK) {
+        return;
+    }
+    h->spSDK->stop();
+    h->spSDK.reset();
+}
+
+void PandarSwiftSDKDestroy(void* handle) {
+    PandarSwiftSDKStop(handle);
+    delete static_cast<PandarSwiftHandle *>(handle);
+}
+
+int PandarSwiftSDKNextFrame(void* handle, PandarSwiftFrame* frame, int timeoutMs) {
+    PandarSwiftHandle *h = static_cast<PandarSwiftHandle *>(handle);
+    if(NULL == h || NULL == frame) {
+        return -1;
+    }
+    boost::mutex::scoped_lock lock(h->mutex);
+    if(h->frames.empty() && timeoutMs > 0) {
+        h->frameReady.timed_wait(lock, boost::posix_time::milliseconds(timeoutMs), [h] { return !h->frames.empty(); });
+    }
+    if(h->frames.empty()) {
+        return -1;
+    }
+    boost::shared_ptr<PPointCloud> cld = h->frames.front().first;
+    frame->points = reinterpret_cast<const PandarSwiftPoint *>(cld->points.data());
+    frame->pointNum = cld->points.size();
+    frame->width = cld->width;
+    frame->height = cld->height;
+    frame->timestamp = h->frames.front().second;
+    frame->sequence = h->sequences.front();
+    frame->reserved = new boost::shared_ptr<PPointCloud>(cld);
+    h->frames.pop_front();
+    h->sequences.pop_front();
+    return 0;
+}
+
+void PandarSwiftSDKReleaseFrame(PandarSwiftFrame* frame) {
+    if(NULL == frame || NULL == frame->reserved) {
+        return;
+    }
+    delete static_cast<boost::shared_ptr<PPointCloud> *>(frame->reserved);
+    frame->reserved = NULL;
+    frame->points = NULL;
+    frame->pointNum = 0;
+}
+
 void SetPcdFileWriteFlag(int flag, int frameNum){
     saveFrameIndex = frameNum;
     pcdFileWriteFlag = flag;
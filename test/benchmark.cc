@@ -0,0 +1,265 @@
+/******************************************************************************
+ * Copyright 2020 The Hesai Technology Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <getopt.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <thread>
+#include <boost/atomic.hpp>
+#include "pandarSwiftSDK.h"
+#include "packetGenerator.h"
+#include "taskflow.hpp"
+
+// Decoder and frame assembly benchmark on generated packets, results as JSON.
+// The end to end rows push rotations through a live SDK and read getStats();
+// the SDK is then stopped and every stage is timed alone through its
+// benchmark entry points. total_ns of a row is the time named by its metric.
+
+typedef struct BenchmarkResult_s {
+    std::string name;
+    std::string udpVersion;
+    std::string metric;
+    int threads;
+    uint64_t u64Packets;
+    uint64_t u64Points;
+    uint64_t u64TotalNs;
+} BenchmarkResult;
+
+static boost::atomic<uint64_t> frameCount(0);
+
+void lidarCallback(boost::shared_ptr<PPointCloud> cld, double timestamp) {
+    frameCount.fetch_add(1);
+}
+
+class PandarSwiftBenchmark {
+ public:
+    PandarSwiftBenchmark(uint8_t major, uint8_t minor, std::string paramsdir, int iterations) {
+        m_iIterations = iterations;
+        PacketGeneratorConfig config;
+        config.u8VersionMajor = major;
+        config.u8VersionMinor = minor;
+        config.u8Flags = GENERATOR_FLAG_SEQ_NUM | GENERATOR_FLAG_FUNCTION_SAFETY;
+        m_sUdpVersion = std::to_string(major) + "." + std::to_string(minor);
+        m_bQT128 = 3 == major;
+        std::string lidar = m_bQT128 ? "PandarQT128" : "Pandar128";
+        // a pcap name keeps the calibration local, the manager data type starts no input
+        m_spSDK.reset(new PandarSwiftSDK(std::string("127.0.0.1"), 2368, 10110, std::string("Pandar128"), \
+                                paramsdir + "/" + lidar + "_Correction.csv", \
+                                paramsdir + "/" + lidar + "_Firetimes.csv", \
+                                std::string("benchmark"), lidarCallback, NULL, NULL, \
+                                std::string(""), std::string(""), std::string(""), \
+                                0, 0, std::string("point"), false, std::string(MANAGER_DATA_TYPE)));
+        m_spGenerator.reset(new PacketGenerator(config));
+        m_iPacketsPerFrame = m_spGenerator->getPacketsPerFrame();
+        m_vecPackets.resize(m_iPacketsPerFrame);
+        for (int i = 0; i < m_iPacketsPerFrame; i++) {
+            m_spGenerator->nextPacket(m_vecPackets[i]);
+        }
+        m_u64PointsPerPacket = static_cast<uint64_t>(m_vecPackets[0].data[PANDAR_LASER_NUMBER_INDEX]) * m_vecPackets[0].data[PANDAR_LASER_NUMBER_INDEX + 1];
+        // the first rotations let the SDK detect the mode as on a live stream
+        pushRotations(3);
+    }
+
+    ~PandarSwiftBenchmark() {
+        m_spSDK->stop();
+    }
+
+    // iterations rotations through the live SDK, then the SDK is stopped for the stage benchmarks
+    void runPipeline(std::vector<BenchmarkResult> &results) {
+        m_spSDK->resetStats();
+        uint64_t start = now();
+        pushRotations(m_iIterations);
+        uint64_t totalNs = now() - start;
+        m_spSDK->stop();
+        PandarSwiftStats stats = m_spSDK->getStats();
+        int threads = PandarSwiftSDK::getDecodeThreadNum();
+        uint64_t points = stats.u64Packets * m_u64PointsPerPacket;
+        BenchmarkResult assembly = {"frameAssembly", m_sUdpVersion, "summed latency from the start angle to the publisher", threads,
+                                    stats.u64Packets, points, static_cast<uint64_t>(stats.frameAssembly.dMeanUs * stats.frameAssembly.u64Count * 1000)};
+        BenchmarkResult pipeline = {"pushLiDARData to callback", m_sUdpVersion, "wall time of all rotations", threads,
+                                    stats.u64Packets, points, totalNs};
+        results.push_back(assembly);
+        results.push_back(pipeline);
+        if(stats.u64DroppedPackets > 0) {
+            printf("UDP %s: %lu packets dropped, the buffer ran full\n", m_sUdpVersion.c_str(), stats.u64DroppedPackets);
+        }
+    }
+
+    // one rotation decoded by the kernel of the stream, or dispatched per packet, on an executor of threads workers
+    BenchmarkResult decode(int threads, bool dispatch) {
+        std::string kernel = dispatch ? "calcPointXYZIT" : (m_bQT128 ? "calcQT128Points" : "calcPandar128Points");
+        BenchmarkResult result = {kernel, m_sUdpVersion, "wall time of the executor runs", threads, 0, 0, 0};
+        tf::Executor executor(threads);
+        PandarSwiftSDK *sdk = m_spSDK.get();
+        for (int n = 0; n < m_iIterations; n++) {
+            sdk->benchmarkClearFrame();
+            tf::Taskflow taskFlow;
+            taskFlow.parallel_for(m_vecPackets.begin(), m_vecPackets.end(), [sdk, dispatch](auto &pkt) { sdk->benchmarkDecode(pkt, dispatch); });
+            uint64_t start = now();
+            executor.run(taskFlow).wait();
+            result.u64TotalNs += now() - start;
+            result.u64Packets += m_vecPackets.size();
+        }
+        result.u64Points = result.u64Packets * m_u64PointsPerPacket;
+        return result;
+    }
+
+    BenchmarkResult parse() {
+        BenchmarkResult result = {"parseData", m_sUdpVersion, "wall time on the calling thread", 1, 0, 0, 0};
+        Pandar128PacketVersion13 packet;
+        uint64_t start = now();
+        for (int n = 0; n < m_iIterations; n++) {
+            for (int i = 0; i < m_vecPackets.size(); i++) {
+                PandarSwiftSDK::parseData(packet, m_vecPackets[i].data, m_vecPackets[i].size);
+            }
+        }
+        result.u64TotalNs = now() - start;
+        result.u64Packets = static_cast<uint64_t>(m_iIterations) * m_vecPackets.size();
+        return result;
+    }
+
+    // every task of one rotation is checked, the one crossing the start angle is searched
+    BenchmarkResult publishCheck() {
+        BenchmarkResult result = {"isNeedPublish+moveTaskEndToStartAngle", m_sUdpVersion, "wall time on the calling thread", 1, 0, 0, 0};
+        int step = getStepSize();
+        m_spSDK->benchmarkLoadPackets(m_vecPackets);
+        uint64_t start = now();
+        for (int n = 0; n < m_iIterations; n++) {
+            for (int begin = 0; begin + step <= m_iPacketsPerFrame; begin += step) {
+                m_spSDK->benchmarkFindFrameEnd(begin, step);
+                result.u64Packets += step;
+            }
+        }
+        result.u64TotalNs = now() - start;
+        return result;
+    }
+
+    BenchmarkResult taskFlow() {
+        BenchmarkResult result = {"doTaskFlow", m_sUdpVersion, "wall time of the doTaskFlow calls", PandarSwiftSDK::getDecodeThreadNum(), 0, 0, 0};
+        int step = getStepSize();
+        m_spSDK->benchmarkLoadPackets(m_vecPackets);
+        for (int n = 0; n < m_iIterations; n++) {
+            m_spSDK->benchmarkClearFrame();
+            for (int begin = 0; begin + step <= m_iPacketsPerFrame; begin += step) {
+                uint64_t start = now();
+                m_spSDK->benchmarkDecodeTask(begin, step);
+                result.u64TotalNs += now() - start;
+                result.u64Packets += step;
+            }
+        }
+        result.u64Points = result.u64Packets * m_u64PointsPerPacket;
+        return result;
+    }
+
+    inline bool isQT128() {
+        return m_bQT128;
+    }
+
+ private:
+    static inline uint64_t now() {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return time.tv_sec * 1000000000ull + time.tv_nsec;
+    }
+    inline int getStepSize() {
+        return m_bQT128 ? PANDARQT128_TASKFLOW_STEP_SIZE : TASKFLOW_STEP_SIZE;
+    }
+    // push rotation by rotation, each waits for the frame it closes so the buffer never runs full
+    void pushRotations(int rotations) {
+        PandarPacket pkt;
+        for (int n = 0; n < rotations; n++) {
+            uint64_t frames = frameCount.load();
+            for (int i = 0; i < m_iPacketsPerFrame; i++) {
+                m_spGenerator->nextPacket(pkt);
+                m_spSDK->pushLiDARData(pkt);
+            }
+            for (int wait = 0; wait < 1000 && frameCount.load() == frames; wait++) {
+                usleep(100);
+            }
+        }
+    }
+
+    boost::shared_ptr<PandarSwiftSDK> m_spSDK;
+    boost::shared_ptr<PacketGenerator> m_spGenerator;
+    std::vector<PandarPacket> m_vecPackets;  // one rotation for the stage benchmarks
+    std::string m_sUdpVersion;
+    bool m_bQT128;
+    int m_iIterations;
+    int m_iPacketsPerFrame;
+    uint64_t m_u64PointsPerPacket;
+};
+
+void writeResult(FILE *fp, const BenchmarkResult &result, bool last) {
+    double seconds = result.u64TotalNs / 1e9;
+    fprintf(fp, "    {\"name\": \"%s\", \"udp_version\": \"%s\", \"metric\": \"%s\", \"threads\": %d, \"packets\": %lu, \"points\": %lu, "
+                "\"total_ns\": %lu, \"ns_per_packet\": %.1f, \"ns_per_point\": %.2f, \"packets_per_sec\": %.0f}%s\n",
+            result.name.c_str(), result.udpVersion.c_str(), result.metric.c_str(), result.threads, result.u64Packets, result.u64Points,
+            result.u64TotalNs,
+            result.u64Packets > 0 ? static_cast<double>(result.u64TotalNs) / result.u64Packets : 0,
+            result.u64Points > 0 ? static_cast<double>(result.u64TotalNs) / result.u64Points : 0,
+            seconds > 0 ? result.u64Packets / seconds : 0, last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    std::string paramsDir = "../params";
+    std::string outputFile = "";
+    int iterations = 20;
+    int maxThreads = std::thread::hardware_concurrency();
+    int opt;
+    while ((opt = getopt(argc, argv, "p:o:n:t:h")) != -1) {
+        switch (opt) {
+        case 'p': paramsDir = optarg; break;
+        case 'o': outputFile = optarg; break;
+        case 'n': iterations = atoi(optarg); break;
+        case 't': maxThreads = atoi(optarg); break;
+        default:
+            printf("usage: %s [-p params dir] [-o result.json] [-n rotations per case] [-t max decode threads]\n", argv[0]);
+            return 1;
+        }
+    }
+    maxThreads = std::max(maxThreads, 1);
+    std::vector<BenchmarkResult> results;
+    const uint8_t versions[3][2] = {{1, 3}, {1, 4}, {3, 2}};
+    for (int v = 0; v < 3; v++) {
+        PandarSwiftBenchmark benchmark(versions[v][0], versions[v][1], paramsDir, iterations);
+        benchmark.runPipeline(results);
+        // 1, 2, 4 ... threads and maxThreads itself
+        for (int threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2) {
+            results.push_back(benchmark.decode(threads, false));
+        }
+        results.push_back(benchmark.decode(1, true));
+        if(!benchmark.isQT128()) {
+            // parseData only understands the 1.x layouts
+            results.push_back(benchmark.parse());
+        }
+        results.push_back(benchmark.publishCheck());
+        results.push_back(benchmark.taskFlow());
+    }
+    FILE *fp = outputFile.empty() ? stdout : fopen(outputFile.c_str(), "w");
+    if(NULL == fp) {
+        printf("Open %s failed\n", outputFile.c_str());
+        return 1;
+    }
+    fprintf(fp, "{\n  \"hardware_threads\": %u,\n  \"iterations\": %d,\n  \"results\": [\n",
+            std::thread::hardware_concurrency(), iterations);
+    for (int i = 0; i < results.size(); i++) {
+        writeResult(fp, results[i], i + 1 == results.size());
+    }
+    fprintf(fp, "  ]\n}\n");
+    if(stdout != fp) {
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+/******************************************************************************
+ * Copyright 2020 The Hesai Technology Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <boost/thread/mutex.hpp>
+#include "pandarSwiftSDK.h"
+#include "packetGenerator.h"
+#include "frameCodec.h"
+
+// FrameEncoder / FrameDecoder size and speed on frames the SDK decoded from
+// generated packets, results as JSON. Every frame is checked to come back bit
+// for bit, the exit code is 1 if one does not.
+
+typedef struct CodecCase_s {
+    const char *name;
+    uint8_t u8VersionMajor;
+    uint8_t u8VersionMinor;
+    uint8_t u8ReturnMode;
+    bool extrinsic;  // the points are moved, their xyz is stored raw
+} CodecCase;
+
+typedef struct CodecResult_s {
+    std::string name;
+    uint64_t u64Frames;
+    uint64_t u64Points;      // non-empty points of the frames
+    uint64_t u64Bytes;
+    uint64_t u64EncodeNs;
+    uint64_t u64DecodeNs;
+    uint64_t u64Mismatches;  // points not decoded bit for bit
+} CodecResult;
+
+static boost::mutex framesMutex;
+static std::vector<std::pair<boost::shared_ptr<PPointCloud>, double> > frames;
+
+// a held cloud is not reused by the SDK
+void lidarCallback(boost::shared_ptr<PPointCloud> cld, double timestamp) {
+    boost::mutex::scoped_lock lock(framesMutex);
+    frames.push_back(std::make_pair(cld, timestamp));
+}
+
+static size_t getFrameCount() {
+    boost::mutex::scoped_lock lock(framesMutex);
+    return frames.size();
+}
+
+static inline uint64_t now() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000ull + time.tv_nsec;
+}
+
+static inline bool isSamePoint(const PPoint &a, const PPoint &b) {
+    return 0 == memcmp(&a.x, &b.x, sizeof(float)) && 0 == memcmp(&a.y, &b.y, sizeof(float)) &&
+            0 == memcmp(&a.z, &b.z, sizeof(float)) && 0 == memcmp(&a.intensity, &b.intensity, sizeof(float)) &&
+            0 == memcmp(&a.timestamp, &b.timestamp, sizeof(double)) && a.ring == b.ring;
+}
+
+// decode frameNum + 3 rotations of the case, the first frame is dropped as the SDK settles
+static int collectFrames(const CodecCase &codecCase, std::string paramsdir, int frameNum) {
+    PacketGeneratorConfig config;
+    config.u8VersionMajor = codecCase.u8VersionMajor;
+    config.u8VersionMinor = codecCase.u8VersionMinor;
+    config.u8ReturnMode = codecCase.u8ReturnMode;
+    config.u8Flags = GENERATOR_FLAG_SEQ_NUM | GENERATOR_FLAG_FUNCTION_SAFETY;
+    std::string lidar = 3 == config.u8VersionMajor ? "PandarQT128" : "Pandar128";
+    // a pcap name keeps the calibration local, the manager data type starts no input
+    boost::shared_ptr<PandarSwiftSDK> spSDK(new PandarSwiftSDK(std::string("127.0.0.1"), 2368, 10110, std::string("Pandar128"), \
+                                paramsdir + "/" + lidar + "_Correction.csv", \
+                                paramsdir + "/" + lidar + "_Firetimes.csv", \
+                                std::string("codecBenchmark"), lidarCallback, NULL, NULL, \
+                                std::string(""), std::string(""), std::string(""), \
+                                0, 0, std::string("point"), false, std::string(MANAGER_DATA_TYPE)));
+    if(codecCase.extrinsic) {
+        float matrix[16] = {0.8f, -0.6f, 0, 1.5f, 0.6f, 0.8f, 0, -0.25f, 0, 0, 1, 1.9f, 0, 0, 0, 1};
+        spSDK->setExtrinsic(matrix);
+    }
+    {
+        boost::mutex::scoped_lock lock(framesMutex);
+        frames.clear();
+    }
+    PacketGenerator generator(config);
+    PandarPacket pkt;
+    // push rotation by rotation, each waits for the frame it closes so the buffer never runs full
+    for (int n = 0; n < frameNum + 3; n++) {
+        size_t count = getFrameCount();
+        for (int i = 0; i < generator.getPacketsPerFrame(); i++) {
+            generator.nextPacket(pkt);
+            spSDK->pushLiDARData(pkt);
+        }
+        for (int wait = 0; wait < 1000 && n >= 2 && getFrameCount() == count; wait++) {
+            usleep(100);
+        }
+    }
+    spSDK->stop();
+    boost::mutex::scoped_lock lock(framesMutex);
+    if(frames.size() < 2) {
+        printf("%s: no frame decoded\n", codecCase.name);
+        return -1;
+    }
+    frames.erase(frames.begin());
+    return 0;
+}
+
+static CodecResult runCase(const CodecCase &codecCase, std::string paramsdir, int frameNum, int iterations) {
+    CodecResult result = {codecCase.name, 0, 0, 0, 0, 0, 0};
+    if(0 != collectFrames(codecCase, paramsdir, frameNum)) {
+        result.u64Mismatches = 1;
+        return result;
+    }
+    int returnNum = GENERATOR_RETURN_MODE_DUAL == codecCase.u8ReturnMode ? 2 : 1;
+    FrameEncoder encoder;
+    FrameDecoder decoder;
+    std::vector<uint8_t> data;
+    PPointCloud decoded;
+    for (size_t f = 0; f < frames.size(); f++) {
+        const PPointCloud &cloud = *frames[f].first;
+        double timestamp = 0;
+        for (int n = 0; n < iterations; n++) {
+            uint64_t start = now();
+            encoder.encode(cloud, frames[f].second, PANDAR128_LASER_NUM, returnNum, data);  // generated with 128 lasers
+            uint64_t encoded = now();
+            decoder.decode(data.data(), data.size(), decoded, timestamp);
+            result.u64DecodeNs += now() - encoded;
+            result.u64EncodeNs += encoded - start;
+        }
+        const FrameCodecStats &stats = encoder.getStats();
+        result.u64Frames++;
+        result.u64Points += cloud.points.size() - stats.u32EmptyPoints;
+        result.u64Bytes += data.size();
+        if(decoded.points.size() != cloud.points.size() || timestamp != frames[f].second) {
+            result.u64Mismatches += cloud.points.size();
+            continue;
+        }
+        for (size_t i = 0; i < cloud.points.size(); i++) {
+            result.u64Mismatches += !isSamePoint(cloud.points[i], decoded.points[i]);
+        }
+    }
+    result.u64EncodeNs /= iterations;
+    result.u64DecodeNs /= iterations;
+    return result;
+}
+
+void writeResult(FILE *fp, const CodecResult &result, bool last) {
+    double points = result.u64Points > 0 ? static_cast<double>(result.u64Points) : 1;
+    fprintf(fp, "    {\"name\": \"%s\", \"frames\": %lu, \"points\": %lu, \"bytes\": %lu, \"bytes_per_point\": %.3f, "
+                "\"ratio_to_binary_pcd\": %.2f, \"encode_ns_per_point\": %.2f, \"decode_ns_per_point\": %.2f, \"mismatches\": %lu}%s\n",
+            result.name.c_str(), result.u64Frames, result.u64Points, result.u64Bytes, result.u64Bytes / points,
+            result.u64Bytes > 0 ? 26.0 * result.u64Points / result.u64Bytes : 0,
+            result.u64EncodeNs / points, result.u64DecodeNs / points, result.u64Mismatches, last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    std::string paramsDir = "../params";
+    std::string outputFile = "";
+    int frameNum = 5;
+    int iterations = 5;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:o:f:n:h")) != -1) {
+        switch (opt) {
+        case 'p': paramsDir = optarg; break;
+        case 'o': outputFile = optarg; break;
+        case 'f': frameNum = atoi(optarg); break;
+        case 'n': iterations = atoi(optarg); break;
+        default:
+            printf("usage: %s [-p params dir] [-o result.json] [-f frames per case] [-n codings per frame]\n", argv[0]);
+            return 1;
+        }
+    }
+    const CodecCase cases[] = {
+        {"udp1.3 strongest", 1, 3, GENERATOR_RETURN_MODE_STRONGEST, false},
+        {"udp1.4 strongest", 1, 4, GENERATOR_RETURN_MODE_STRONGEST, false},
+        {"udp1.4 dual", 1, 4, GENERATOR_RETURN_MODE_DUAL, false},
+        {"udp3.2 strongest", 3, 2, GENERATOR_RETURN_MODE_STRONGEST, false},
+        {"udp1.4 extrinsic", 1, 4, GENERATOR_RETURN_MODE_STRONGEST, true},
+    };
+    int caseNum = sizeof(cases) / sizeof(cases[0]);
+    std::vector<CodecResult> results;
+    uint64_t mismatches = 0;
+    for (int c = 0; c < caseNum; c++) {
+        results.push_back(runCase(cases[c], paramsDir, frameNum, iterations));
+        mismatches += results.back().u64Mismatches;
+    }
+    FILE *fp = outputFile.empty() ? stdout : fopen(outputFile.c_str(), "w");
+    if(NULL == fp) {
+        printf("Open %s failed\n", outputFile.c_str());
+        return 1;
+    }
+    fprintf(fp, "{\n  \"frames_per_case\": %d,\n  \"codings_per_frame\": %d,\n  \"results\": [\n", frameNum, iterations);
+    for (int i = 0; i < results.size(); i++) {
+        writeResult(fp, results[i], i + 1 == results.size());
+    }
+    fprintf(fp, "  ]\n}\n");
+    if(stdout != fp) {
+        fclose(fp);
+    }
+    return mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Copyright 2020 The Hesai Technology Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <getopt.h>
+#include <stdlib.h>
+#include "packetGenerator.h"
+
+void usage(const char *name) {
+    printf("usage: %s [options]\n", name);
+    printf("  -v <1.3|1.4|3.2>   udp version, default 1.4\n");
+    printf("  -f <hex>           1.4 / 3.2 flags: 1 seq, 2 imu, 4 function safety, 8 signature, 10 confidence, default 5\n");
+    printf("  -l <128|80|64|40>  laser number, default 128\n");
+    printf("  -b <blocks>        blocks per packet, default the sensor's own\n");
+    printf("  -s <rpm>           motor speed, 600 or 1200, default 600\n");
+    printf("  -r <hex>           return mode, 37 strongest, 38 last, 39 dual, default 37\n");
+    printf("  -g <meters>        sensor height above the ground, 0: no ground, default 1.8\n");
+    printf("  -w <meters>        radius of the surrounding wall, default 30\n");
+    printf("  -n <frames>        rotations to generate, 0: endless udp, default 10\n");
+    printf("  -o <file>          write a pcap file\n");
+    printf("  -u <ip>            send udp to ip, default 127.0.0.1\n");
+    printf("  -p <port>          destination port, default 2368\n");
+    printf("  -x                 send as fast as possible instead of the sensor packet rate\n");
+}
+
+int main(int argc, char** argv) {
+    PacketGeneratorConfig config;
+    std::string pcapFile = "";
+    std::string destIp = "127.0.0.1";
+    uint16_t port = 2368;
+    uint32_t frames = 10;
+    bool realtime = true;
+    int opt;
+    while ((opt = getopt(argc, argv, "v:f:l:b:s:r:g:w:n:o:u:p:xh")) != -1) {
+        switch (opt) {
+        case 'v':
+            if(sscanf(optarg, "%hhu.%hhu", &config.u8VersionMajor, &config.u8VersionMinor) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'f': config.u8Flags = strtoul(optarg, NULL, 16); break;
+        case 'l': config.laserNum = atoi(optarg); break;
+        case 'b': config.blockNum = atoi(optarg); break;
+        case 's': config.u16MotorSpeed = atoi(optarg); break;
+        case 'r': config.u8ReturnMode = strtoul(optarg, NULL, 16); break;
+        case 'g': config.fGroundHeight = atof(optarg); break;
+        case 'w': config.fWallRadius = atof(optarg); break;
+        case 'n': frames = atoi(optarg); break;
+        case 'o': pcapFile = optarg; break;
+        case 'u': destIp = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'x': realtime = false; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    PacketGenerator generator(config);
+    printf("udp %d.%d, %d bytes per packet, %d packets per frame, %.1f us apart\n", config.u8VersionMajor, config.u8VersionMinor,
+            generator.getPacketSize(), generator.getPacketsPerFrame(), generator.getPacketInterval() * 1000000);
+    int count;
+    if(!pcapFile.empty()) {
+        count = generator.writePcap(pcapFile, frames, port);
+    }
+    else {
+        count = generator.sendUdp(destIp, port, frames, realtime);
+    }
+    if(count < 0) {
+        return 1;
+    }
+    printf("%d packets\n", count);
+    return 0;
+}
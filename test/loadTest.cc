@@ -0,0 +1,288 @@
+/******************************************************************************
+ * Copyright 2020 The Hesai Technology Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <getopt.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include "pandarSwiftSDK.h"
+#include "packetGenerator.h"
+#include "latencyHistogram.h"
+#include "platUtil.h"
+
+// Loopback load test: simulated sensors stream generated packets over udp to live
+// PandarSwiftSDK instances, one case per frame rate and sensor count.
+
+typedef struct LoadCaseResult_s {
+    int rateHz;
+    int sensors;
+    uint64_t u64PacketsSent;          // warm up included
+    uint64_t u64PacketsReceived;
+    uint64_t u64PacketsLost;          // sequence gaps, mostly socket buffer drops
+    uint64_t u64DroppedPackets;       // packet buffer full
+    uint64_t u64BufferOverflows;      // "buffer don't have space" events
+    uint64_t u64FramesExpected;
+    uint64_t u64Frames;
+    LatencySnapshot latency;          // last packet of a frame to its callback
+    double dCpuPerSensor;             // percent of one core
+    bool bPass;
+} LoadCaseResult;
+
+static double getProcessCpuSec() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static double getThreadCpuSec() {
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+class LoadTestSensor {
+ public:
+    LoadTestSensor(std::string paramsdir, uint16_t port, const PacketGeneratorConfig &config, LatencyHistogram *latency) {
+        m_u16Port = port;
+        m_pLatency = latency;
+        m_objConfig = config;
+        m_bRecording = false;
+        m_u64Frames = 0;
+        m_u64PacketsSent = 0;
+        m_dSenderCpu = 0;
+        m_spSDK.reset(new PandarSwiftSDK(std::string("127.0.0.1"), port, 0, std::string("Pandar128"), \
+                                paramsdir + "/" + (3 == config.u8VersionMajor ? "PandarQT128" : "Pandar128") + "_Correction.csv", \
+                                paramsdir + "/" + (3 == config.u8VersionMajor ? "PandarQT128" : "Pandar128") + "_Firetimes.csv", \
+                                std::string(""), boost::bind(&LoadTestSensor::lidarCallback, this, _1, _2), NULL, NULL, \
+                                std::string(""), std::string(""), std::string(""), \
+                                0, 0, std::string("point"), false));
+    }
+
+    void startSender(double seconds) {
+        m_objConfig.dStartTime = getNowTimeSec();
+        m_senderThread = boost::thread(boost::bind(&LoadTestSensor::sendPackets, this, seconds));
+    }
+
+    void startRecording() {
+        m_spSDK->resetStats();
+        m_objLossStart = m_spSDK->getPacketLossStats();
+        m_u64Frames = 0;
+        m_bRecording = true;
+    }
+
+    void finish() {
+        m_senderThread.join();
+        // the last frame is published once the next rotation starts, it never does
+        usleep(200000);
+        m_bRecording = false;
+        m_objStats = m_spSDK->getStats();
+        m_objLoss = m_spSDK->getPacketLossStats();
+        m_spSDK->stop();
+        m_spSDK.reset();
+    }
+
+    void lidarCallback(boost::shared_ptr<PPointCloud> cld, double timestamp) {
+        if(!m_bRecording) {
+            return;
+        }
+        double last = 0;
+        for (int i = 0; i < cld->points.size(); i++) {
+            last = std::max(last, cld->points[i].timestamp);
+        }
+        double latency = getNowTimeSec() - last;
+        if(last > 0 && latency > 0) {
+            m_pLatency->record(static_cast<uint64_t>(latency * 1000000));
+        }
+        m_u64Frames++;
+    }
+
+    PandarSwiftStats m_objStats;
+    PacketLossStats m_objLossStart;
+    PacketLossStats m_objLoss;
+    boost::atomic<uint64_t> m_u64Frames;
+    uint64_t m_u64PacketsSent;
+    double m_dSenderCpu;
+
+ private:
+    void sendPackets(double seconds) {
+        PacketGenerator generator(m_objConfig);
+        uint32_t frames = static_cast<uint32_t>(seconds * m_objConfig.u16MotorSpeed / 60);
+        int sent = generator.sendUdp(std::string("127.0.0.1"), m_u16Port, frames, true);
+        m_u64PacketsSent = sent > 0 ? sent : 0;
+        m_dSenderCpu = getThreadCpuSec();
+    }
+
+    boost::shared_ptr<PandarSwiftSDK> m_spSDK;
+    boost::thread m_senderThread;
+    PacketGeneratorConfig m_objConfig;
+    uint16_t m_u16Port;
+    LatencyHistogram *m_pLatency;
+    boost::atomic<bool> m_bRecording;
+};
+
+LoadCaseResult runCase(std::string paramsdir, PacketGeneratorConfig config, int rate, int sensors, uint16_t baseport,
+                       double warmup, double duration, double slo) {
+    config.u16MotorSpeed = rate * 60;
+    LatencyHistogram latency;   // shared by all sensors, record() is lock free
+    std::vector<boost::shared_ptr<LoadTestSensor> > vecSensors;
+    for (int i = 0; i < sensors; i++) {
+        vecSensors.push_back(boost::shared_ptr<LoadTestSensor>(new LoadTestSensor(paramsdir, baseport + i, config, &latency)));
+    }
+    double cpuStart = getProcessCpuSec();
+    double wallStart = getNowTimeSec();
+    for (int i = 0; i < sensors; i++) {
+        vecSensors[i]->startSender(warmup + duration);
+    }
+    // the first frames carry the start angle search and the mode detection
+    usleep(static_cast<useconds_t>(warmup * 1000000));
+    latency.reset();
+    for (int i = 0; i < sensors; i++) {
+        vecSensors[i]->startRecording();
+    }
+    LoadCaseResult result;
+    memset(&result, 0, sizeof(result));
+    result.rateHz = rate;
+    result.sensors = sensors;
+    result.u64FramesExpected = static_cast<uint64_t>(duration * rate) * sensors;
+    double senderCpu = 0;
+    for (int i = 0; i < sensors; i++) {
+        vecSensors[i]->finish();
+        LoadTestSensor &sensor = *vecSensors[i];
+        senderCpu += sensor.m_dSenderCpu;
+        result.u64PacketsSent += sensor.m_u64PacketsSent;
+        result.u64PacketsReceived += sensor.m_objLoss.u64Received - sensor.m_objLossStart.u64Received;
+        result.u64PacketsLost += sensor.m_objLoss.u64Lost - sensor.m_objLossStart.u64Lost;
+        result.u64DroppedPackets += sensor.m_objStats.u64DroppedPackets;
+        result.u64BufferOverflows += sensor.m_objStats.u64BufferOverflows;
+        result.u64Frames += sensor.m_u64Frames;
+    }
+    double cpu = getProcessCpuSec() - cpuStart - senderCpu;
+    double wall = getNowTimeSec() - wallStart;
+    result.dCpuPerSensor = cpu / wall / sensors * 100;
+    result.latency = latency.getSnapshot();
+    result.bPass = result.latency.u64Count > 0 && result.latency.u64P99Us <= slo * 1000 &&
+                   0 == result.u64PacketsLost && 0 == result.u64DroppedPackets &&
+                   result.u64Frames + sensors >= result.u64FramesExpected;
+    return result;
+}
+
+void writeResult(FILE *fp, const LoadCaseResult &result, bool last) {
+    fprintf(fp, "    {\"rate_hz\": %d, \"sensors\": %d, \"packets_sent\": %lu, \"packets_received\": %lu, \"packets_lost\": %lu, "
+                "\"dropped_packets\": %lu, \"buffer_overflows\": %lu, \"frames_expected\": %lu, \"frames\": %lu, "
+                "\"latency_ms\": {\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"p999\": %.2f, \"max\": %.2f}, "
+                "\"cpu_percent_per_sensor\": %.1f, \"pass\": %s}%s\n",
+            result.rateHz, result.sensors, result.u64PacketsSent, result.u64PacketsReceived, result.u64PacketsLost,
+            result.u64DroppedPackets, result.u64BufferOverflows, result.u64FramesExpected, result.u64Frames,
+            result.latency.u64P50Us / 1000.0, result.latency.u64P90Us / 1000.0, result.latency.u64P99Us / 1000.0,
+            result.latency.u64P999Us / 1000.0, result.latency.u64MaxUs / 1000.0,
+            result.dCpuPerSensor, result.bPass ? "true" : "false", last ? "" : ",");
+}
+
+void usage(const char *name) {
+    printf("usage: %s [options]\n", name);
+    printf("  -p <dir>           calibration directory, default ../params\n");
+    printf("  -v <1.3|1.4|3.2>   udp version, default 1.4\n");
+    printf("  -r <hz,hz>         frame rates, default 10,20\n");
+    printf("  -s <sensors>       largest sensor count, default 6\n");
+    printf("  -d <seconds>       measured seconds per case, default 10\n");
+    printf("  -w <seconds>       warm up seconds per case, default 2\n");
+    printf("  -l <ms>            p99 packet to callback latency objective, default 50\n");
+    printf("  -b <port>          first udp port, sensor n uses port + n, default 2368\n");
+    printf("  -o <file>          write the results as json\n");
+}
+
+int main(int argc, char** argv) {
+    // the generator writes utc, decode it back without a local timezone offset
+    setenv("TZ", "UTC0", 1);
+    std::string paramsDir = "../params";
+    std::string outputFile = "";
+    std::vector<int> rates = {10, 20};
+    int maxSensors = 6;
+    double duration = 10;
+    double warmup = 2;
+    double slo = 50;
+    uint16_t basePort = 2368;
+    PacketGeneratorConfig config;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:v:r:s:d:w:l:b:o:h")) != -1) {
+        switch (opt) {
+        case 'p': paramsDir = optarg; break;
+        case 'v':
+            if(sscanf(optarg, "%hhu.%hhu", &config.u8VersionMajor, &config.u8VersionMinor) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r': {
+            rates.clear();
+            char *rate = strtok(optarg, ",");
+            while (NULL != rate) {
+                rates.push_back(atoi(rate));
+                rate = strtok(NULL, ",");
+            }
+            break;
+        }
+        case 's': maxSensors = atoi(optarg); break;
+        case 'd': duration = atof(optarg); break;
+        case 'w': warmup = atof(optarg); break;
+        case 'l': slo = atof(optarg); break;
+        case 'b': basePort = atoi(optarg); break;
+        case 'o': outputFile = optarg; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    std::vector<LoadCaseResult> results;
+    std::vector<int> maxPassing;
+    for (int r = 0; r < rates.size(); r++) {
+        int passing = 0;
+        for (int sensors = 1; sensors <= maxSensors; sensors++) {
+            LoadCaseResult result = runCase(paramsDir, config, rates[r], sensors, basePort, warmup, duration, slo);
+            printf("\n%d Hz x %d sensors: p50 %.2f ms, p99 %.2f ms, max %.2f ms, lost %lu, dropped %lu, overflows %lu, "
+                   "frames %lu/%lu, cpu %.1f%% per sensor, %s\n",
+                   result.rateHz, result.sensors, result.latency.u64P50Us / 1000.0, result.latency.u64P99Us / 1000.0,
+                   result.latency.u64MaxUs / 1000.0, result.u64PacketsLost, result.u64DroppedPackets, result.u64BufferOverflows,
+                   result.u64Frames, result.u64FramesExpected, result.dCpuPerSensor, result.bPass ? "pass" : "FAIL");
+            if(result.bPass && passing == sensors - 1) {
+                passing = sensors;
+            }
+            results.push_back(result);
+        }
+        maxPassing.push_back(passing);
+    }
+    for (int r = 0; r < rates.size(); r++) {
+        printf("%d Hz: up to %d sensors within p99 %.0f ms without loss\n", rates[r], maxPassing[r], slo);
+    }
+    if(outputFile.empty()) {
+        return 0;
+    }
+    FILE *fp = fopen(outputFile.c_str(), "w");
+    if(NULL == fp) {
+        printf("Open %s failed\n", outputFile.c_str());
+        return 1;
+    }
+    fprintf(fp, "{\n  \"udp_version\": \"%d.%d\",\n  \"slo_p99_ms\": %.1f,\n  \"duration_sec\": %.1f,\n  \"max_sensors\": {",
+            config.u8VersionMajor, config.u8VersionMinor, slo, duration);
+    for (int r = 0; r < rates.size(); r++) {
+        fprintf(fp, "%s\"%d\": %d", r > 0 ? ", " : "", rates[r], maxPassing[r]);
+    }
+    fprintf(fp, "},\n  \"results\": [\n");
+    for (int i = 0; i < results.size(); i++) {
+        writeResult(fp, results[i], i + 1 == results.size());
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 0;
+}
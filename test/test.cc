@@ -18,8 +18,6 @@
 
 #define PCD_FILE_WRITE_FLAG (false) //false: don't save point cloud data;
                                     //true : save a frame of point cloud data
-int frameItem = 0;
-
 void gpsCallback(double timestamp) {
 #ifdef PRINT_FLAG    
     printf("gps: %lf\n", timestamp);
@@ -30,15 +28,6 @@ void lidarCallback(boost::shared_ptr<PPointCloud> cld, double timestamp) {
 #ifdef PRINT_FLAG       
     printf("timestamp: %lf,point_size: %ld\n", timestamp, cld->points.size());
 #endif
-    //Debug code,save the tenth frame data to the local pcd file to verify the correctness of the data
-    if(PCD_FILE_WRITE_FLAG) {
-        frameItem++;
-        if(10 == frameItem) {
-            printf("write pcd file\n");
-            pcl::PCDWriter writer;
-            writer.write("P128Pcd.pcd", *cld);
-        }
-    }   
 }
 
 void rawcallback(PandarPacketsArray *array) {
@@ -55,6 +44,14 @@ int main(int argc, char** argv) {
                                 std::string(""), \
                                 std::string(""), \
                                 0, 0, std::string("both_point_raw"), false));
+    //Debug code,save the tenth frame data to the local pcd file to verify the correctness of the data
+    if(PCD_FILE_WRITE_FLAG) {
+        FrameWriterConfig writer;
+        writer.filePrefix = "P128Pcd";  // P128Pcd_000010.pcd, written in the background
+        writer.u32Decimation = 10;
+        writer.u32MaxFrames = 1;
+        spPandarSwiftSDK->startFrameWriter(writer);
+    }
     while (true) {
         sleep(100);
     }